@@ -15,7 +15,7 @@ public class ManiacCab : ModuleRules
 				"UnrealEd" , 
 #endif
 				"CoreUObject", 
-				"Engine", "InputCore", "EnhancedInput", "Landscape" });
+				"Engine", "RenderCore", "InputCore", "EnhancedInput", "Landscape", "PhysicsCore", "Chaos", "ManiacCabDynamics" });
 
 		//PrivateDependencyModuleNames.AddRange(new string[] {  });
 
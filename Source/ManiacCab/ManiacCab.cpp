@@ -3,4 +3,16 @@
 #include "ManiacCab.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogManiacCab);
+
+DEFINE_STAT(STAT_ManiacCab_SyncTraces);
+DEFINE_STAT(STAT_ManiacCab_AsyncTraces);
+DEFINE_STAT(STAT_ManiacCab_NiagaraActivations);
+DEFINE_STAT(STAT_ManiacCab_SnapshotBytes);
+
+CSV_DEFINE_CATEGORY_MODULE(MANIACCAB_API, ManiacCab, true);
+
+uint64 ManiacCab::SceneQueryCount = 0;
+uint64 ManiacCab::VehicleUpdateCycles = 0;
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ManiacCab, "ManiacCab" );
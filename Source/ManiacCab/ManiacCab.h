@@ -3,4 +3,51 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
+MANIACCAB_API DECLARE_LOG_CATEGORY_EXTERN(LogManiacCab, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("ManiacCab"), STATGROUP_ManiacCab, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sync Traces"), STAT_ManiacCab_SyncTraces, STATGROUP_ManiacCab, MANIACCAB_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Async Traces"), STAT_ManiacCab_AsyncTraces, STATGROUP_ManiacCab, MANIACCAB_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Niagara Activations"), STAT_ManiacCab_NiagaraActivations, STATGROUP_ManiacCab, MANIACCAB_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Snapshot Bytes Sent"), STAT_ManiacCab_SnapshotBytes, STATGROUP_ManiacCab, MANIACCAB_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(MANIACCAB_API, ManiacCab);
+
+//Times a scope in the stat group, the CSV profiler and Unreal Insights at once.
+//Needs a cycle stat named STAT_ManiacCab_<Name> declared in the calling file.
+#define MANIACCAB_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_##Name); \
+	CSV_SCOPED_TIMING_STAT(ManiacCab, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(ManiacCab_##Name)
+
+namespace ManiacCab
+{
+	//Running total of scene queries issued by cars, for tools that read it outside the stats system. Game thread only.
+	extern MANIACCAB_API uint64 SceneQueryCount;
+	//Running total of cycles the game thread spent in car ticks and the vehicle manager. Game thread only.
+	extern MANIACCAB_API uint64 VehicleUpdateCycles;
+
+	//Adds the time spent in the enclosing scope to VehicleUpdateCycles.
+	struct FVehicleUpdateScope
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		~FVehicleUpdateScope() { VehicleUpdateCycles += FPlatformTime::Cycles64() - StartCycles; }
+	};
+
+	inline void CountSyncTraces(int32 a_Count)
+	{
+		INC_DWORD_STAT_BY(STAT_ManiacCab_SyncTraces, a_Count);
+		SceneQueryCount += a_Count;
+	}
+
+	inline void CountAsyncTraces(int32 a_Count)
+	{
+		INC_DWORD_STAT_BY(STAT_ManiacCab_AsyncTraces, a_Count);
+		SceneQueryCount += a_Count;
+	}
+}
@@ -1,33 +1,298 @@
 #include "CarController.h"
 
+#include "ManiacCab.h"
+#include "CarEffectsSubsystem.h"
+#include "CarGroundSubsystem.h"
+#include "CarPhysicsCallback.h"
+#include "CarSnapshotAckComponent.h"
+#include "CurveBakingSubsystem.h"
+#include "VehicleBudgetSubsystem.h"
+#include "VehicleDynamics.h"
+#include "VehicleManagerSubsystem.h"
+#include "PBDRigidsSolver.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
 #include "EnhancedInput/Public/EnhancedInputComponent.h"
+#include "Engine/AssetManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Misc/App.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_CYCLE_STAT(TEXT("UpdateAllWheels"), STAT_ManiacCab_UpdateAllWheels, STATGROUP_ManiacCab);
+DECLARE_CYCLE_STAT(TEXT("WheelGroundCheck"), STAT_ManiacCab_WheelGroundCheck, STATGROUP_ManiacCab);
+DECLARE_CYCLE_STAT(TEXT("HeightfieldGroundCheck"), STAT_ManiacCab_HeightfieldGroundCheck, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Heightfield Validations"), STAT_ManiacCab_HeightfieldValidations, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Heightfield Mismatches"), STAT_ManiacCab_HeightfieldMismatches, STATGROUP_ManiacCab);
+DECLARE_CYCLE_STAT(TEXT("CalculateInAirRotation"), STAT_ManiacCab_CalculateInAirRotation, STATGROUP_ManiacCab);
+DECLARE_CYCLE_STAT(TEXT("ProcessAirRotation"), STAT_ManiacCab_ProcessAirRotation, STATGROUP_ManiacCab);
+DECLARE_CYCLE_STAT(TEXT("HandleTurningInput"), STAT_ManiacCab_HandleTurningInput, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Contact State Changes"), STAT_ManiacCab_ContactStateChanges, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Landing Predictions"), STAT_ManiacCab_LandingPredictions, STATGROUP_ManiacCab);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<bool> CVarShowInputDebug(
+	TEXT("ManiacCab.ShowInputDebug"),
+	false,
+	TEXT("Print each car's input axis on screen every tick."));
+
+static TAutoConsoleVariable<bool> CVarValidateGroundHeightfield(
+	TEXT("ManiacCab.ValidateGroundHeightfield"),
+	false,
+	TEXT("Trace every wheel probe the ground heightfield answers as well and count the ones that disagree. Mismatches log at Verbose."));
+
+namespace
+{
+	//Larger than the bilinear error on gentle slopes, smaller than a kerb.
+	constexpr float HeightfieldValidationTolerance = 5.0f;
+}
+#endif
+
+namespace
+{
+	//The replaying car that drives the engine's frame time, and the engine settings to restore when it stops.
+	const ACarController* ReplayClockOwner = nullptr;
+	bool SavedUseFixedTimeStep = false;
+	double SavedFixedDeltaTime = 0;
+	//Recordings store delta time in 10 microsecond units, a zero would stall the world.
+	constexpr float MinReplayDeltaTime = 1.e-4f;
+}
 
 ACarController::ACarController()
 {
 	PrimaryActorTick.bCanEverTick = true;
 	SetRootComponent(CarChassis);
+	//Movement goes through ReplicatedState instead of the generic movement replication.
+	bReplicates = true;
+	SetReplicatingMovement(false);
 }
 
 void ACarController::BeginPlay()
 {
 	Super::BeginPlay();
-	CarChassis->SetSimulatePhysics(true);
 	FollowCamera = FindComponentByClass<UCameraComponent>();
 	OriginalFloorCheckValue = FloorCheckLimit;
 	OriginalCameraFov = 90;
+	LastContactUpdateTime = GetWorld()->GetTimeSeconds();
+	DynamicsBatch.SetNumVehicles(1);
+
+	//Spawned cars did not get the chance to start loading before BeginPlay.
+	if (!AssetLoadHandle.IsValid())
+		RequestVehicleAssets();
+	if (!AssetLoadHandle.IsValid() || AssetLoadHandle->HasLoadCompleted())
+		OnVehicleAssetsLoaded();
+
+	TraceQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(CarProbeTrace), false, this);
+	AsyncTraceDelegate.BindUObject(this, &ACarController::OnAsyncTraceCompleted);
+
+	//Under async ticking the body steps on the physics thread at its own rate, so forces added from the game thread would
+	//be applied for one physics step per frame instead of for the whole frame. Every car runs the callback then.
+	if (UseFixedRatePhysics || UPhysicsSettings::Get()->bTickPhysicsAsync)
+	{
+		if (FPhysScene* physicsScene = GetWorld()->GetPhysicsScene())
+			PhysicsCallback = physicsScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FCarPhysicsCallback>();
+	}
+
+	if (HasAuthority())
+	{
+		//One snapshot goes out per net update, so the budget caps the update rate.
+		NetUpdateFrequency = GetNetSnapshotRate();
+		MinNetUpdateFrequency = FMath::Min(MinNetUpdateFrequency, NetUpdateFrequency);
+	}
+
+	ApplyNetRole();
+}
+
+void ACarController::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	if (GetWorld() != nullptr && GetWorld()->IsGameWorld())
+		RequestVehicleAssets();
+}
+
+void ACarController::RequestVehicleAssets()
+{
+	TArray<FSoftObjectPath> assets;
+	const TSoftObjectPtr<UCurveFloat> curves[] = { CarTorqueCurve, FrontWheelFrictionCurve, BackWheelFrictionCurve, FrontWheelDriftFrictionCurve, BackWheelDriftFrictionCurve };
+	for (const TSoftObjectPtr<UCurveFloat>& curve : curves)
+	{
+		if (!curve.IsNull())
+			assets.AddUnique(curve.ToSoftObjectPath());
+	}
+	for (const TPair<ECarSurfaceType, FCarSurfaceCurves>& surface : SurfaceCurves)
+	{
+		const TSoftObjectPtr<UCurveFloat> surfaceCurves[] = { surface.Value.TorqueCurve, surface.Value.FrontWheelFrictionCurve, surface.Value.BackWheelFrictionCurve,
+			surface.Value.FrontWheelDriftFrictionCurve, surface.Value.BackWheelDriftFrictionCurve };
+		for (const TSoftObjectPtr<UCurveFloat>& curve : surfaceCurves)
+		{
+			if (!curve.IsNull())
+				assets.AddUnique(curve.ToSoftObjectPath());
+		}
+	}
+	if (!TireDriftingParticleEffect.IsNull())
+		assets.AddUnique(TireDriftingParticleEffect.ToSoftObjectPath());
+	if (!SkidMarkMaterial.IsNull())
+		assets.AddUnique(SkidMarkMaterial.ToSoftObjectPath());
+
+	AssetLoadStartTime = FPlatformTime::Seconds();
+	if (assets.Num() > 0)
+	{
+		AssetLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(assets,
+			FStreamableDelegate::CreateUObject(this, &ACarController::OnVehicleAssetsLoaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+void ACarController::OnVehicleAssetsLoaded()
+{
+	//The load can finish before BeginPlay for placed cars, BeginPlay picks it up then.
+	if (VehicleReady || !HasActorBegunPlay())
+		return;
+
+	BakeCurves();
+	//Creates the pooled components and the skid mark buffer now, which also compiles the system and precaches its PSOs, rather than on the first drift.
+	if (UCarEffectsSubsystem* effects = GetWorld()->GetSubsystem<UCarEffectsSubsystem>())
+	{
+		effects->PrewarmDriftEffects(TireDriftingParticleEffect.Get(), 2);
+		effects->PrewarmSkidMarks(SkidMarkMaterial.Get());
+	}
+
+	VehicleReady = true;
+	AssetLoadHandle.Reset();
+	const float readyMs = float((FPlatformTime::Seconds() - AssetLoadStartTime) * 1000.0);
+	CSV_CUSTOM_STAT(ManiacCab, VehicleReadyMs, readyMs, ECsvCustomStatOp::Max);
+	UE_LOG(LogManiacCab, Log, TEXT("%s ready to drive %.1f ms after its assets were requested"), *GetName(), readyMs);
+	OnVehicleReady.Broadcast(this);
+}
+
+void ACarController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(ACarController, ReplicatedState);
+}
+
+void ACarController::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCarNetSnapshot snapshot = MakeSnapshot();
+	snapshot.Sequence = ReplicatedState.Sequence == MAX_uint16 ? 1 : ReplicatedState.Sequence + 1;
+	snapshot.Quantize();
+	snapshot.Baselines = &NetBaselines;
+	NetBaselines.Sent.Add(snapshot);
+	ReplicatedState = snapshot;
+}
+
+void ACarController::PostNetReceiveRole()
+{
+	Super::PostNetReceiveRole();
+	//Possession can turn a remote car into the locally controlled one after it has spawned.
+	if (HasActorBegunPlay())
+		ApplyNetRole();
+}
+
+void ACarController::ApplyNetRole()
+{
+	const bool isRemoteCar = GetLocalRole() == ROLE_SimulatedProxy;
+	CarChassis->SetSimulatePhysics(!isRemoteCar);
+
+	UVehicleManagerSubsystem* vehicleManager = GetWorld()->GetSubsystem<UVehicleManagerSubsystem>();
+	if (vehicleManager == nullptr)
+		return;
+
+	if (isRemoteCar)
+	{
+		vehicleManager->UnregisterVehicle(this);
+		SetActorTickEnabled(true);
+	}
+	else
+	{
+		vehicleManager->RegisterVehicle(this);
+	}
+}
+
+void ACarController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVehicleManagerSubsystem* vehicleManager = GetWorld()->GetSubsystem<UVehicleManagerSubsystem>())
+		vehicleManager->UnregisterVehicle(this);
+	if (AssetLoadHandle.IsValid())
+		AssetLoadHandle->CancelHandle();
+	StopRecording();
+	StopReplay();
+	IsDrifting = false;
+	UpdateDriftEffects();
+
+	if (PhysicsCallback != nullptr)
+	{
+		if (FPhysScene* physicsScene = GetWorld()->GetPhysicsScene())
+			physicsScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(PhysicsCallback);
+		PhysicsCallback = nullptr;
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 void ACarController::Tick(const float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	ManiacCab::FVehicleUpdateScope updateScope;
 
-	if (GEngine)
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		UpdateRemoteInterpolation();
+		return;
+	}
+
+#if !UE_BUILD_SHIPPING
+	if (GEngine && CVarShowInputDebug.GetValueOnGameThread() && GetVehicleBudget().DebugDraws)
 		GEngine->AddOnScreenDebugMessage(50, 5.0f, FColor::Black, TEXT("Ticking, " + InputAxis.ToString()));
+#endif
+
+	if (SimulationTier == EVehicleSimulationTier::Kinematic)
+	{
+		UpdateKinematic(DeltaTime);
+		return;
+	}
+	if (!IsUpdateDue())
+	{
+		HoldVehicleUpdate();
+		return;
+	}
+
+	PrepareVehicleUpdate(DynamicsBatch, 0);
+	if (PhysicsCallback == nullptr)
+		VehicleDynamics::Solve(DynamicsBatch, 0, 1);
+	FinishVehicleUpdate(DynamicsBatch, 0);
+}
+
+void ACarController::PrepareVehicleUpdate(FVehicleDynamicsBatch& o_Batch, int32 a_VehicleIndex)
+{
+	if (InputReplay.IsValid())
+		ApplyReplayFrame();
+	if (InputRecorder.IsValid())
+		RecordInputFrame();
+
 	HandleTurningInput();
-	UpdateAllWheels();
-	ProcessAirRotation();
+	GatherWheelState(o_Batch, a_VehicleIndex);
+
+	//The physics thread applies the forces from the state handed over here.
+	if (PhysicsCallback != nullptr)
+		PushPhysicsInput();
+}
+
+void ACarController::FinishVehicleUpdate(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex)
+{
+	UpdateAllWheels(a_Batch, a_VehicleIndex);
 	ScaleCarFOVOnSpeed();
+
+	//Reduced cars probe synchronously when they update and skip the air correction.
+	if (SimulationTier == EVehicleSimulationTier::Full)
+	{
+		ProcessAirRotation();
+		if (UseAsyncTraces)
+			SubmitAsyncTraces();
+	}
+
+	UpdateNetworking(GetWorld()->DeltaTimeSeconds);
 }
 
 void ACarController::ScaleCarFOVOnSpeed()
@@ -41,6 +306,7 @@ void ACarController::ScaleCarFOVOnSpeed()
 
 void ACarController::ProcessAirRotation()
 {
+	MANIACCAB_SCOPE(ProcessAirRotation);
 	if (IsInAir && DisableAirCorrection == false)
 	{
 		FVector goalUp = CalculateInAirRotation();
@@ -68,214 +334,602 @@ void ACarController::ProcessAirRotation()
 	}
 }
 
-void ACarController::UpdateAllWheels()
+void ACarController::UpdateAllWheels(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex)
+{
+	MANIACCAB_SCOPE(UpdateAllWheels);
+	if (PhysicsCallback == nullptr)
+		ApplyWheelForces(a_Batch, a_VehicleIndex);
+
+	UpdateContactState();
+	UpdateDriftEffects();
+	if (DriftEffectsActive)
+		AddSkidMarks();
+}
+
+void ACarController::UpdateContactState()
 {
-	const bool FrontLeftWheelOnGround = IndividualWheelUpdate(FrontLeftWheel, true);
-	const bool FrontRightWheelOnGround = IndividualWheelUpdate(FrontRightWheel, true);
-	const bool BackLeftWheelOnGround = IndividualWheelUpdate(BackLeftWheel, false);
-	const bool BackRightWheelOnGround = IndividualWheelUpdate(BackRightWheel, false);
+	//Wall clock rather than frame time, reduced cars only get here every few frames.
+	const double now = GetWorld()->GetTimeSeconds();
+	ContactStateTime += float(now - LastContactUpdateTime);
+	LastContactUpdateTime = now;
 
-	if (FrontLeftWheelOnGround == false && FrontRightWheelOnGround == false &&
-		BackLeftWheelOnGround == false && BackRightWheelOnGround == false)
+	bool anyWheelTouching = false;
+	bool anyRecentContact = false;
+	for (int32 i = 0; i < WheelCount; i++)
 	{
-		if (!GetWorld()->GetTimerManager().TimerExists(InAirTimerHandle))
-		{
-			GetWorld()->GetTimerManager().SetTimer(InAirTimerHandle, this, &ACarController::EnableAirLogic, AirLogicEnableDelay, false);
-		}
-		if (GetWorld()->GetTimerManager().TimerExists(AirFloorCheckResetTimerHandle))
-			GetWorld()->GetTimerManager().ClearTimer(AirFloorCheckResetTimerHandle);
-			
+		WheelContactHistory[i] = uint8(WheelContactHistory[i] << 1) | (WheelGrounded[i] ? 1 : 0);
+		anyWheelTouching |= (WheelContactHistory[i] & 1) != 0;
+		anyRecentContact |= (WheelContactHistory[i] & RecentContactMask) != 0;
 	}
-	else 
+
+	switch (ContactState)
 	{
-		GetWorld()->GetTimerManager().ClearTimer(InAirTimerHandle);
-		
-		if (!GetWorld()->GetTimerManager().TimerExists(AirFloorCheckResetTimerHandle))
-			GetWorld()->GetTimerManager().SetTimer(AirFloorCheckResetTimerHandle, this, &ACarController::ResetFloorCheckToOriginal, AirFloorCheckResetDelay, false);
+	case ECarContactState::Grounded:
+		if (!anyWheelTouching)
+			SetContactState(ECarContactState::Leaving);
+		break;
+	case ECarContactState::Leaving:
+		if (anyWheelTouching)
+			SetContactState(ECarContactState::Grounded);
+		else if (ContactStateTime >= AirLogicEnableDelay)
+			SetContactState(ECarContactState::Airborne);
+		break;
+	case ECarContactState::Airborne:
+		if (anyWheelTouching)
+			SetContactState(ECarContactState::Landing);
+		break;
+	case ECarContactState::Landing:
+		if (!anyRecentContact)
+			SetContactState(ECarContactState::Airborne);
+		else if (ContactStateTime >= LandingConfirmTime)
+			SetContactState(ECarContactState::Grounded);
+		break;
+	}
+}
 
+void ACarController::SetContactState(ECarContactState a_State)
+{
+	const ECarContactState previousState = ContactState;
+	ContactState = a_State;
+	ContactStateTime = 0;
+	INC_DWORD_STAT(STAT_ManiacCab_ContactStateChanges);
+
+	switch (a_State)
+	{
+	case ECarContactState::Airborne:
+		EnableAirLogic();
+		if (previousState == ECarContactState::Leaving)
+			OnTakeoff.Broadcast(this);
+		break;
+	case ECarContactState::Landing:
+		//Wheels are on the ground, so the air correction lets go straight away, only the landed event waits.
 		IsInAir = false;
 		FloorCheckLimit = OriginalFloorCheckValue;
-		if (IsDrifting && BackLeftTireDriftEffect != nullptr)
+		UpdateDriftEffects();
+		break;
+	case ECarContactState::Grounded:
+		if (previousState == ECarContactState::Landing)
+			OnLanded.Broadcast(this);
+		break;
+	default:
+		break;
+	}
+
+	OnContactStateChanged.Broadcast(this, previousState, a_State);
+}
+
+void ACarController::UpdateDriftEffects()
+{
+	const float density = GetVehicleBudget().DriftEffectsDensity;
+	const bool wantEffects = IsDrifting && !IsInAir && !UsingProxyLOD && SimulationTier != EVehicleSimulationTier::Kinematic && density > 0;
+	//The second wheel's effect follows the budget too, so a level change reaches cars that are already drifting.
+	const bool wantRightEffect = wantEffects && density >= 0.5f;
+	if (wantEffects == DriftEffectsActive && wantRightEffect == RightDriftEffectActive)
+		return;
+
+	const bool wasActive = DriftEffectsActive;
+	DriftEffectsActive = wantEffects;
+	RightDriftEffectActive = wantRightEffect;
+	UCarEffectsSubsystem* effects = GetWorld()->GetSubsystem<UCarEffectsSubsystem>();
+	if (effects == nullptr)
+		return;
+
+	if (wantEffects && !wasActive)
+		BackLeftTireDriftEffect = effects->AcquireDriftEffect(TireDriftingParticleEffect.Get(), BackLeftWheel, FVector(-10,0,-20));
+	if (wantRightEffect && BackRightTireDriftEffect == nullptr)
+		BackRightTireDriftEffect = effects->AcquireDriftEffect(TireDriftingParticleEffect.Get(), BackRightWheel, FVector::Zero());
+	else if (!wantRightEffect && BackRightTireDriftEffect != nullptr)
+	{
+		effects->ReleaseDriftEffect(BackRightTireDriftEffect);
+		BackRightTireDriftEffect = nullptr;
+	}
+
+	if (!wantEffects)
+	{
+		effects->ReleaseDriftEffect(BackLeftTireDriftEffect);
+		BackLeftTireDriftEffect = nullptr;
+		for (bool& hasSkidPoint : HasSkidPoint)
+			hasSkidPoint = false;
+	}
+}
+
+FVehicleBudget ACarController::GetVehicleBudget() const
+{
+	const UVehicleBudgetSubsystem* budget = GetWorld()->GetSubsystem<UVehicleBudgetSubsystem>();
+	return budget != nullptr && !IsPlayerControlled() ? budget->GetBudget() : FVehicleBudget();
+}
+
+void ACarController::AddSkidMarks()
+{
+	UCarEffectsSubsystem* effects = GetWorld()->GetSubsystem<UCarEffectsSubsystem>();
+	if (effects == nullptr)
+		return;
+
+	const UStaticMeshComponent* backWheels[2] = { BackLeftWheel, BackRightWheel };
+	const FVector upVector = CarChassis->GetUpVector();
+	//A sparser budget lays longer, fewer segments.
+	const float minSegmentLength = MinSkidSegmentLength / FMath::Max(GetVehicleBudget().DriftEffectsDensity, 0.25f);
+	for (int32 i = 0; i < 2; i++)
+	{
+		//The back wheels come after the front ones in WheelFloorDistances.
+		const float distanceToFloor = WheelFloorDistances[2 + i];
+		if (!WheelGrounded[2 + i])
 		{
-			BackLeftTireDriftEffect->Activate();
-			BackRightTireDriftEffect->Activate();
+			HasSkidPoint[i] = false;
+			continue;
 		}
+
+		const FVector contact = backWheels[i]->GetComponentLocation() - upVector * distanceToFloor;
+		const float segmentLengthSquared = FVector::DistSquared(contact, LastSkidPoints[i]);
+		if (HasSkidPoint[i] && segmentLengthSquared < FMath::Square(minSegmentLength))
+			continue;
+
+		//Anything longer was a teleport, start a new trail instead of bridging it.
+		if (HasSkidPoint[i] && segmentLengthSquared < FMath::Square(MaxSkidSegmentLength))
+			effects->AddSkidSegment(LastSkidPoints[i], contact, upVector, SkidMarkWidth, SkidMarkMaterial.Get());
+		LastSkidPoints[i] = contact;
+		HasSkidPoint[i] = true;
 	}
 }
 
-bool ACarController::IndividualWheelUpdate(UStaticMeshComponent* a_WheelToCheck, bool a_IsFrontWheel) const
+void ACarController::GatherWheelState(FVehicleDynamicsBatch& o_Batch, int32 a_VehicleIndex)
 {
-	float rayCastDistance = 0.0f;
-	if (WheelGroundCheck(a_WheelToCheck, rayCastDistance))
+	const UStaticMeshComponent* wheels[WheelCount] = { FrontLeftWheel, FrontRightWheel, BackLeftWheel, BackRightWheel };
+	const FVector upVector = CarChassis->GetUpVector();
+
+	FVehicleDynamicsParams& params = o_Batch.Params[a_VehicleIndex];
+	params.DeltaTime = GetWorld()->DeltaTimeSeconds;
+	params.UpVector = FVector3f(upVector);
+	params.ChassisVelocity = FVector3f(CarChassis->GetPhysicsLinearVelocity());
+
+	FTransform wheelTransforms[WheelCount];
+	FVector wheelLocations[WheelCount];
+	for (int32 i = 0; i < WheelCount; i++)
 	{
-		const FVector springForce = CalculateSpringForce(a_WheelToCheck, rayCastDistance);
-		FVector frictionForce;
+		wheelTransforms[i] = wheels[i]->GetComponentTransform();
+		wheelLocations[i] = wheelTransforms[i].GetLocation();
+	}
 
-		if (a_IsFrontWheel)
+	if (SimulationTier == EVehicleSimulationTier::Reduced)
+	{
+		SingleProbeGroundCheck(wheelLocations, upVector);
+	}
+	else
+	{
+		for (int32 i = 0; i < WheelCount; i++)
 		{
-			if (IsDrifting)
-				frictionForce = CalculateWheelFrictionForce(a_WheelToCheck, FrontWheelDriftFrictionCurve);
-			else
-				frictionForce = CalculateWheelFrictionForce(a_WheelToCheck, FrontWheelFrictionCurve);
+			WheelUsedHeightfield[i] = UseGroundHeightfield && HeightfieldGroundCheck(wheelLocations[i], upVector, WheelFloorDistances[i], WheelGrounded[i]);
+			if (!WheelUsedHeightfield[i])
+				WheelGrounded[i] = WheelGroundCheck(i, wheelLocations[i], upVector, WheelFloorDistances[i]);
 		}
-		else
+	}
+
+	if (const UCarSurfaceSubsystem* surfaces = GetWorld()->GetSubsystem<UCarSurfaceSubsystem>())
+	{
+		for (int32 i = 0; i < WheelCount; i++)
 		{
-			if (IsDrifting)	
-				frictionForce = CalculateWheelFrictionForce(a_WheelToCheck, BackWheelDriftFrictionCurve);
-			else
-				frictionForce = CalculateWheelFrictionForce(a_WheelToCheck, BackWheelFrictionCurve);
+			if (WheelGrounded[i])
+				WheelSurfaces[i] = surfaces->GetSurfaceAt(wheelLocations[i]);
 		}
+	}
 
-		const FVector accelerationForce = CalculateAccelerationForce(a_WheelToCheck);
+	//After the probes, the curves depend on the surface they found.
+	FillDynamicsParams(params);
 
-		CarChassis->AddForceAtLocation(springForce * GetWorld()->DeltaTimeSeconds * 100, a_WheelToCheck->GetComponentLocation());
-		CarChassis->AddForceAtLocation(frictionForce * GetWorld()->DeltaTimeSeconds * 100, a_WheelToCheck->GetComponentLocation());
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		const FQuat wheelRotation = wheelTransforms[i].GetRotation();
+		o_Batch.SetWheel(FVehicleDynamicsBatch::WheelIndex(a_VehicleIndex, i), FVector3f(wheelLocations[i]),
+			FVector3f(wheelRotation.GetForwardVector()), FVector3f(wheelRotation.GetRightVector()),
+			FVector3f(CarChassis->GetPhysicsLinearVelocityAtPoint(wheelLocations[i])), WheelFloorDistances[i], WheelGrounded[i]);
+	}
+}
 
-		if (AllowCarInput)
-			CarChassis->AddForceAtLocation(accelerationForce * GetWorld()->DeltaTimeSeconds * 100, a_WheelToCheck->GetComponentLocation());
+void ACarController::FillDynamicsParams(FVehicleDynamicsParams& o_Params) const
+{
+	o_Params.SpringRestDistance = SpringRestDistance;
+	o_Params.SpringStrength = SpringStrength;
+	o_Params.DampingAmount = DampingAmount;
+	o_Params.TireMass = TireMass;
+	o_Params.CarTopSpeed = CarTopSpeed;
+	o_Params.MaxTorque = MaxTorque;
+	o_Params.Throttle = AllowCarInput && VehicleReady ? InputAxis.Y : 0.0f;
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		o_Params.TorqueCurves[i] = BakedSurfaceCurves[uint8(WheelSurfaces[i])].Torque;
+		o_Params.FrictionCurves[i] = GetWheelFrictionCurve(i);
+	}
+}
 
-		return true;
+void ACarController::ApplyWheelForces(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex)
+{
+	const FTransform chassisTransform = CarChassis->GetComponentTransform();
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		const int32 wheelIndex = FVehicleDynamicsBatch::WheelIndex(a_VehicleIndex, i);
+		FHeldWheelForce& held = HeldWheelForces[i];
+		held.Grounded = a_Batch.IsGrounded(wheelIndex);
+		held.LocalForce = chassisTransform.InverseTransformVectorNoScale(FVector(a_Batch.GetForce(wheelIndex)));
+		held.LocalHeldForce = chassisTransform.InverseTransformVectorNoScale(FVector(a_Batch.GetHeldForce(wheelIndex)));
+		held.LocalPosition = chassisTransform.InverseTransformPositionNoScale(FVector(a_Batch.GetPosition(wheelIndex)));
 	}
-	return false;
+	ApplyHeldWheelForces(false);
 }
 
-bool ACarController::WheelGroundCheck(const UStaticMeshComponent* a_WheelToCheck, float& o_DistanceToFloor) const
+void ACarController::ApplyHeldWheelForces(bool a_BetweenUpdates)
 {
-	const FTransform wheelTransform = a_WheelToCheck->GetComponentTransform();
-	const FVector traceStart = wheelTransform.GetLocation() + FVector(0,0,WheelCheckHeightOffset);
-	const FVector traceEnd = wheelTransform.GetLocation() + FVector(0,0,WheelCheckHeightOffset) + (-CarChassis->GetUpVector() * (FloorCheckLimit + WheelCheckHeightOffset));
-	FHitResult hitResult;
+	int32 groundedWheels = 0;
+	for (const FHeldWheelForce& held : HeldWheelForces)
+		groundedWheels += held.Grounded ? 1 : 0;
 
-	FCollisionQueryParams queryParams;
-	queryParams.AddIgnoredActor(this);
+	if (groundedWheels == 0)
+		return;
 
-	if (GetWorld()->LineTraceSingleByChannel(hitResult, traceStart, traceEnd, TraceChannelProperty, queryParams))
+	//Without input every grounded wheel bleeds off 2% of the planar velocity.
+	if (InputAxis.SquaredLength() == 0)
+	{
+		FVector currentVel = CarChassis->GetPhysicsLinearVelocity();
+		currentVel.Z = 0;
+		currentVel *= FMath::Pow(0.98f, groundedWheels);
+		if (currentVel.SquaredLength() < 10)
+		{
+			currentVel.X = 0;
+			currentVel.Y = 0;
+		}
+		CarChassis->SetPhysicsLinearVelocity(currentVel);
+	}
+
+	const FTransform chassisTransform = CarChassis->GetComponentTransform();
+	const float forceScale = GetWorld()->DeltaTimeSeconds * 100;
+	for (const FHeldWheelForce& held : HeldWheelForces)
+	{
+		if (!held.Grounded)
+			continue;
+		const FVector& localForce = a_BetweenUpdates ? held.LocalHeldForce : held.LocalForce;
+		CarChassis->AddForceAtLocation(chassisTransform.TransformVectorNoScale(localForce) * forceScale, chassisTransform.TransformPositionNoScale(held.LocalPosition));
+	}
+}
+
+const FBakedCurve* ACarController::GetWheelFrictionCurve(int32 a_WheelIndex) const
+{
+	const FBakedSurfaceCurves& curves = BakedSurfaceCurves[uint8(WheelSurfaces[a_WheelIndex])];
+	//The front wheels come first.
+	if (a_WheelIndex < 2)
+		return IsDrifting ? curves.FrontWheelDriftFriction : curves.FrontWheelFriction;
+	return IsDrifting ? curves.BackWheelDriftFriction : curves.BackWheelFriction;
+}
+
+void ACarController::BakeCurves()
+{
+	UCurveBakingSubsystem* curveBaking = GEngine->GetEngineSubsystem<UCurveBakingSubsystem>();
+	FBakedSurfaceCurves road;
+	road.Torque = curveBaking->GetBakedCurve(CarTorqueCurve.Get());
+	road.FrontWheelFriction = curveBaking->GetBakedCurve(FrontWheelFrictionCurve.Get());
+	road.BackWheelFriction = curveBaking->GetBakedCurve(BackWheelFrictionCurve.Get());
+	road.FrontWheelDriftFriction = curveBaking->GetBakedCurve(FrontWheelDriftFrictionCurve.Get());
+	road.BackWheelDriftFriction = curveBaking->GetBakedCurve(BackWheelDriftFrictionCurve.Get());
+
+	for (int32 i = 0; i < UCarSurfaceSubsystem::SurfaceTypeCount; i++)
+	{
+		FBakedSurfaceCurves& baked = BakedSurfaceCurves[i];
+		baked = road;
+		const FCarSurfaceCurves* curves = SurfaceCurves.Find(ECarSurfaceType(i));
+		if (curves == nullptr)
+			continue;
+
+		if (!curves->TorqueCurve.IsNull())
+			baked.Torque = curveBaking->GetBakedCurve(curves->TorqueCurve.Get());
+		if (!curves->FrontWheelFrictionCurve.IsNull())
+			baked.FrontWheelFriction = curveBaking->GetBakedCurve(curves->FrontWheelFrictionCurve.Get());
+		if (!curves->BackWheelFrictionCurve.IsNull())
+			baked.BackWheelFriction = curveBaking->GetBakedCurve(curves->BackWheelFrictionCurve.Get());
+		if (!curves->FrontWheelDriftFrictionCurve.IsNull())
+			baked.FrontWheelDriftFriction = curveBaking->GetBakedCurve(curves->FrontWheelDriftFrictionCurve.Get());
+		if (!curves->BackWheelDriftFrictionCurve.IsNull())
+			baked.BackWheelDriftFriction = curveBaking->GetBakedCurve(curves->BackWheelDriftFrictionCurve.Get());
+	}
+}
+
+bool ACarController::WheelGroundCheck(int32 a_WheelIndex, const FVector& a_WheelLocation, const FVector& a_UpVector, float& o_DistanceToFloor) const
+{
+	MANIACCAB_SCOPE(WheelGroundCheck);
+	FVector traceStart;
+	FVector traceEnd;
+	GetWheelTraceSegment(a_WheelLocation, a_UpVector, traceStart, traceEnd);
+
+	const FProbeResult& asyncResult = ProbeResults[a_WheelIndex];
+	if (UseAsyncTraces && asyncResult.Ready)
+	{
+		if (asyncResult.BlockingHit)
+		{
+			//The probe was fired last tick, so project its hit onto this tick's ray to account for how far the wheel moved since.
+			const FVector traceDirection = (traceEnd - traceStart).GetSafeNormal();
+			const float distance = FMath::Max(FVector::DotProduct(asyncResult.Location - traceStart, traceDirection), 0.0f);
+			if (distance <= FloorCheckLimit + WheelCheckHeightOffset)
+			{
+				o_DistanceToFloor = distance - WheelCheckHeightOffset;
+				return true;
+			}
+		}
+		o_DistanceToFloor = 0.0f;
+		return false;
+	}
+
+	FHitResult hitResult;
+	ManiacCab::CountSyncTraces(1);
+	if (GetWorld()->LineTraceSingleByChannel(hitResult, traceStart, traceEnd, TraceChannelProperty, TraceQueryParams))
 	{
 		o_DistanceToFloor = (hitResult.Distance - WheelCheckHeightOffset);
 		return true;
 	}
 	
-	o_DistanceToFloor = -1.0f;	
+	o_DistanceToFloor = 0.0f;
 	return false;
 }
 
-void ACarController::EnableAirLogic()
+bool ACarController::HeightfieldGroundCheck(const FVector& a_WheelLocation, const FVector& a_UpVector, float& o_DistanceToFloor, bool& o_Grounded) const
 {
-	IsInAir = true;
-	FloorCheckLimit = InAirFloorCheckLimit;
-	if (BackRightTireDriftEffect != nullptr)
+	MANIACCAB_SCOPE(HeightfieldGroundCheck);
+	UCarGroundSubsystem* ground = GetWorld()->GetSubsystem<UCarGroundSubsystem>();
+	if (ground == nullptr)
+		return false;
+
+	FVector traceStart;
+	FVector traceEnd;
+	GetWheelTraceSegment(a_WheelLocation, a_UpVector, traceStart, traceEnd);
+	const FVector traceDirection = (traceEnd - traceStart).GetSafeNormal();
+	const float traceLength = FloorCheckLimit + WheelCheckHeightOffset;
+
+	//Intersect the probe with the ground plane under its start, then once more under that intersection for tilted cars.
+	FVector samplePoint = traceStart;
+	float distance = 0;
+	for (int32 pass = 0; pass < 2; pass++)
 	{
-		BackRightTireDriftEffect->Deactivate();
-		BackLeftTireDriftEffect->Deactivate();
+		float height;
+		FVector normal;
+		if (!ground->SampleGround(samplePoint, traceLength, TraceChannelProperty, this, height, normal))
+			return false;
+
+		const float approach = FVector::DotProduct(traceDirection, normal);
+		if (approach > -UE_KINDA_SMALL_NUMBER)
+			return false;
+		distance = FVector::DotProduct(FVector(samplePoint.X, samplePoint.Y, height) - traceStart, normal) / approach;
+		//Ground above the probe start is something the bake did not see coming, let the trace sort it out.
+		if (distance < 0)
+			return false;
+		samplePoint = traceStart + traceDirection * FMath::Min(distance, traceLength);
 	}
-	EnableCarInput(true);
-}
 
-void ACarController::ResetFloorCheckToOriginal()
-{
-	FloorCheckLimit = OriginalFloorCheckValue;
+	o_Grounded = distance <= traceLength;
+	o_DistanceToFloor = o_Grounded ? distance - WheelCheckHeightOffset : 0.0f;
+
+#if !UE_BUILD_SHIPPING
+	if (CVarValidateGroundHeightfield.GetValueOnGameThread())
+	{
+		INC_DWORD_STAT(STAT_ManiacCab_HeightfieldValidations);
+		FHitResult hitResult;
+		ManiacCab::CountSyncTraces(1);
+		const bool tracedGrounded = GetWorld()->LineTraceSingleByChannel(hitResult, traceStart, traceEnd, TraceChannelProperty, TraceQueryParams);
+		const float tracedDistance = tracedGrounded ? hitResult.Distance - WheelCheckHeightOffset : 0.0f;
+		if (tracedGrounded != o_Grounded || FMath::Abs(tracedDistance - o_DistanceToFloor) > HeightfieldValidationTolerance)
+		{
+			INC_DWORD_STAT(STAT_ManiacCab_HeightfieldMismatches);
+			UE_LOG(LogManiacCab, Verbose, TEXT("%s: heightfield probe at %s gave %.1f, trace gave %.1f"),
+				*GetName(), *traceStart.ToString(), o_DistanceToFloor, tracedDistance);
+		}
+	}
+#endif
+	return true;
 }
 
-FVector ACarController::CalculateInAirRotation() const
+void ACarController::SingleProbeGroundCheck(const FVector (&a_WheelLocations)[WheelCount], const FVector& a_UpVector)
 {
-	FVector averageNormal = FVector::Zero();
-	int raysHit = 0;
-	FHitResult rayCastHit;
-	FVector TraceDirection =  CarChassis->GetPhysicsLinearVelocity();
-	//Remove height so it doesnt factor into direction.
-	TraceDirection.Z = 0;
-	TraceDirection.Normalize();
-	const FVector TraceStartLocation = CarChassis->GetComponentLocation() + CarChassis->GetForwardVector() * 10;
-	FVector velocityRightVector = FVector::CrossProduct(TraceDirection, FVector(0,0,1));
-	velocityRightVector.Normalize();
-	//Flip its direction so the rotation angle is a positive degree.
-	velocityRightVector = -velocityRightVector;
-	TraceDirection = TraceDirection.RotateAngleAxis(10, velocityRightVector);
+	FVector center = FVector::ZeroVector;
+	for (const FVector& wheelLocation : a_WheelLocations)
+		center += wheelLocation / WheelCount;
 
-	FCollisionQueryParams queryParams;
-	queryParams.AddIgnoredActor(this);
+	//Longer than a wheel probe so the plane is still found under a tilted car.
+	FVector traceStart;
+	FVector traceEnd;
+	GetWheelTraceSegment(center, a_UpVector, traceStart, traceEnd);
+	traceEnd = traceStart + (traceEnd - traceStart) * 1.5f;
+
+	FHitResult hitResult;
+	ManiacCab::CountSyncTraces(1);
+	const bool hit = GetWorld()->LineTraceSingleByChannel(hitResult, traceStart, traceEnd, TraceChannelProperty, TraceQueryParams);
 
-	FVector averageHitLocation = FVector::Zero();
-	for (int i = 0; i < 5; i++)
+	for (int32 i = 0; i < WheelCount; i++)
 	{
-		if (GetWorld()->LineTraceSingleByChannel(rayCastHit, TraceStartLocation, TraceStartLocation + TraceDirection * 5000, TraceChannelProperty, queryParams))
+		WheelFloorDistances[i] = 0.0f;
+		WheelGrounded[i] = false;
+		if (!hit)
+			continue;
+
+		FVector wheelStart;
+		FVector wheelEnd;
+		GetWheelTraceSegment(a_WheelLocations[i], a_UpVector, wheelStart, wheelEnd);
+		const float approach = FVector::DotProduct(-a_UpVector, hitResult.ImpactNormal);
+		if (approach > -UE_KINDA_SMALL_NUMBER)
+			continue;
+
+		//Where this wheel's probe would have met the plane of the hit.
+		const float distance = FVector::DotProduct(hitResult.ImpactPoint - wheelStart, hitResult.ImpactNormal) / approach;
+		if (distance >= 0 && distance <= FloorCheckLimit + WheelCheckHeightOffset)
 		{
-			if (rayCastHit.Normal.Dot(FVector::UpVector) > 0.2f)
-			{
-				averageNormal += rayCastHit.Normal;
-				averageHitLocation += rayCastHit.Location;
-				raysHit++;
-			}
+			WheelFloorDistances[i] = distance - WheelCheckHeightOffset;
+			WheelGrounded[i] = true;
 		}
-		TraceDirection = TraceDirection.RotateAngleAxis(PerAirTraceAngle, velocityRightVector);
 	}
+}
 
-	averageHitLocation /= raysHit;
-	averageNormal.Normalize();
-	return averageNormal;
+void ACarController::GetWheelTraceSegment(const FVector& a_WheelLocation, const FVector& a_UpVector, FVector& o_TraceStart, FVector& o_TraceEnd) const
+{
+	o_TraceStart = a_WheelLocation + FVector(0,0,WheelCheckHeightOffset);
+	o_TraceEnd = o_TraceStart + (-a_UpVector * (FloorCheckLimit + WheelCheckHeightOffset));
 }
 
-FVector ACarController::CalculateSpringForce(const UStaticMeshComponent* a_Wheel, const float a_DistanceToFloor) const
+void ACarController::PushPhysicsInput() const
 {
-	FVector springDirection = CarChassis->GetUpVector();
-	FVector tireWorldVel = CarChassis->GetPhysicsLinearVelocityAtPoint(a_Wheel->GetComponentLocation());
-	float offset = SpringRestDistance - a_DistanceToFloor;
-	float vel = FVector::DotProduct(springDirection, tireWorldVel);
-	float force = (offset * SpringStrength) - (vel * DampingAmount);
-	
-	FVector forceToApply = force * springDirection;
-	forceToApply.X = 0;
-	forceToApply.Y = 0;
-	return forceToApply;
+	FCarPhysicsInput* input = PhysicsCallback->GetProducerInputData_External();
+	if (input == nullptr)
+		return;
+
+	const UStaticMeshComponent* wheels[WheelCount] = { FrontLeftWheel, FrontRightWheel, BackLeftWheel, BackRightWheel };
+	const FTransform chassisTransform = CarChassis->GetComponentTransform();
+	const FQuat inverseChassisRotation = chassisTransform.GetRotation().Inverse();
+
+	input->ChassisProxy = CarChassis->GetBodyInstance()->GetPhysicsActorHandle();
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		FCarPhysicsWheelInput& wheelInput = input->Wheels[i];
+		wheelInput.LocalPosition = chassisTransform.InverseTransformPositionNoScale(wheels[i]->GetComponentLocation());
+		wheelInput.LocalRotation = inverseChassisRotation * wheels[i]->GetComponentQuat();
+		wheelInput.DistanceToFloor = WheelFloorDistances[i];
+		wheelInput.Grounded = WheelGrounded[i];
+	}
+
+	input->InputAxis = InputAxis;
+	FillDynamicsParams(input->Params);
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		const FBakedCurve* frictionCurve = input->Params.FrictionCurves[i];
+		const FBakedCurve* torqueCurve = input->Params.TorqueCurves[i];
+		input->FrictionCurves[i] = frictionCurve != nullptr ? *frictionCurve : FBakedCurve();
+		input->TorqueCurves[i] = torqueCurve != nullptr ? *torqueCurve : FBakedCurve();
+		input->Params.FrictionCurves[i] = nullptr;
+		input->Params.TorqueCurves[i] = nullptr;
+	}
 }
 
-FVector ACarController::CalculateWheelFrictionForce(const UStaticMeshComponent* a_Wheel, const UCurveFloat* a_FrictionCurve) const
+void ACarController::SubmitAsyncTraces()
 {
-	FVector steeringDir;
-	FVector tireWorldVel = CarChassis->GetPhysicsLinearVelocityAtPoint(a_Wheel->GetComponentLocation());
+	UWorld* world = GetWorld();
+	const UStaticMeshComponent* wheels[WheelCount] = { FrontLeftWheel, FrontRightWheel, BackLeftWheel, BackRightWheel };
+	const FVector upVector = CarChassis->GetUpVector();
 
-	float dotRight = FVector::DotProduct(tireWorldVel, a_Wheel->GetRightVector());
-	float dotLeft = FVector::DotProduct(tireWorldVel, -a_Wheel->GetRightVector());
+	//Anything not resubmitted this tick falls back to a synchronous trace next tick rather than reading stale data.
+	for (FProbeResult& result : ProbeResults)
+		result.Ready = false;
 
-	if (dotRight > dotLeft)
-		steeringDir = a_Wheel->GetRightVector();
-	else
-		steeringDir = -a_Wheel->GetRightVector();
-	
-	float steeringVel = FVector::DotProduct(steeringDir, tireWorldVel);
+	int32 submitted = 0;
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		//Most likely answered by the heightfield again, a miss falls back to a synchronous trace.
+		if (WheelUsedHeightfield[i])
+			continue;
 
-	float desiredVelChange = -steeringVel * a_FrictionCurve->GetFloatValue(FVector::DotProduct(steeringDir.GetSafeNormal(), tireWorldVel.GetSafeNormal()));
-	float desiredAcceleration = desiredVelChange / GetWorld()->DeltaTimeSeconds;
-	return steeringDir * TireMass * desiredAcceleration;
+		FVector traceStart;
+		FVector traceEnd;
+		GetWheelTraceSegment(wheels[i]->GetComponentLocation(), upVector, traceStart, traceEnd);
+		world->AsyncLineTraceByChannel(EAsyncTraceType::Single, traceStart, traceEnd, TraceChannelProperty, TraceQueryParams,
+			FCollisionResponseParams::DefaultResponseParam, &AsyncTraceDelegate, i);
+		submitted++;
+	}
+	ManiacCab::CountAsyncTraces(submitted);
 }
 
-FVector ACarController::CalculateAccelerationForce(UStaticMeshComponent* a_Wheel) const
+void ACarController::OnAsyncTraceCompleted(const FTraceHandle& a_Handle, FTraceDatum& a_Datum)
 {
-	if (InputAxis.SquaredLength() == 0)
+	if (a_Datum.UserData >= WheelCount)
+		return;
+
+	FProbeResult& result = ProbeResults[a_Datum.UserData];
+	result.BlockingHit = a_Datum.OutHits.Num() > 0 && a_Datum.OutHits[0].bBlockingHit;
+	if (result.BlockingHit)
 	{
-		FVector currentVel = CarChassis->GetPhysicsLinearVelocity();
-		currentVel.Z = 0;
-		currentVel *= 0.98f;
-		if (currentVel.SquaredLength() < 10)
+		result.Location = a_Datum.OutHits[0].Location;
+	}
+	result.Ready = true;
+}
+
+void ACarController::EnableAirLogic()
+{
+	IsInAir = true;
+	FloorCheckLimit = InAirFloorCheckLimit;
+	UpdateDriftEffects();
+	EnableCarInput(true);
+	PredictLanding();
+}
+
+void ACarController::PredictLanding()
+{
+	const UWorld* world = GetWorld();
+	LandingPrediction.LaunchLocation = CarChassis->GetComponentLocation();
+	LandingPrediction.LaunchVelocity = CarChassis->GetPhysicsLinearVelocity();
+	LandingPrediction.LaunchTime = world->GetTimeSeconds();
+	LandingPrediction.Valid = false;
+	INC_DWORD_STAT(STAT_ManiacCab_LandingPredictions);
+
+	const FVector gravity(0, 0, world->GetGravityZ());
+	const int32 segments = FMath::Max(FMath::RoundToInt(LandingPredictionSegments * GetVehicleBudget().AirProbeScale), 1);
+	const float segmentTime = LandingPredictionTime / segments;
+	FVector segmentStart = LandingPrediction.LaunchLocation;
+	FHitResult hit;
+	for (int32 i = 1; i <= segments; i++)
+	{
+		const float time = segmentTime * i;
+		const FVector segmentEnd = LandingPrediction.LaunchLocation + LandingPrediction.LaunchVelocity * time + 0.5f * gravity * time * time;
+		ManiacCab::CountSyncTraces(1);
+		//Walls along the way are skipped, the car is only turned to match something it can land on.
+		if (world->LineTraceSingleByChannel(hit, segmentStart, segmentEnd, TraceChannelProperty, TraceQueryParams) && hit.Normal.Dot(FVector::UpVector) > 0.2f)
 		{
-			currentVel.X = 0;
-			currentVel.Y = 0;
+			LandingPrediction.Location = hit.Location;
+			LandingPrediction.Normal = hit.Normal;
+			LandingPrediction.FlightTime = segmentTime * (i - 1 + hit.Time);
+			LandingPrediction.Valid = true;
+			return;
 		}
-		CarChassis->SetPhysicsLinearVelocity(currentVel);
+		segmentStart = segmentEnd;
 	}
+}
 
-	float powerCurve = FMath::Clamp(FVector::DotProduct(CarChassis->GetPhysicsLinearVelocity(),a_Wheel->GetForwardVector())/ CarTopSpeed, 0, 1);
+void ACarController::RefineLandingPrediction()
+{
+	const float elapsed = float(GetWorld()->GetTimeSeconds() - LandingPrediction.LaunchTime);
+	if (!LandingPrediction.Valid)
+	{
+		//Nothing under the arc yet, e.g. launched off the edge of the level. Look again every so often.
+		if (elapsed >= LandingRetryInterval)
+			PredictLanding();
+		return;
+	}
 
-	powerCurve = CarTorqueCurve->GetFloatValue(powerCurve);
-	powerCurve = powerCurve * MaxTorque;
-	powerCurve = InputAxis.Y * powerCurve;
+	const FVector expectedVelocity = LandingPrediction.LaunchVelocity + FVector(0, 0, GetWorld()->GetGravityZ() * elapsed);
+	if (FVector::DistSquared(CarChassis->GetPhysicsLinearVelocity(), expectedVelocity) > FMath::Square(LandingPredictionTolerance))
+		PredictLanding();
+}
 
-	return a_Wheel->GetForwardVector() * powerCurve;
+FVector ACarController::CalculateInAirRotation()
+{
+	MANIACCAB_SCOPE(CalculateInAirRotation);
+	RefineLandingPrediction();
+	return LandingPrediction.Valid ? LandingPrediction.Normal : FVector::UpVector;
 }
 
 void ACarController::HandleTurningInput() const 
 {
-	if (AllowCarInput == false)
+	MANIACCAB_SCOPE(HandleTurningInput);
+	if (AllowCarInput == false || VehicleReady == false)
 		return;
 	
 	FVector rotateVector = CarChassis->GetForwardVector().RotateAngleAxis(InputAxis.X * MaxTurnAngle, CarChassis->GetRelativeTransform().GetUnitAxis(EAxis::Z));
@@ -292,7 +946,7 @@ void ACarController::HandleTurningInput() const
 
 void ACarController::SteeringAction(const FInputActionValue& a_Value)
 {
-	if (Controller == nullptr)
+	if ((Controller == nullptr && !ApplyingReplayInput) || !AcceptsHandlerInput())
 		return;
 	InputAxis.X = a_Value.Get<float>();
 	if (FMath::Abs(InputAxis.X) < 0.1f)
@@ -301,54 +955,57 @@ void ACarController::SteeringAction(const FInputActionValue& a_Value)
 
 void ACarController::BreakAction(const FInputActionValue& a_Value)
 {
-	if (Controller == nullptr)
+	if ((Controller == nullptr && !ApplyingReplayInput) || !AcceptsHandlerInput())
 		return;
 	InputAxis.Y = -a_Value.Get<float>();
 }
 
 void ACarController::ThrottleAction(const FInputActionValue& a_Value)
 {
-	if (Controller == nullptr)
+	if ((Controller == nullptr && !ApplyingReplayInput) || !AcceptsHandlerInput())
 		return;
 	InputAxis.Y = a_Value.Get<float>();
 }
 
-void ACarController::HandBrakeActionPressed(const FInputActionValue& a_Value)
+void ACarController::SetScriptedInput(float a_Steering, float a_Throttle, bool a_HandBrake)
 {
-	IsDrifting = true;
+	InputAxis.X = FMath::Abs(a_Steering) < 0.1f ? 0 : a_Steering;
+	InputAxis.Y = a_Throttle;
 
-	if (BackLeftTireDriftEffect == nullptr)
-	{
-		BackLeftTireDriftEffect = UNiagaraFunctionLibrary::SpawnSystemAttached(TireDriftingParticleEffect, BackLeftWheel, NAME_None, FVector(-10,0,-20),FRotator::ZeroRotator, EAttachLocation::Type::SnapToTarget, false);
-		BackRightTireDriftEffect = UNiagaraFunctionLibrary::SpawnSystemAttached(TireDriftingParticleEffect, BackRightWheel, NAME_None, FVector::Zero(), FRotator::ZeroRotator, EAttachLocation::Type::SnapToTarget, false);
+	SetDrifting(a_HandBrake);
+}
 
-		if (IsInAir)
-		{
-			BackLeftTireDriftEffect->Deactivate();
-			BackRightTireDriftEffect->Deactivate();
-		}
-	}
-	else if (IsInAir == false)
-	{
-		BackLeftTireDriftEffect->Activate();
-		BackRightTireDriftEffect->Activate();
-	}
+void ACarController::SetDrifting(bool a_Drifting)
+{
+	if (a_Drifting && !IsDrifting)
+		HandBrakeActionPressed(FInputActionValue(true));
+	else if (!a_Drifting && IsDrifting)
+		HandBrakeActionReleased(FInputActionValue(false));
+}
+
+void ACarController::HandBrakeActionPressed(const FInputActionValue& a_Value)
+{
+	if (!AcceptsHandlerInput())
+		return;
+	IsDrifting = true;
+	UpdateDriftEffects();
 }
 
 void ACarController::HandBrakeActionReleased(const FInputActionValue& a_Value)
 {
+	if (!AcceptsHandlerInput())
+		return;
 	IsDrifting = false;
 	HoldingSpace = false;
-
-	if (BackRightTireDriftEffect != nullptr)
-	{
-		BackRightTireDriftEffect->Deactivate();
-		BackLeftTireDriftEffect->Deactivate();
-	}
+	UpdateDriftEffects();
 }
 
 void ACarController::ResetCarActionPressed(const FInputActionValue& a_Value)
 {
+	if (!AcceptsHandlerInput())
+		return;
+	PendingResetEvent = true;
+
 	CarChassis->SetPhysicsLinearVelocity(FVector(0,0,0));
 	CarChassis->SetPhysicsAngularVelocityInDegrees(FVector(0,0,0));
 	CarChassis->AddLocalOffset(FVector(0,0,200));
@@ -356,6 +1013,502 @@ void ACarController::ResetCarActionPressed(const FInputActionValue& a_Value)
 	rotation.Pitch = 0;
 	rotation.Roll = 0;
 	CarChassis->SetWorldRotation(rotation);
+
+	//Predicted locally, the server does the same reset and corrects us if it ends up elsewhere.
+	if (GetLocalRole() == ROLE_AutonomousProxy)
+	{
+		PendingCorrection = FVector::ZeroVector;
+		ServerResetCar();
+	}
+}
+
+bool ACarController::StartRecording(const FString& a_Path)
+{
+	InputRecorder = MakeUnique<FCarInputRecorder>();
+	if (!InputRecorder->Open(a_Path))
+	{
+		InputRecorder.Reset();
+		return false;
+	}
+	RecordedFrameCount = 0;
+	PendingResetEvent = false;
+	return true;
+}
+
+void ACarController::StopRecording()
+{
+	InputRecorder.Reset();
+}
+
+bool ACarController::StartReplay(const FString& a_Path)
+{
+	StopReplay();
+	InputReplay = MakeUnique<FCarReplayReader>();
+	if (!InputReplay->Open(a_Path) || !InputReplay->ReadFrame(NextReplayFrame))
+	{
+		InputReplay.Reset();
+		return false;
+	}
+	HasNextReplayFrame = true;
+
+	//The engine steps by the recorded delta times while replaying, hitches included, so the replay does not depend on the
+	//frame rate of the machine playing it back. One engine clock, so the first car to start replaying owns it.
+	if (ReplayClockOwner == nullptr)
+	{
+		ReplayClockOwner = this;
+		SavedUseFixedTimeStep = FApp::UseFixedTimeStep();
+		SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(FMath::Max(NextReplayFrame.DeltaTime, MinReplayDeltaTime));
+	}
+	return true;
+}
+
+void ACarController::StopReplay()
+{
+	InputReplay.Reset();
+	HasNextReplayFrame = false;
+	if (ReplayClockOwner == this)
+	{
+		FApp::SetUseFixedTimeStep(SavedUseFixedTimeStep);
+		FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+		ReplayClockOwner = nullptr;
+	}
+}
+
+void ACarController::EnterProxyLOD()
+{
+	if (UsingProxyLOD)
+		return;
+
+	UsingProxyLOD = true;
+	if (UVehicleManagerSubsystem* vehicleManager = GetWorld()->GetSubsystem<UVehicleManagerSubsystem>())
+		vehicleManager->UnregisterVehicle(this);
+	SetActorTickEnabled(false);
+	CarChassis->SetSimulatePhysics(false);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	UpdateDriftEffects();
+}
+
+void ACarController::ExitProxyLOD(const FTransform& a_ChassisTransform, const FVector& a_LinearVelocity, const FVector& a_AngularVelocity)
+{
+	if (!UsingProxyLOD)
+		return;
+
+	UsingProxyLOD = false;
+	SimulationTier = EVehicleSimulationTier::Full;
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	CarChassis->SetWorldLocationAndRotation(a_ChassisTransform.GetLocation(), a_ChassisTransform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+
+	//Probes fired before the handoff are from another place.
+	for (FProbeResult& result : ProbeResults)
+		result.Ready = false;
+
+	SetActorTickEnabled(true);
+	ApplyNetRole();
+	CarChassis->SetPhysicsLinearVelocity(a_LinearVelocity);
+	CarChassis->SetPhysicsAngularVelocityInDegrees(a_AngularVelocity);
+}
+
+void ACarController::SetSimulationTier(EVehicleSimulationTier a_Tier)
+{
+	if (a_Tier == SimulationTier)
+		return;
+
+	const EVehicleSimulationTier previousTier = SimulationTier;
+	if (a_Tier == EVehicleSimulationTier::Kinematic)
+	{
+		KinematicVelocity = CarChassis->GetPhysicsLinearVelocity();
+		KinematicVelocity.Z = 0;
+		KinematicYawRate = CarChassis->GetPhysicsAngularVelocityInDegrees().Z;
+		KinematicRideHeight = GetRideHeight();
+		CarChassis->SetSimulatePhysics(false);
+	}
+	else if (previousTier == EVehicleSimulationTier::Kinematic)
+	{
+		CarChassis->SetSimulatePhysics(true);
+		CarChassis->SetPhysicsLinearVelocity(KinematicVelocity);
+		CarChassis->SetPhysicsAngularVelocityInDegrees(FVector(0, 0, KinematicYawRate));
+	}
+
+	SimulationTier = a_Tier;
+	UpdateDriftEffects();
+	//Stagger reduced cars so their updates do not all land on the same frame.
+	ReducedFrameCounter = GetUniqueID();
+	for (FProbeResult& result : ProbeResults)
+		result.Ready = false;
+}
+
+bool ACarController::IsUpdateDue()
+{
+	if (SimulationTier != EVehicleSimulationTier::Reduced)
+		return true;
+	return ReducedFrameCounter++ % ReducedUpdateInterval == 0;
+}
+
+void ACarController::HoldVehicleUpdate()
+{
+	if (PhysicsCallback != nullptr)
+		PushPhysicsInput();
+	else
+		ApplyHeldWheelForces(true);
+}
+
+void ACarController::UpdateKinematic(float a_DeltaTime)
+{
+	//No route to follow yet, so the car holds its speed and lets the turn it had die out, as proxied cars do.
+	KinematicYawRate *= FMath::Exp(-a_DeltaTime / KinematicYawDecayTime);
+	const FQuat turn(FVector::UpVector, FMath::DegreesToRadians(KinematicYawRate * a_DeltaTime));
+	KinematicVelocity = turn.RotateVector(KinematicVelocity);
+
+	FVector location = CarChassis->GetComponentLocation() + KinematicVelocity * a_DeltaTime;
+	//The ground is found on the staggered reduced update frames, the height holds in between.
+	float groundHeight;
+	if (ReducedFrameCounter++ % ReducedUpdateInterval == 0 && FindGroundHeight(location, groundHeight))
+		location.Z = groundHeight + KinematicRideHeight;
+	CarChassis->SetWorldLocationAndRotation(location, turn * CarChassis->GetComponentQuat(), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+bool ACarController::FindGroundHeight(const FVector& a_Location, float& o_Height) const
+{
+	FVector normal;
+	UCarGroundSubsystem* ground = GetWorld()->GetSubsystem<UCarGroundSubsystem>();
+	//A sample above the search start is a surface the trace would start under, it finds whatever is below instead.
+	if (UseGroundHeightfield && ground != nullptr && ground->SampleGround(a_Location, GroundSearchHeight * 2, TraceChannelProperty, this, o_Height, normal)
+		&& o_Height <= a_Location.Z + GroundSearchHeight)
+		return true;
+
+	FHitResult hitResult;
+	ManiacCab::CountSyncTraces(1);
+	const FVector searchOffset(0, 0, GroundSearchHeight);
+	if (!GetWorld()->LineTraceSingleByChannel(hitResult, a_Location + searchOffset, a_Location - searchOffset, TraceChannelProperty, TraceQueryParams))
+		return false;
+	o_Height = hitResult.ImpactPoint.Z;
+	return true;
+}
+
+float ACarController::GetRideHeight() const
+{
+	const UStaticMeshComponent* wheels[WheelCount] = { FrontLeftWheel, FrontRightWheel, BackLeftWheel, BackRightWheel };
+	const float chassisHeight = CarChassis->GetComponentLocation().Z;
+	float rideHeight = 0;
+	int32 groundedWheels = 0;
+	for (int32 i = 0; i < WheelCount; i++)
+	{
+		if (!WheelGrounded[i])
+			continue;
+		rideHeight += chassisHeight - wheels[i]->GetComponentLocation().Z + WheelFloorDistances[i];
+		groundedWheels++;
+	}
+	if (groundedWheels > 0)
+		return rideHeight / groundedWheels;
+
+	for (const UStaticMeshComponent* wheel : wheels)
+		rideHeight += (chassisHeight - wheel->GetComponentLocation().Z + SpringRestDistance) / WheelCount;
+	return rideHeight;
+}
+
+FVector ACarController::GetChassisLinearVelocity() const
+{
+	return SimulationTier == EVehicleSimulationTier::Kinematic ? KinematicVelocity : CarChassis->GetPhysicsLinearVelocity();
+}
+
+FVector ACarController::GetChassisAngularVelocity() const
+{
+	return SimulationTier == EVehicleSimulationTier::Kinematic ? FVector(0, 0, KinematicYawRate) : CarChassis->GetPhysicsAngularVelocityInDegrees();
+}
+
+void ACarController::GetPredictedPath(float a_LookAheadTime, TArray<FVector>& o_Path) const
+{
+	o_Path.Reset();
+	const int32 points = FMath::Max(StreamingPathPoints, 1);
+	const float step = a_LookAheadTime / points;
+	const FVector location = CarChassis->GetComponentLocation();
+	const FVector velocity = GetChassisLinearVelocity();
+
+	if (IsInAir && LandingPrediction.Valid)
+	{
+		const FVector gravity(0, 0, GetWorld()->GetGravityZ());
+		const FVector& launch = LandingPrediction.LaunchLocation;
+		const FVector& launchVelocity = LandingPrediction.LaunchVelocity;
+		const float elapsed = float(GetWorld()->GetTimeSeconds() - LandingPrediction.LaunchTime);
+		for (int32 i = 1; i <= points; i++)
+		{
+			const float time = elapsed + step * i;
+			if (time < LandingPrediction.FlightTime)
+				o_Path.Add(launch + launchVelocity * time + 0.5f * gravity * time * time);
+			else
+				//After the landing the car carries on with the speed it had over the ground.
+				o_Path.Add(LandingPrediction.Location + FVector(launchVelocity.X, launchVelocity.Y, 0) * (time - LandingPrediction.FlightTime));
+		}
+		return;
+	}
+
+	//The chord of a constant rate turn points halfway through it. Capped so a spinning car does not predict a loop.
+	const float yawRate = GetChassisAngularVelocity().Z;
+	for (int32 i = 1; i <= points; i++)
+	{
+		const float time = step * i;
+		const float chordYaw = FMath::Clamp(yawRate * time * 0.5f, -90.0f, 90.0f);
+		o_Path.Add(location + velocity.RotateAngleAxis(chordYaw, FVector::UpVector) * time);
+	}
+}
+
+void ACarController::RecordInputFrame()
+{
+	FCarInputFrame frame;
+	frame.Steering = InputAxis.X;
+	frame.Throttle = InputAxis.Y;
+	frame.DeltaTime = GetWorld()->DeltaTimeSeconds;
+	frame.Drifting = IsDrifting;
+	frame.Reset = PendingResetEvent;
+	frame.HasKeyframe = RecordedFrameCount % FMath::Max(RecordingKeyframeInterval, 1) == 0;
+	if (frame.HasKeyframe)
+	{
+		frame.Keyframe.Location = FVector3f(CarChassis->GetComponentLocation());
+		frame.Keyframe.Rotation = FQuat4f(CarChassis->GetComponentQuat());
+		frame.Keyframe.LinearVelocity = FVector3f(CarChassis->GetPhysicsLinearVelocity());
+		frame.Keyframe.AngularVelocity = FVector3f(CarChassis->GetPhysicsAngularVelocityInDegrees());
+	}
+
+	InputRecorder->RecordFrame(frame);
+	PendingResetEvent = false;
+	RecordedFrameCount++;
+}
+
+void ACarController::ApplyReplayFrame()
+{
+	if (!HasNextReplayFrame)
+	{
+		UE_LOG(LogManiacCab, Log, TEXT("%s finished replaying its recording"), *GetName());
+		StopReplay();
+		return;
+	}
+
+	//This tick was stepped by the frame's recorded delta time, the one after it gets the next frame's.
+	const FCarInputFrame frame = NextReplayFrame;
+	HasNextReplayFrame = InputReplay->ReadFrame(NextReplayFrame);
+	if (HasNextReplayFrame && ReplayClockOwner == this)
+		FApp::SetFixedDeltaTime(FMath::Max(NextReplayFrame.DeltaTime, MinReplayDeltaTime));
+
+	TGuardValue<bool> applyingReplay(ApplyingReplayInput, true);
+	if (frame.Reset)
+		ResetCarActionPressed(FInputActionValue(true));
+	if (frame.HasKeyframe && ReplaySnapToKeyframes)
+	{
+		CarChassis->SetWorldLocationAndRotation(FVector(frame.Keyframe.Location), FQuat(frame.Keyframe.Rotation), false, nullptr, ETeleportType::TeleportPhysics);
+		CarChassis->SetPhysicsLinearVelocity(FVector(frame.Keyframe.LinearVelocity));
+		CarChassis->SetPhysicsAngularVelocityInDegrees(FVector(frame.Keyframe.AngularVelocity));
+	}
+
+	SteeringAction(FInputActionValue(frame.Steering));
+	ThrottleAction(FInputActionValue(frame.Throttle));
+	SetDrifting(frame.Drifting);
+}
+
+void ACarController::UpdateNetworking(float a_DeltaTime)
+{
+	if (GetNetMode() == NM_Standalone)
+		return;
+
+	//The server's snapshot is taken in PreReplication.
+	if (HasAuthority())
+		return;
+
+	if (GetLocalRole() != ROLE_AutonomousProxy)
+		return;
+
+	//Blend out the error found by the last reconcile instead of popping the chassis.
+	if (!PendingCorrection.IsNearlyZero())
+	{
+		const FVector step = PendingCorrection * FMath::Min(a_DeltaTime * NetCorrectionSpeed, 1.0f);
+		CarChassis->AddWorldOffset(step, false, nullptr, ETeleportType::TeleportPhysics);
+		PendingCorrection -= step;
+		AppliedCorrection += step;
+	}
+
+	//Input goes up at the rate snapshots come down, the server holds the last input it got in between.
+	const float sendInterval = 1.0f / GetNetSnapshotRate();
+	NetInputSendTimer += a_DeltaTime;
+	if (NetInputSendTimer < sendInterval)
+		return;
+	NetInputSendTimer = FMath::Fmod(NetInputSendTimer, sendInterval);
+
+	FCarNetInput input;
+	input.Sequence = ++NetInputSequence;
+	input.Steering = int8(FMath::RoundToInt(FMath::Clamp(InputAxis.X, -1.0f, 1.0f) * 127.0f));
+	input.Throttle = int8(FMath::RoundToInt(FMath::Clamp(InputAxis.Y, -1.0f, 1.0f) * 127.0f));
+	input.Drifting = IsDrifting;
+	ServerSendInput(input);
+
+	FPredictedState& predicted = PredictionHistory[input.Sequence % PredictionHistorySize];
+	predicted.Sequence = input.Sequence;
+	predicted.Location = CarChassis->GetComponentLocation() - AppliedCorrection;
+	predicted.Valid = true;
+}
+
+void ACarController::UpdateRemoteInterpolation()
+{
+	if (InterpolationSampleCount == 0)
+		return;
+
+	const double renderTime = GetServerTime() - NetInterpolationDelay;
+	int32 from = 0;
+	while (from + 1 < InterpolationSampleCount && InterpolationBuffer[from + 1].ServerTime <= renderTime)
+		from++;
+
+	const FCarNetSnapshot& fromSnapshot = InterpolationBuffer[from];
+	FCarNetSnapshot pose = fromSnapshot;
+	if (from + 1 < InterpolationSampleCount)
+	{
+		const FCarNetSnapshot& toSnapshot = InterpolationBuffer[from + 1];
+		const float alpha = FMath::Clamp((renderTime - fromSnapshot.ServerTime) / (toSnapshot.ServerTime - fromSnapshot.ServerTime), 0.0, 1.0);
+		pose.Location = FMath::Lerp(fromSnapshot.Location, toSnapshot.Location, alpha);
+		pose.Rotation = FQuat::Slerp(fromSnapshot.Rotation.Quaternion(), toSnapshot.Rotation.Quaternion(), alpha).Rotator();
+		pose.SteerAngle = FMath::Lerp(fromSnapshot.SteerAngle, toSnapshot.SteerAngle, alpha);
+	}
+	else
+	{
+		//Snapshots stopped arriving, keep the car moving for a moment rather than freezing it.
+		const double extrapolation = FMath::Min(renderTime - fromSnapshot.ServerTime, 0.25);
+		if (extrapolation > 0)
+			pose.Location += pose.LinearVelocity * extrapolation;
+	}
+
+	ApplySnapshot(pose);
+}
+
+float ACarController::GetNetSnapshotRate() const
+{
+	return FMath::Clamp(NetBytesPerSecondBudget / FCarNetSnapshot::EstimatedBytes, 2.0f, 60.0f);
+}
+
+double ACarController::GetServerTime() const
+{
+	const AGameStateBase* gameState = GetWorld()->GetGameState();
+	return gameState != nullptr ? gameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+FCarNetSnapshot ACarController::MakeSnapshot() const
+{
+	FCarNetSnapshot snapshot;
+	snapshot.Location = CarChassis->GetComponentLocation();
+	snapshot.Rotation = CarChassis->GetComponentRotation();
+	snapshot.LinearVelocity = CarChassis->GetPhysicsLinearVelocity();
+	snapshot.AngularVelocity = CarChassis->GetPhysicsAngularVelocityInDegrees();
+	//HandleTurningInput yaws the front wheels away from the chassis by the steer angle.
+	snapshot.SteerAngle = (CarChassis->GetComponentQuat().Inverse() * FrontLeftWheel->GetComponentQuat()).Rotator().Yaw;
+	snapshot.Drifting = IsDrifting;
+	snapshot.LastProcessedInput = LastProcessedInput;
+	snapshot.ServerTime = GetServerTime();
+	return snapshot;
+}
+
+void ACarController::ApplySnapshot(const FCarNetSnapshot& a_Snapshot)
+{
+	CarChassis->SetWorldLocationAndRotation(a_Snapshot.Location, a_Snapshot.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	if (CarChassis->IsSimulatingPhysics())
+	{
+		CarChassis->SetPhysicsLinearVelocity(a_Snapshot.LinearVelocity);
+		CarChassis->SetPhysicsAngularVelocityInDegrees(a_Snapshot.AngularVelocity);
+	}
+	SetFrontWheelSteer(a_Snapshot.SteerAngle);
+	SetDrifting(a_Snapshot.Drifting);
+}
+
+void ACarController::ReconcileWithServer(const FCarNetSnapshot& a_Snapshot)
+{
+	//Only compare when the server has applied new input, a repeated sequence would compare a newer server pose to an old prediction.
+	if (a_Snapshot.LastProcessedInput == LastReconciledInput)
+		return;
+	LastReconciledInput = a_Snapshot.LastProcessedInput;
+
+	const FPredictedState& predicted = PredictionHistory[a_Snapshot.LastProcessedInput % PredictionHistorySize];
+	const FVector predictedLocation = predicted.Valid && predicted.Sequence == a_Snapshot.LastProcessedInput
+		? predicted.Location + AppliedCorrection
+		: CarChassis->GetComponentLocation();
+	const FVector error = a_Snapshot.Location - predictedLocation;
+
+	if (error.Size() <= NetSnapDistance)
+	{
+		PendingCorrection = error;
+		return;
+	}
+
+	ApplySnapshot(a_Snapshot);
+	PendingCorrection = FVector::ZeroVector;
+	for (FPredictedState& state : PredictionHistory)
+		state.Valid = false;
+}
+
+void ACarController::SetFrontWheelSteer(float a_SteerAngle) const
+{
+	const FQuat rotation = CarChassis->GetComponentQuat() * FRotator(0, a_SteerAngle, 0).Quaternion();
+	FrontLeftWheel->SetWorldRotation(rotation);
+	FrontRightWheel->SetWorldRotation(rotation);
+}
+
+void ACarController::OnRep_ReplicatedState()
+{
+	//Deltas are only written against snapshots this client acknowledged, so the baseline is held unless the snapshot is stale.
+	if (!ReplicatedState.ResolveDelta(ReceivedSnapshots.Find(ReplicatedState.BaselineSequence)))
+		return;
+	ReceivedSnapshots.Add(ReplicatedState);
+	QueueSnapshotAck();
+
+	if (GetLocalRole() == ROLE_AutonomousProxy)
+	{
+		ReconcileWithServer(ReplicatedState);
+		return;
+	}
+
+	//A snapshot taken no later than the newest one held adds nothing to blend towards.
+	if (InterpolationSampleCount > 0 && ReplicatedState.ServerTime <= InterpolationBuffer[InterpolationSampleCount - 1].ServerTime)
+		return;
+
+	//Small enough that shifting beats ring buffer bookkeeping.
+	if (InterpolationSampleCount == InterpolationBufferSize)
+	{
+		for (int32 i = 1; i < InterpolationBufferSize; i++)
+			InterpolationBuffer[i - 1] = InterpolationBuffer[i];
+		InterpolationSampleCount--;
+	}
+	InterpolationBuffer[InterpolationSampleCount++] = ReplicatedState;
+}
+
+void ACarController::QueueSnapshotAck()
+{
+	//Clients can only call the server on actors they own, so every car's acknowledgement travels with the player controller.
+	//Until the server's component has replicated nothing is acked, and snapshots keep coming in full.
+	const APlayerController* playerController = GetWorld()->GetFirstPlayerController();
+	if (UCarSnapshotAckComponent* acks = playerController != nullptr ? playerController->FindComponentByClass<UCarSnapshotAckComponent>() : nullptr)
+		acks->QueueAck(this, ReplicatedState.Sequence, GetNetSnapshotRate());
+}
+
+void ACarController::AcknowledgeSnapshot(const UNetConnection* a_Connection, uint16 a_Sequence)
+{
+	NetBaselines.Acknowledge(a_Connection, a_Sequence);
+}
+
+void ACarController::ServerSendInput_Implementation(const FCarNetInput& a_Input)
+{
+	//Unreliable, so an older input can arrive after a newer one.
+	if (static_cast<int16>(static_cast<uint16>(a_Input.Sequence - LastProcessedInput)) <= 0)
+		return;
+	LastProcessedInput = a_Input.Sequence;
+
+	if (!AcceptsHandlerInput())
+		return;
+	InputAxis.X = a_Input.Steering / 127.0f;
+	InputAxis.Y = a_Input.Throttle / 127.0f;
+	SetDrifting(a_Input.Drifting);
+}
+
+void ACarController::ServerResetCar_Implementation()
+{
+	ResetCarActionPressed(FInputActionValue(true));
 }
 
 void ACarController::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -0,0 +1,206 @@
+#include "CarEffectsSubsystem.h"
+
+#include "ManiacCab.h"
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Drift Effects Lent"), STAT_ManiacCab_DriftEffectsLent, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Drift Effect Pool Misses"), STAT_ManiacCab_DriftEffectPoolMisses, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skid Segments"), STAT_ManiacCab_SkidSegments, STATGROUP_ManiacCab);
+
+namespace
+{
+	const TCHAR* SkidMarkMeshPath = TEXT("/Engine/BasicShapes/Plane.Plane");
+	const TCHAR* DefaultSkidMarkMaterialPath = TEXT("/Game/I01_Core/Niagara/Materials/TireSkid.TireSkid");
+	//The engine plane is 100 units on a side.
+	constexpr float SkidMarkMeshSize = 100.0f;
+	//Keeps marks from z-fighting with the road.
+	constexpr float SkidMarkLift = 1.0f;
+	const FTransform HiddenTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+}
+
+void UCarEffectsSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FActorSpawnParameters spawnParameters;
+	spawnParameters.Name = TEXT("CarEffects");
+	spawnParameters.ObjectFlags = RF_Transient;
+	EffectsOwner = InWorld.SpawnActor<AActor>(spawnParameters);
+	USceneComponent* root = NewObject<USceneComponent>(EffectsOwner, TEXT("Root"));
+	EffectsOwner->SetRootComponent(root);
+	root->RegisterComponent();
+
+	//The default buffer is built as soon as the play starts, so the first drift of the match only moves instances.
+	PendingSkidMarkMaterials.Add(nullptr);
+	const TArray<FSoftObjectPath> assets = { FSoftObjectPath(SkidMarkMeshPath), FSoftObjectPath(DefaultSkidMarkMaterialPath) };
+	SkidMarkAssetHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(assets,
+		FStreamableDelegate::CreateUObject(this, &UCarEffectsSubsystem::OnSkidMarkAssetsLoaded));
+}
+
+void UCarEffectsSubsystem::Deinitialize()
+{
+	if (SkidMarkAssetHandle.IsValid())
+		SkidMarkAssetHandle->CancelHandle();
+	SkidMarkAssetHandle.Reset();
+	DriftEffectPools.Reset();
+	DriftEffects.Reset();
+	SkidMarkBuffers.Reset();
+	SkidMarks.Reset();
+	PendingSkidMarkMaterials.Reset();
+	SkidMarkMesh = nullptr;
+	DefaultSkidMarkMaterial = nullptr;
+	EffectsOwner = nullptr;
+	Super::Deinitialize();
+}
+
+bool UCarEffectsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCarEffectsSubsystem::PrewarmDriftEffects(UNiagaraSystem* a_System, int32 a_Count)
+{
+	if (a_System == nullptr || EffectsOwner == nullptr)
+		return;
+
+	FDriftEffectPool& pool = DriftEffectPools.FindOrAdd(a_System);
+	pool.Reserved += a_Count;
+	while (pool.Created < pool.Reserved)
+		pool.Idle.Add(CreateDriftEffect(a_System));
+}
+
+UNiagaraComponent* UCarEffectsSubsystem::AcquireDriftEffect(UNiagaraSystem* a_System, USceneComponent* a_Parent, const FVector& a_Offset)
+{
+	if (a_System == nullptr || EffectsOwner == nullptr)
+		return nullptr;
+
+	FDriftEffectPool& pool = DriftEffectPools.FindOrAdd(a_System);
+	//Prefer a component whose particles from its last use have died out, so they are not dragged to the new wheel.
+	int32 idleIndex = pool.Idle.IndexOfByPredicate([](const UNiagaraComponent* a_Effect) { return a_Effect->IsComplete(); });
+	if (idleIndex == INDEX_NONE && pool.Idle.Num() > 0)
+		idleIndex = 0;
+
+	UNiagaraComponent* effect;
+	if (idleIndex != INDEX_NONE)
+	{
+		effect = pool.Idle[idleIndex];
+		pool.Idle.RemoveAtSwap(idleIndex);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_ManiacCab_DriftEffectPoolMisses);
+		effect = CreateDriftEffect(a_System);
+	}
+
+	effect->AttachToComponent(a_Parent, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+	effect->SetRelativeLocation(a_Offset);
+	effect->Activate(true);
+	INC_DWORD_STAT(STAT_ManiacCab_DriftEffectsLent);
+	INC_DWORD_STAT(STAT_ManiacCab_NiagaraActivations);
+	return effect;
+}
+
+void UCarEffectsSubsystem::ReleaseDriftEffect(UNiagaraComponent* a_Effect)
+{
+	if (a_Effect == nullptr)
+		return;
+
+	a_Effect->Deactivate();
+	if (FDriftEffectPool* pool = DriftEffectPools.Find(a_Effect->GetAsset()))
+		pool->Idle.Add(a_Effect);
+	DEC_DWORD_STAT(STAT_ManiacCab_DriftEffectsLent);
+}
+
+UNiagaraComponent* UCarEffectsSubsystem::CreateDriftEffect(UNiagaraSystem* a_System)
+{
+	UNiagaraComponent* effect = NewObject<UNiagaraComponent>(EffectsOwner);
+	effect->SetAutoActivate(false);
+	effect->SetAsset(a_System);
+	effect->SetupAttachment(EffectsOwner->GetRootComponent());
+	effect->RegisterComponent();
+	//Run it once so the system instance and its shaders are ready before the first drift, not during it.
+	effect->Activate(true);
+	effect->DeactivateImmediate();
+
+	DriftEffects.Add(effect);
+	DriftEffectPools.FindOrAdd(a_System).Created++;
+	return effect;
+}
+
+void UCarEffectsSubsystem::PrewarmSkidMarks(UMaterialInterface* a_Material)
+{
+	if (SkidMarkBuffers.Contains(a_Material) || PendingSkidMarkMaterials.Contains(a_Material))
+		return;
+
+	if (SkidMarkMesh != nullptr)
+		CreateSkidMarks(a_Material);
+	else
+		PendingSkidMarkMaterials.Add(a_Material);
+}
+
+void UCarEffectsSubsystem::AddSkidSegment(const FVector& a_Start, const FVector& a_End, const FVector& a_Normal, float a_Width, UMaterialInterface* a_Material)
+{
+	FSkidMarkBuffer* buffer = SkidMarkBuffers.Find(a_Material);
+	if (buffer == nullptr)
+		return;
+
+	const FVector direction = a_End - a_Start;
+	const float length = direction.Size();
+	if (length < UE_KINDA_SMALL_NUMBER)
+		return;
+
+	const FQuat rotation = FRotationMatrix::MakeFromXZ(direction, a_Normal).ToQuat();
+	const FTransform transform(rotation, (a_Start + a_End) * 0.5f + a_Normal * SkidMarkLift,
+		FVector(length / SkidMarkMeshSize, a_Width / SkidMarkMeshSize, 1.0f));
+
+	//Render state is only marked dirty, the proxy is rebuilt once at the end of the frame however many marks were added.
+	buffer->Marks->UpdateInstanceTransform(buffer->Next, transform, true, true, true);
+	buffer->Next = (buffer->Next + 1) % SkidMarkCapacity;
+	INC_DWORD_STAT(STAT_ManiacCab_SkidSegments);
+}
+
+void UCarEffectsSubsystem::OnSkidMarkAssetsLoaded()
+{
+	SkidMarkMesh = Cast<UStaticMesh>(FSoftObjectPath(SkidMarkMeshPath).ResolveObject());
+	DefaultSkidMarkMaterial = Cast<UMaterialInterface>(FSoftObjectPath(DefaultSkidMarkMaterialPath).ResolveObject());
+	SkidMarkAssetHandle.Reset();
+	if (SkidMarkMesh == nullptr)
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Skid mark mesh %s failed to load, cars leave no skid marks"), SkidMarkMeshPath);
+		PendingSkidMarkMaterials.Reset();
+		return;
+	}
+
+	for (UMaterialInterface* material : PendingSkidMarkMaterials)
+		CreateSkidMarks(material);
+	PendingSkidMarkMaterials.Reset();
+}
+
+void UCarEffectsSubsystem::CreateSkidMarks(UMaterialInterface* a_Material)
+{
+	if (SkidMarkMesh == nullptr || EffectsOwner == nullptr)
+		return;
+
+	UInstancedStaticMeshComponent* marks = NewObject<UInstancedStaticMeshComponent>(EffectsOwner);
+	marks->SetStaticMesh(SkidMarkMesh);
+	marks->SetMaterial(0, a_Material != nullptr ? a_Material : DefaultSkidMarkMaterial.Get());
+	marks->SetMobility(EComponentMobility::Movable);
+	marks->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	marks->SetCastShadow(false);
+	marks->SetCanEverAffectNavigation(false);
+	marks->SetupAttachment(EffectsOwner->GetRootComponent());
+	marks->RegisterComponent();
+
+	//Every slot exists from the start, adding a mark only overwrites the oldest one.
+	TArray<FTransform> hidden;
+	hidden.Init(HiddenTransform, SkidMarkCapacity);
+	marks->AddInstances(hidden, false, true);
+
+	SkidMarks.Add(marks);
+	SkidMarkBuffers.Add(a_Material, FSkidMarkBuffer{ marks, 0 });
+}
@@ -0,0 +1,231 @@
+#include "CarGhostTrack.h"
+
+#include "ManiacCab.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	constexpr float LocationScale = 10.0f;
+	constexpr float QuatComponentRange = UE_INV_SQRT_2;
+
+	template <typename T>
+	uint8* Put(uint8* o_Bytes, const T& a_Value)
+	{
+		FMemory::Memcpy(o_Bytes, &a_Value, sizeof(T));
+		return o_Bytes + sizeof(T);
+	}
+
+	template <typename T>
+	const uint8* Get(const uint8* a_Bytes, T& o_Value)
+	{
+		FMemory::Memcpy(&o_Value, a_Bytes, sizeof(T));
+		return a_Bytes + sizeof(T);
+	}
+
+	//The largest component is dropped and rebuilt from the unit length, the other three fit in +-1/sqrt(2).
+	uint32 PackQuat(const FQuat4f& a_Rotation)
+	{
+		const float components[4] = { a_Rotation.X, a_Rotation.Y, a_Rotation.Z, a_Rotation.W };
+		uint32 largest = 0;
+		for (uint32 i = 1; i < 4; i++)
+		{
+			if (FMath::Abs(components[i]) > FMath::Abs(components[largest]))
+				largest = i;
+		}
+
+		const float sign = components[largest] < 0 ? -1.0f : 1.0f;
+		uint32 packed = largest;
+		uint32 shift = 2;
+		for (uint32 i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			const float normalized = FMath::Clamp(components[i] * sign / QuatComponentRange, -1.0f, 1.0f) * 0.5f + 0.5f;
+			packed |= uint32(FMath::RoundToInt(normalized * 1023.0f)) << shift;
+			shift += 10;
+		}
+		return packed;
+	}
+
+	FQuat4f UnpackQuat(uint32 a_Packed)
+	{
+		const uint32 largest = a_Packed & 3;
+		float components[4];
+		float sumSquared = 0;
+		uint32 shift = 2;
+		for (uint32 i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			components[i] = (((a_Packed >> shift) & 1023) / 1023.0f * 2.0f - 1.0f) * QuatComponentRange;
+			sumSquared += components[i] * components[i];
+			shift += 10;
+		}
+		components[largest] = FMath::Sqrt(FMath::Max(1.0f - sumSquared, 0.0f));
+		return FQuat4f(components[0], components[1], components[2], components[3]);
+	}
+}
+
+void CarGhostTrack::EncodeSample(const FCarGhostSample& a_Sample, uint8* o_Bytes)
+{
+	for (int32 axis = 0; axis < 3; axis++)
+		o_Bytes = Put(o_Bytes, int32(FMath::RoundToInt(a_Sample.ChassisLocation[axis] * LocationScale)));
+	o_Bytes = Put(o_Bytes, PackQuat(a_Sample.ChassisRotation));
+
+	for (int32 i = 0; i < FCarGhostSample::WheelCount; i++)
+	{
+		for (int32 axis = 0; axis < 3; axis++)
+			o_Bytes = Put(o_Bytes, int16(FMath::Clamp(FMath::RoundToInt(a_Sample.WheelLocations[i][axis] * LocationScale), int32(MIN_int16), int32(MAX_int16))));
+		o_Bytes = Put(o_Bytes, PackQuat(a_Sample.WheelRotations[i]));
+	}
+}
+
+void CarGhostTrack::DecodeSample(const uint8* a_Bytes, FCarGhostSample& o_Sample)
+{
+	uint32 packedRotation;
+	for (int32 axis = 0; axis < 3; axis++)
+	{
+		int32 location;
+		a_Bytes = Get(a_Bytes, location);
+		o_Sample.ChassisLocation[axis] = location / LocationScale;
+	}
+	a_Bytes = Get(a_Bytes, packedRotation);
+	o_Sample.ChassisRotation = UnpackQuat(packedRotation);
+
+	for (int32 i = 0; i < FCarGhostSample::WheelCount; i++)
+	{
+		for (int32 axis = 0; axis < 3; axis++)
+		{
+			int16 location;
+			a_Bytes = Get(a_Bytes, location);
+			o_Sample.WheelLocations[i][axis] = location / LocationScale;
+		}
+		a_Bytes = Get(a_Bytes, packedRotation);
+		o_Sample.WheelRotations[i] = UnpackQuat(packedRotation);
+	}
+}
+
+FCarGhostWriter::~FCarGhostWriter()
+{
+	Close();
+}
+
+bool FCarGhostWriter::Open(const FString& a_Path, float a_SampleRate)
+{
+	Close();
+
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(a_Path));
+	FileHandle.Reset(platformFile.OpenWrite(*a_Path));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Could not open %s for ghost recording"), *a_Path);
+		return false;
+	}
+
+	SampleRate = a_SampleRate;
+	Buffer.Reset(BufferSize);
+	Buffer.AddUninitialized(CarGhostTrack::HeaderSize);
+	uint8* header = Buffer.GetData();
+	header = Put(header, CarGhostTrack::Magic);
+	header = Put(header, CarGhostTrack::Version);
+	Put(header, SampleRate);
+	return true;
+}
+
+void FCarGhostWriter::Close()
+{
+	if (!FileHandle.IsValid())
+		return;
+
+	Flush();
+	FileHandle.Reset();
+}
+
+void FCarGhostWriter::WriteSample(const FCarGhostSample& a_Sample)
+{
+	if (!FileHandle.IsValid())
+		return;
+
+	if (Buffer.Num() + CarGhostTrack::SampleSize > BufferSize)
+		Flush();
+
+	const int32 offset = Buffer.AddUninitialized(CarGhostTrack::SampleSize);
+	CarGhostTrack::EncodeSample(a_Sample, Buffer.GetData() + offset);
+}
+
+void FCarGhostWriter::Flush()
+{
+	if (Buffer.Num() > 0)
+		FileHandle->Write(Buffer.GetData(), Buffer.Num());
+	Buffer.Reset();
+}
+
+FCarGhostReader::~FCarGhostReader()
+{
+	Close();
+}
+
+bool FCarGhostReader::Open(const FString& a_Path)
+{
+	Close();
+
+	FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*a_Path));
+	if (!FileHandle.IsValid() || FileHandle->Size() < CarGhostTrack::HeaderSize)
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Could not open ghost track %s"), *a_Path);
+		Close();
+		return false;
+	}
+
+	uint8 header[CarGhostTrack::HeaderSize];
+	uint32 magic = 0;
+	uint32 version = 0;
+	FileHandle->Read(header, CarGhostTrack::HeaderSize);
+	Get(Get(Get(header, magic), version), SampleRate);
+	if (magic != CarGhostTrack::Magic || version != CarGhostTrack::Version || SampleRate <= 0)
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("%s is not a ghost track this build can read"), *a_Path);
+		Close();
+		return false;
+	}
+
+	NumSamples = (FileHandle->Size() - CarGhostTrack::HeaderSize) / CarGhostTrack::SampleSize;
+	NextSample = 0;
+	return true;
+}
+
+void FCarGhostReader::Close()
+{
+	FileHandle.Reset();
+	NumSamples = 0;
+	NextSample = 0;
+}
+
+int32 FCarGhostReader::ReadSamples(TArray<FCarGhostSample>& o_Samples, int32 a_MaxSamples)
+{
+	if (!FileHandle.IsValid())
+		return 0;
+
+	const int32 numSamples = int32(FMath::Min<int64>(a_MaxSamples, NumSamples - NextSample));
+	if (numSamples <= 0)
+		return 0;
+
+	ReadBuffer.SetNumUninitialized(numSamples * CarGhostTrack::SampleSize, EAllowShrinking::No);
+	FileHandle->Seek(CarGhostTrack::HeaderSize + NextSample * CarGhostTrack::SampleSize);
+	if (!FileHandle->Read(ReadBuffer.GetData(), ReadBuffer.Num()))
+		return 0;
+
+	const int32 firstOutput = o_Samples.AddUninitialized(numSamples);
+	for (int32 i = 0; i < numSamples; i++)
+		CarGhostTrack::DecodeSample(ReadBuffer.GetData() + i * CarGhostTrack::SampleSize, o_Samples[firstOutput + i]);
+
+	NextSample += numSamples;
+	return numSamples;
+}
+
+void FCarGhostReader::Seek(int64 a_Sample)
+{
+	NextSample = FMath::Clamp<int64>(a_Sample, 0, NumSamples);
+}
@@ -0,0 +1,268 @@
+#include "CarGroundSubsystem.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "EngineUtils.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Level.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ground Heightfield Bake"), STAT_ManiacCab_GroundBake, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ground Bake Traces"), STAT_ManiacCab_GroundBakeTraces, STATGROUP_ManiacCab);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ground Heightfield Tiles"), STAT_ManiacCab_GroundTiles, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<int32> CVarGroundBakeTracesPerFrame(
+	TEXT("ManiacCab.GroundBakeTracesPerFrame"),
+	2048,
+	TEXT("Traces per frame spent baking ground heightfield tiles for cars using UseGroundHeightfield."));
+
+static TAutoConsoleVariable<float> CVarGroundTileLifetime(
+	TEXT("ManiacCab.GroundTileLifetime"),
+	10.0f,
+	TEXT("Seconds a ground heightfield tile is kept after the last probe that used it."));
+
+namespace
+{
+	//Vertical range baked around the car that asked for a tile.
+	constexpr float BakeHalfHeight = 5000.0f;
+	//Cars are marked this much beyond their bounds so probes next to them trace too.
+	constexpr float OccupancyMargin = 100.0f;
+
+	FIntPoint ToOccupancyCell(const FVector& a_Location, float a_CellSize)
+	{
+		return FIntPoint(FMath::FloorToInt32(a_Location.X / a_CellSize), FMath::FloorToInt32(a_Location.Y / a_CellSize));
+	}
+}
+
+void UCarGroundSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	//Streaming changes the static geometry under baked tiles, those are baked again on demand.
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UCarGroundSubsystem::OnLevelsChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UCarGroundSubsystem::OnLevelsChanged);
+}
+
+void UCarGroundSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	ResetTiles();
+	Occupancy.Reset();
+	Super::Deinitialize();
+}
+
+bool UCarGroundSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UCarGroundSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCarGroundSubsystem, STATGROUP_Tickables);
+}
+
+void UCarGroundSubsystem::OnLevelsChanged(ULevel* a_Level, UWorld* a_World)
+{
+	if (a_World != GetWorld() || a_Level == nullptr)
+		return;
+
+	//Cached component bounds, a removed level's components are already unregistered when this is called.
+	FBox bounds(ForceInit);
+	for (const AActor* actor : a_Level->Actors)
+	{
+		if (actor == nullptr)
+			continue;
+		actor->ForEachComponent<UPrimitiveComponent>(false, [&bounds](const UPrimitiveComponent* a_Component)
+		{
+			if (a_Component->IsCollisionEnabled())
+				bounds += a_Component->Bounds.GetBox();
+		});
+	}
+	if (bounds.IsValid)
+		ResetTiles(bounds);
+}
+
+void UCarGroundSubsystem::ResetTiles()
+{
+	DEC_DWORD_STAT_BY(STAT_ManiacCab_GroundTiles, Tiles.Num());
+	Tiles.Reset();
+	PendingTiles.Reset();
+}
+
+void UCarGroundSubsystem::ResetTiles(const FBox& a_Bounds)
+{
+	//Grown by a sample so the tiles sharing an edge sample with an overlapped tile go too.
+	const FBox bounds = a_Bounds.ExpandBy(SampleSpacing);
+	const float tileSize = TileCells * SampleSpacing;
+	for (auto it = Tiles.CreateIterator(); it; ++it)
+	{
+		const FGroundTile& tile = *it.Value();
+		const FBox tileBounds(FVector(it.Key().X * tileSize, it.Key().Y * tileSize, tile.BakeBottom),
+			FVector((it.Key().X + 1) * tileSize, (it.Key().Y + 1) * tileSize, tile.BakeTop));
+		if (!tileBounds.Intersect(bounds))
+			continue;
+
+		PendingTiles.Remove(it.Key());
+		it.RemoveCurrent();
+		DEC_DWORD_STAT(STAT_ManiacCab_GroundTiles);
+	}
+}
+
+void UCarGroundSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (BakeChannel == ECC_MAX)
+		return;
+
+	UpdateOccupancy();
+
+	const double now = GetWorld()->GetTimeSeconds();
+	const float tileLifetime = CVarGroundTileLifetime.GetValueOnGameThread();
+	for (auto it = Tiles.CreateIterator(); it; ++it)
+	{
+		if (now - it.Value()->LastUsedTime > tileLifetime)
+		{
+			it.RemoveCurrent();
+			DEC_DWORD_STAT(STAT_ManiacCab_GroundTiles);
+		}
+	}
+
+	if (PendingTiles.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_GroundBake);
+	int32 traceBudget = FMath::Max(CVarGroundBakeTracesPerFrame.GetValueOnGameThread(), 1);
+	while (traceBudget > 0 && PendingTiles.Num() > 0)
+	{
+		const FIntPoint tileKey = PendingTiles[0];
+		TUniquePtr<FGroundTile>* tile = Tiles.Find(tileKey);
+		if (tile != nullptr)
+			traceBudget -= BakeTile(tileKey, **tile, traceBudget);
+
+		if (tile == nullptr || (*tile)->Baked)
+			PendingTiles.RemoveAt(0, 1, EAllowShrinking::No);
+	}
+}
+
+void UCarGroundSubsystem::UpdateOccupancy()
+{
+	Occupancy.Reset();
+	for (TActorIterator<ACarController> it(GetWorld()); it; ++it)
+	{
+		if (it->CarChassis == nullptr)
+			continue;
+
+		const FBox bounds = it->CarChassis->Bounds.GetBox().ExpandBy(OccupancyMargin);
+		const FIntPoint minCell = ToOccupancyCell(bounds.Min, OccupancyCellSize);
+		const FIntPoint maxCell = ToOccupancyCell(bounds.Max, OccupancyCellSize);
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 x = minCell.X; x <= maxCell.X; x++)
+			{
+				FOccupant& occupant = Occupancy.FindOrAdd(FIntPoint(x, y));
+				occupant.Shared |= occupant.Actor != nullptr && occupant.Actor != *it;
+				occupant.Actor = *it;
+			}
+		}
+	}
+}
+
+bool UCarGroundSubsystem::IsOccupiedByOther(const FVector& a_Location, const AActor* a_Querier) const
+{
+	const FOccupant* occupant = Occupancy.Find(ToOccupancyCell(a_Location, OccupancyCellSize));
+	return occupant != nullptr && (occupant->Shared || occupant->Actor != a_Querier);
+}
+
+bool UCarGroundSubsystem::SampleGround(const FVector& a_Location, float a_ProbeLength, ECollisionChannel a_Channel, const AActor* a_Querier, float& o_Height, FVector& o_Normal)
+{
+	if (BakeChannel == ECC_MAX)
+		BakeChannel = a_Channel;
+	if (a_Channel != BakeChannel || IsOccupiedByOther(a_Location, a_Querier))
+		return false;
+
+	const float sampleX = a_Location.X / SampleSpacing;
+	const float sampleY = a_Location.Y / SampleSpacing;
+	const FIntPoint tileKey(FMath::FloorToInt32(sampleX / TileCells), FMath::FloorToInt32(sampleY / TileCells));
+
+	TUniquePtr<FGroundTile>& tile = Tiles.FindOrAdd(tileKey);
+	if (!tile.IsValid())
+	{
+		tile = MakeUnique<FGroundTile>();
+		tile->BakeTop = a_Location.Z + BakeHalfHeight;
+		tile->BakeBottom = a_Location.Z - BakeHalfHeight;
+		PendingTiles.Add(tileKey);
+		INC_DWORD_STAT(STAT_ManiacCab_GroundTiles);
+	}
+	tile->LastUsedTime = GetWorld()->GetTimeSeconds();
+	if (tile->NextSample == 0)
+		tile->ProbeReach = FMath::Max(tile->ProbeReach, a_ProbeLength);
+	if (!tile->Baked || a_Location.Z > tile->BakeTop || a_Location.Z < tile->BakeBottom || a_ProbeLength > tile->ProbeReach)
+		return false;
+
+	const float localX = sampleX - tileKey.X * TileCells;
+	const float localY = sampleY - tileKey.Y * TileCells;
+	const int32 x = FMath::Clamp(FMath::FloorToInt32(localX), 0, TileCells - 1);
+	const int32 y = FMath::Clamp(FMath::FloorToInt32(localY), 0, TileCells - 1);
+	const FGroundSample& s00 = tile->Samples[y * TileSamples + x];
+	const FGroundSample& s10 = tile->Samples[y * TileSamples + x + 1];
+	const FGroundSample& s01 = tile->Samples[(y + 1) * TileSamples + x];
+	const FGroundSample& s11 = tile->Samples[(y + 1) * TileSamples + x + 1];
+	if (s00.Unusable || s10.Unusable || s01.Unusable || s11.Unusable)
+		return false;
+
+	const float tx = localX - x;
+	const float ty = localY - y;
+	o_Height = FMath::BiLerp(s00.Height, s10.Height, s01.Height, s11.Height, tx, ty);
+	o_Normal = FVector(FMath::BiLerp(s00.Normal, s10.Normal, s01.Normal, s11.Normal, tx, ty).GetSafeNormal());
+	return true;
+}
+
+int32 UCarGroundSubsystem::BakeTile(const FIntPoint& a_TileKey, FGroundTile& a_Tile, int32 a_TraceBudget)
+{
+	const UWorld* world = GetWorld();
+	constexpr int32 sampleCount = TileSamples * TileSamples;
+
+	//Only static geometry is baked. Cars are left out of the movable check, they are handled by the occupancy cells.
+	FCollisionQueryParams staticParams(SCENE_QUERY_STAT(CarGroundBake), false);
+	staticParams.MobilityType = EQueryMobilityType::Static;
+	FCollisionQueryParams movableParams(SCENE_QUERY_STAT(CarGroundBake), false);
+	movableParams.MobilityType = EQueryMobilityType::Dynamic;
+	for (TActorIterator<ACarController> it(GetWorld()); it; ++it)
+		movableParams.AddIgnoredActor(*it);
+
+	int32 traces = 0;
+	for (; a_Tile.NextSample < sampleCount && traces < a_TraceBudget; a_Tile.NextSample++)
+	{
+		const int32 x = a_Tile.NextSample % TileSamples;
+		const int32 y = a_Tile.NextSample / TileSamples;
+		const float worldX = (a_TileKey.X * TileCells + x) * SampleSpacing;
+		const float worldY = (a_TileKey.Y * TileCells + y) * SampleSpacing;
+		const FVector top(worldX, worldY, a_Tile.BakeTop);
+		const FVector bottom(worldX, worldY, a_Tile.BakeBottom);
+
+		FGroundSample& sample = a_Tile.Samples[a_Tile.NextSample];
+		sample.Unusable = true;
+
+		FHitResult hit;
+		traces++;
+		if (!world->LineTraceSingleByChannel(hit, top, bottom, BakeChannel, staticParams))
+			continue;
+
+		//Under an overhang the wheel could be on either surface, and movable geometry above can move into the way.
+		//Ground below the probe reach is never hit by a probe starting above the top surface, and one starting under it
+		//sees the sample above its start and traces anyway.
+		FHitResult belowHit;
+		traces += 2;
+		const FVector belowEnd(worldX, worldY, FMath::Max(hit.ImpactPoint.Z - a_Tile.ProbeReach, a_Tile.BakeBottom));
+		if (world->LineTraceSingleByChannel(belowHit, hit.ImpactPoint - FVector(0, 0, 5.0f), belowEnd, BakeChannel, staticParams)
+			|| world->LineTraceSingleByChannel(belowHit, top, hit.ImpactPoint, BakeChannel, movableParams))
+			continue;
+
+		sample.Height = hit.ImpactPoint.Z;
+		sample.Normal = FVector3f(hit.ImpactNormal);
+		sample.Unusable = false;
+	}
+
+	INC_DWORD_STAT_BY(STAT_ManiacCab_GroundBakeTraces, traces);
+	a_Tile.Baked = a_Tile.NextSample >= sampleCount;
+	return traces;
+}
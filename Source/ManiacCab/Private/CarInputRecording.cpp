@@ -0,0 +1,204 @@
+#include "CarInputRecording.h"
+
+#include "ManiacCab.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "Async/MappedFileHandle.h"
+
+namespace
+{
+	constexpr int64 HeaderSize = sizeof(uint32) * 2;
+	constexpr float DeltaTimeUnit = 0.00001f;
+
+	int8 QuantizeAxis(float a_Value)
+	{
+		return int8(FMath::RoundToInt(FMath::Clamp(a_Value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	float DequantizeAxis(int8 a_Value)
+	{
+		return a_Value / 127.0f;
+	}
+}
+
+FCarInputRecorder::~FCarInputRecorder()
+{
+	Close();
+}
+
+bool FCarInputRecorder::Open(const FString& a_Path)
+{
+	Close();
+
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(a_Path));
+	FileHandle.Reset(platformFile.OpenWrite(*a_Path));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Could not open %s for recording"), *a_Path);
+		return false;
+	}
+
+	Buffer.Reset(BufferSize);
+	LastSteering = 0;
+	LastThrottle = 0;
+	LastDeltaTime = 0;
+	Write(CarInputRecording::Magic);
+	Write(CarInputRecording::Version);
+	return true;
+}
+
+void FCarInputRecorder::Close()
+{
+	if (!FileHandle.IsValid())
+		return;
+
+	Flush();
+	FileHandle.Reset();
+}
+
+void FCarInputRecorder::RecordFrame(const FCarInputFrame& a_Frame)
+{
+	if (!FileHandle.IsValid())
+		return;
+
+	//Largest possible frame: flags, two axes, delta time and a keyframe.
+	constexpr int32 maxFrameSize = 1 + 2 + sizeof(uint16) + sizeof(FCarKeyframe);
+	if (Buffer.Num() + maxFrameSize > BufferSize)
+		Flush();
+
+	const int8 steering = QuantizeAxis(a_Frame.Steering);
+	const int8 throttle = QuantizeAxis(a_Frame.Throttle);
+	const uint16 deltaTime = uint16(FMath::Clamp(FMath::RoundToInt(a_Frame.DeltaTime / DeltaTimeUnit), 0, int32(MAX_uint16)));
+
+	uint8 flags = 0;
+	flags |= steering != LastSteering ? CarInputRecording::SteeringChanged : 0;
+	flags |= throttle != LastThrottle ? CarInputRecording::ThrottleChanged : 0;
+	flags |= deltaTime != LastDeltaTime ? CarInputRecording::DeltaTimeChanged : 0;
+	flags |= a_Frame.Drifting ? CarInputRecording::Drifting : 0;
+	flags |= a_Frame.Reset ? CarInputRecording::Reset : 0;
+	flags |= a_Frame.HasKeyframe ? CarInputRecording::HasKeyframe : 0;
+
+	Write(flags);
+	if (flags & CarInputRecording::SteeringChanged)
+		Write(steering);
+	if (flags & CarInputRecording::ThrottleChanged)
+		Write(throttle);
+	if (flags & CarInputRecording::DeltaTimeChanged)
+		Write(deltaTime);
+	if (flags & CarInputRecording::HasKeyframe)
+		Write(a_Frame.Keyframe);
+
+	LastSteering = steering;
+	LastThrottle = throttle;
+	LastDeltaTime = deltaTime;
+}
+
+template <typename T>
+void FCarInputRecorder::Write(const T& a_Value)
+{
+	static_assert(TIsTriviallyCopyAssignable<T>::Value, "Recordings store raw bytes");
+	const int32 offset = Buffer.AddUninitialized(sizeof(T));
+	FMemory::Memcpy(Buffer.GetData() + offset, &a_Value, sizeof(T));
+}
+
+void FCarInputRecorder::Flush()
+{
+	if (Buffer.Num() > 0)
+		FileHandle->Write(Buffer.GetData(), Buffer.Num());
+	Buffer.Reset();
+}
+
+FCarReplayReader::~FCarReplayReader()
+{
+	Close();
+}
+
+bool FCarReplayReader::Open(const FString& a_Path)
+{
+	Close();
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*a_Path));
+	if (!MappedFile.IsValid() || MappedFile->GetFileSize() < HeaderSize)
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Could not map recording %s"), *a_Path);
+		Close();
+		return false;
+	}
+
+	MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	if (!MappedRegion.IsValid())
+	{
+		Close();
+		return false;
+	}
+
+	Data = MappedRegion->GetMappedPtr();
+	Size = MappedRegion->GetMappedSize();
+	Offset = 0;
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	if (!Read(magic) || !Read(version) || magic != CarInputRecording::Magic || version != CarInputRecording::Version)
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("%s is not a car input recording this build can read"), *a_Path);
+		Close();
+		return false;
+	}
+
+	Rewind();
+	return true;
+}
+
+void FCarReplayReader::Close()
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	Data = nullptr;
+	Size = 0;
+	Offset = 0;
+}
+
+void FCarReplayReader::Rewind()
+{
+	Offset = HeaderSize;
+	LastSteering = 0;
+	LastThrottle = 0;
+	LastDeltaTime = 0;
+}
+
+bool FCarReplayReader::ReadFrame(FCarInputFrame& o_Frame)
+{
+	uint8 flags = 0;
+	if (!Read(flags))
+		return false;
+
+	if ((flags & CarInputRecording::SteeringChanged) && !Read(LastSteering))
+		return false;
+	if ((flags & CarInputRecording::ThrottleChanged) && !Read(LastThrottle))
+		return false;
+	if ((flags & CarInputRecording::DeltaTimeChanged) && !Read(LastDeltaTime))
+		return false;
+
+	o_Frame.HasKeyframe = (flags & CarInputRecording::HasKeyframe) != 0;
+	if (o_Frame.HasKeyframe && !Read(o_Frame.Keyframe))
+		return false;
+
+	o_Frame.Steering = DequantizeAxis(LastSteering);
+	o_Frame.Throttle = DequantizeAxis(LastThrottle);
+	o_Frame.DeltaTime = LastDeltaTime * DeltaTimeUnit;
+	o_Frame.Drifting = (flags & CarInputRecording::Drifting) != 0;
+	o_Frame.Reset = (flags & CarInputRecording::Reset) != 0;
+	return true;
+}
+
+template <typename T>
+bool FCarReplayReader::Read(T& o_Value)
+{
+	if (Data == nullptr || Offset + int64(sizeof(T)) > Size)
+		return false;
+
+	FMemory::Memcpy(&o_Value, Data + Offset, sizeof(T));
+	Offset += sizeof(T);
+	return true;
+}
@@ -0,0 +1,137 @@
+#include "CarNetSnapshot.h"
+
+#include "ManiacCab.h"
+#include "Engine/NetSerialization.h"
+#include "Engine/PackageMapClient.h"
+#include "Serialization/BitWriter.h"
+
+void FCarNetSnapshot::Quantize()
+{
+	Location = (Location * 10.0).GetRounded() / 10.0;
+	LinearVelocity = LinearVelocity.IsNearlyZero(1.0) ? FVector::ZeroVector : LinearVelocity.GetRounded();
+	AngularVelocity = AngularVelocity.IsNearlyZero(1.0) ? FVector::ZeroVector : AngularVelocity.GetRounded();
+}
+
+bool FCarNetSnapshot::ResolveDelta(const FCarNetSnapshot* a_Baseline)
+{
+	if (!IsDelta)
+		return true;
+	if (a_Baseline == nullptr || a_Baseline->Sequence != BaselineSequence)
+		return false;
+
+	Location += a_Baseline->Location;
+	LinearVelocity += a_Baseline->LinearVelocity;
+	AngularVelocity += a_Baseline->AngularVelocity;
+	IsDelta = false;
+	Quantize();
+	return true;
+}
+
+bool FCarNetSnapshot::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	//Replication always saves through a bit writer, which lets the snapshot report its own size.
+	const int64 startBits = Ar.IsSaving() ? static_cast<FBitWriter&>(Ar).GetNumBits() : 0;
+
+	Ar << Sequence;
+
+	//Saving runs once per connection, each against the baseline that connection acknowledged. 0 is a full snapshot.
+	const FCarNetSnapshot* baseline = nullptr;
+	UPackageMapClient* packageMap = Cast<UPackageMapClient>(Map);
+	if (Ar.IsSaving() && Baselines != nullptr && packageMap != nullptr)
+		baseline = Baselines->FindBaseline(packageMap->GetConnection(), Sequence);
+	static_assert(FCarNetSnapshotHistory::Size <= 32, "The baseline distance is written in five bits.");
+	uint8 baselineDistance = baseline != nullptr ? uint8(Sequence - baseline->Sequence) : 0;
+	Ar.SerializeBits(&baselineDistance, 5);
+	if (Ar.IsLoading())
+	{
+		IsDelta = baselineDistance != 0;
+		BaselineSequence = uint16(Sequence - baselineDistance);
+	}
+
+	//Differences from the baseline need far fewer bits than world positions, the packed vectors size themselves to fit.
+	FVector location = baseline != nullptr ? Location - baseline->Location : Location;
+	FVector linearVelocity = baseline != nullptr ? LinearVelocity - baseline->LinearVelocity : LinearVelocity;
+	FVector angularVelocity = baseline != nullptr ? AngularVelocity - baseline->AngularVelocity : AngularVelocity;
+
+	bOutSuccess = SerializePackedVector<10, 24>(location, Ar);
+	Rotation.SerializeCompressedShort(Ar);
+
+	//Quantize has already rounded near rest to exactly zero, so a zero difference is exact too.
+	uint8 flags = 0;
+	if (Ar.IsSaving())
+	{
+		flags |= linearVelocity.IsZero() ? 0 : 1 << 0;
+		flags |= angularVelocity.IsZero() ? 0 : 1 << 1;
+		flags |= Drifting ? 1 << 2 : 0;
+	}
+	Ar.SerializeBits(&flags, 3);
+	Drifting = (flags & (1 << 2)) != 0;
+
+	if (flags & (1 << 0))
+		bOutSuccess &= SerializePackedVector<1, 20>(linearVelocity, Ar);
+	else
+		linearVelocity = FVector::ZeroVector;
+
+	if (flags & (1 << 1))
+		bOutSuccess &= SerializePackedVector<1, 20>(angularVelocity, Ar);
+	else
+		angularVelocity = FVector::ZeroVector;
+
+	if (Ar.IsLoading())
+	{
+		Location = location;
+		LinearVelocity = linearVelocity;
+		AngularVelocity = angularVelocity;
+	}
+
+	int8 steer = int8(FMath::Clamp(FMath::RoundToInt(SteerAngle * 2.0f), -127, 127));
+	Ar << steer;
+	SteerAngle = steer * 0.5f;
+
+	Ar << LastProcessedInput;
+
+	uint32 serverTimeMs = uint32(FMath::Max(FMath::RoundToInt64(ServerTime * 1000.0), int64(0)));
+	Ar << serverTimeMs;
+	ServerTime = serverTimeMs / 1000.0;
+
+	if (Ar.IsSaving())
+		INC_DWORD_STAT_BY(STAT_ManiacCab_SnapshotBytes, (static_cast<FBitWriter&>(Ar).GetNumBits() - startBits + 7) / 8);
+	return true;
+}
+
+const FCarNetSnapshot* FCarNetSnapshotHistory::Find(uint16 a_Sequence) const
+{
+	const FCarNetSnapshot& snapshot = Snapshots[a_Sequence % Size];
+	return a_Sequence != 0 && snapshot.Sequence == a_Sequence ? &snapshot : nullptr;
+}
+
+void FCarNetBaselines::Acknowledge(const UNetConnection* a_Connection, uint16 a_Sequence)
+{
+	//Acknowledgements are unreliable, so an older one can arrive after a newer one.
+	uint16& acknowledged = Acknowledged.FindOrAdd(a_Connection, 0);
+	if (acknowledged == 0 || static_cast<int16>(static_cast<uint16>(a_Sequence - acknowledged)) > 0)
+		acknowledged = a_Sequence;
+}
+
+const FCarNetSnapshot* FCarNetBaselines::FindBaseline(const UNetConnection* a_Connection, uint16 a_Sequence) const
+{
+	const uint16* acknowledged = Acknowledged.Find(a_Connection);
+	if (acknowledged == nullptr)
+		return nullptr;
+	//Sequences skip 0 when they wrap, so being held by the history does not quite bound the distance on its own.
+	const uint16 distance = uint16(a_Sequence - *acknowledged);
+	return distance > 0 && distance < FCarNetSnapshotHistory::Size ? Sent.Find(*acknowledged) : nullptr;
+}
+
+bool FCarNetInput::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << Sequence;
+	Ar << Steering;
+	Ar << Throttle;
+	uint8 drifting = Drifting ? 1 : 0;
+	Ar.SerializeBits(&drifting, 1);
+	Drifting = drifting != 0;
+
+	bOutSuccess = true;
+	return true;
+}
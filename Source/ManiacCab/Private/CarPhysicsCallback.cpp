@@ -0,0 +1,87 @@
+#include "CarPhysicsCallback.h"
+
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+void FCarPhysicsCallback::OnPreSimulate_Internal()
+{
+	const FCarPhysicsInput* input = GetConsumerInput_Internal();
+	if (input == nullptr || input->ChassisProxy == nullptr)
+		return;
+
+	Chaos::FRigidBodyHandle_Internal* body = input->ChassisProxy->GetPhysicsThreadAPI();
+	if (body == nullptr || !body->CanTreatAsRigid())
+		return;
+
+	const float deltaTime = GetDeltaTime_Internal();
+	if (deltaTime <= 0)
+		return;
+
+	const FVector bodyLocation = body->X();
+	const FQuat bodyRotation = body->R();
+	const FVector centerOfMass = bodyLocation + bodyRotation.RotateVector(body->CenterOfMass());
+	const FVector springDirection = bodyRotation.GetUpVector();
+
+	int32 groundedWheels = 0;
+	for (const FCarPhysicsWheelInput& wheel : input->Wheels)
+		groundedWheels += wheel.Grounded ? 1 : 0;
+
+	//The bleed stands in for rolling resistance, so it needs a wheel on the ground. Zeroing V.Z with every wheel in the
+	//air would hold the car up mid jump.
+	if (input->InputAxis.SquaredLength() == 0 && groundedWheels > 0)
+	{
+		//The game thread path multiplied the planar velocity by 0.98 once per grounded wheel per 60fps frame.
+		FVector currentVel = body->V();
+		currentVel.Z = 0;
+		currentVel *= FMath::Pow(0.98f, groundedWheels * deltaTime / ReferenceFrameTime);
+		if (currentVel.SquaredLength() < 10)
+		{
+			currentVel.X = 0;
+			currentVel.Y = 0;
+		}
+		body->SetV(currentVel);
+	}
+
+	const FVector chassisVelocity = body->V();
+	const FVector angularVelocity = body->W();
+
+	FVehicleDynamicsParams& params = Batch.Params[0];
+	params = input->Params;
+	params.UpVector = FVector3f(springDirection);
+	params.ChassisVelocity = FVector3f(chassisVelocity);
+	for (int32 i = 0; i < FVehicleDynamicsBatch::WheelsPerVehicle; i++)
+	{
+		params.FrictionCurves[i] = &input->FrictionCurves[i];
+		params.TorqueCurves[i] = &input->TorqueCurves[i];
+	}
+
+	for (int32 i = 0; i < FVehicleDynamicsBatch::WheelsPerVehicle; i++)
+	{
+		const FCarPhysicsWheelInput& wheel = input->Wheels[i];
+		const FVector wheelLocation = bodyLocation + bodyRotation.RotateVector(wheel.LocalPosition);
+		const FQuat wheelRotation = bodyRotation * wheel.LocalRotation;
+		const FVector tireWorldVel = chassisVelocity + FVector::CrossProduct(angularVelocity, wheelLocation - centerOfMass);
+		Batch.SetWheel(i, FVector3f(wheelLocation), FVector3f(wheelRotation.GetForwardVector()), FVector3f(wheelRotation.GetRightVector()),
+			FVector3f(tireWorldVel), wheel.DistanceToFloor, wheel.Grounded);
+	}
+
+	SolveStep(Batch);
+
+	FVector totalForce = FVector::ZeroVector;
+	FVector totalTorque = FVector::ZeroVector;
+	for (int32 i = 0; i < FVehicleDynamicsBatch::WheelsPerVehicle; i++)
+	{
+		const FVector wheelForce = FVector(Batch.GetForce(i)) * ForceScale;
+		totalForce += wheelForce;
+		totalTorque += FVector::CrossProduct(FVector(Batch.GetPosition(i)) - centerOfMass, wheelForce);
+	}
+
+	body->AddForce(totalForce);
+	body->AddTorque(totalTorque);
+}
+
+void FCarPhysicsCallback::SolveStep(FVehicleDynamicsBatch& a_Batch)
+{
+	for (FVehicleDynamicsParams& params : a_Batch.Params)
+		params.DeltaTime = ReferenceFrameTime;
+	VehicleDynamics::Solve(a_Batch, 0, a_Batch.GetNumVehicles());
+}
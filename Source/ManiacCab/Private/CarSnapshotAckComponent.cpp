@@ -0,0 +1,98 @@
+#include "CarSnapshotAckComponent.h"
+
+#include "CarController.h"
+#include "Engine/ChildConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+
+UCarSnapshotAckComponent::UCarSnapshotAckComponent()
+{
+	SetIsReplicatedByDefault(true);
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UCarSnapshotAckComponent::QueueAck(ACarController* a_Car, uint16 a_Sequence, float a_SnapshotRate)
+{
+	PendingAcks.Add(a_Car, a_Sequence);
+	AckRate = FMath::Max(AckRate, a_SnapshotRate);
+	SetComponentTickEnabled(true);
+}
+
+void UCarSnapshotAckComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	//The server writes deltas against whatever was acknowledged last, acking faster than snapshots arrive gains nothing.
+	AckSendTimer += DeltaTime;
+	if (AckRate <= 0 || AckSendTimer < 1.0f / AckRate)
+		return;
+	AckSendTimer = 0;
+
+	TArray<FCarSnapshotAck> acks;
+	acks.Reserve(PendingAcks.Num());
+	for (const TPair<TWeakObjectPtr<ACarController>, uint16>& pending : PendingAcks)
+	{
+		FCarSnapshotAck& ack = acks.AddDefaulted_GetRef();
+		ack.Car = pending.Key.Get();
+		ack.Sequence = pending.Value;
+	}
+	PendingAcks.Reset();
+	AckRate = 0;
+	SetComponentTickEnabled(false);
+	ServerAckSnapshots(acks);
+}
+
+void UCarSnapshotAckComponent::ServerAckSnapshots_Implementation(const TArray<FCarSnapshotAck>& a_Acks)
+{
+	//Snapshots are written through the parent connection's package map, so split screen players ack for their parent.
+	const UNetConnection* connection = GetOwner()->GetNetConnection();
+	if (const UChildConnection* child = Cast<UChildConnection>(connection))
+		connection = child->Parent;
+	for (const FCarSnapshotAck& ack : a_Acks)
+	{
+		if (ack.Car != nullptr)
+			ack.Car->AcknowledgeSnapshot(connection, ack.Sequence);
+	}
+}
+
+void UCarSnapshotAckSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	if (InWorld.GetNetMode() == NM_Client || InWorld.GetNetMode() == NM_Standalone)
+		return;
+
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UCarSnapshotAckSubsystem::OnPostLogin);
+	//Controllers that logged in before play began, or came along through seamless travel.
+	for (FConstPlayerControllerIterator it = InWorld.GetPlayerControllerIterator(); it; ++it)
+		AddAckComponent(it->Get());
+}
+
+void UCarSnapshotAckSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	Super::Deinitialize();
+}
+
+bool UCarSnapshotAckSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCarSnapshotAckSubsystem::OnPostLogin(AGameModeBase* a_GameMode, APlayerController* a_Player)
+{
+	if (a_GameMode != nullptr && a_GameMode->GetWorld() == GetWorld())
+		AddAckComponent(a_Player);
+}
+
+void UCarSnapshotAckSubsystem::AddAckComponent(APlayerController* a_Player)
+{
+	//Local players read snapshots straight off the server's cars and never ack.
+	if (a_Player == nullptr || a_Player->IsLocalController() || a_Player->FindComponentByClass<UCarSnapshotAckComponent>() != nullptr)
+		return;
+
+	UCarSnapshotAckComponent* acks = NewObject<UCarSnapshotAckComponent>(a_Player, TEXT("CarSnapshotAck"));
+	a_Player->AddInstanceComponent(acks);
+	acks->RegisterComponent();
+}
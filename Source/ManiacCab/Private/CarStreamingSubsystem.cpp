@@ -0,0 +1,214 @@
+#include "CarStreamingSubsystem.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "VehicleManagerSubsystem.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LevelStreamingVolume.h"
+#include "WorldPartition/WorldPartitionRuntimeCell.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Car Streaming Tick"), STAT_ManiacCab_CarStreamingTick, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Streaming Path Points"), STAT_ManiacCab_StreamingPathPoints, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Streaming Path Points Loaded"), STAT_ManiacCab_StreamingPathPointsLoaded, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Streaming Loaded Look-Ahead (s)"), STAT_ManiacCab_StreamingLoadedLookAhead, STATGROUP_ManiacCab);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Streaming Stall Frames"), STAT_ManiacCab_StreamingStallFrames, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<bool> CVarPredictiveStreaming(
+	TEXT("ManiacCab.PredictiveStreaming"),
+	true,
+	TEXT("Stream the world in along the predicted path of locally controlled cars."));
+
+static TAutoConsoleVariable<float> CVarStreamingLookAheadScale(
+	TEXT("ManiacCab.StreamingLookAheadScale"),
+	1.0f,
+	TEXT("Multiplies every car's StreamingLookAheadTime."));
+
+namespace
+{
+	//Radius around a path point that has to be loaded for the point to count as loaded.
+	constexpr float LoadedQueryRadius = 1000.0f;
+}
+
+void UCarStreamingSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (UWorldPartitionSubsystem* worldPartition = InWorld.GetSubsystem<UWorldPartitionSubsystem>(); worldPartition != nullptr && InWorld.IsPartitionedWorld())
+		RegisteredProvider = worldPartition->RegisterStreamingSourceProvider(this);
+}
+
+void UCarStreamingSubsystem::Deinitialize()
+{
+	if (RegisteredProvider)
+	{
+		if (UWorldPartitionSubsystem* worldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>())
+			worldPartition->UnregisterStreamingSourceProvider(this);
+		RegisteredProvider = false;
+	}
+	ApplyLevelPriorities({});
+	Sources.Reset();
+	Super::Deinitialize();
+}
+
+void UCarStreamingSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_CarStreamingTick);
+
+	Sources.Reset();
+	TMap<ULevelStreaming*, int32> levelRanks;
+	const UVehicleManagerSubsystem* vehicleManager = GetWorld()->GetSubsystem<UVehicleManagerSubsystem>();
+	if (!CVarPredictiveStreaming.GetValueOnGameThread() || vehicleManager == nullptr)
+	{
+		ApplyLevelPriorities(levelRanks);
+		LoadedLookAhead = 0;
+		return;
+	}
+
+	const float lookAheadScale = FMath::Max(CVarStreamingLookAheadScale.GetValueOnGameThread(), 0.0f);
+	const ACarController* stalledVehicle = nullptr;
+	float loadedLookAhead = TNumericLimits<float>::Max();
+	int32 pathPoints = 0;
+	int32 pathPointsLoaded = 0;
+	for (const ACarController* vehicle : vehicleManager->GetVehicles())
+	{
+		if (vehicle == nullptr || !vehicle->UseStreamingSource || !vehicle->IsLocallyControlled() || !vehicle->IsVehicleReady())
+			continue;
+
+		const float lookAheadTime = vehicle->StreamingLookAheadTime * lookAheadScale;
+		const FVector location = vehicle->CarChassis->GetComponentLocation();
+		vehicle->GetPredictedPath(lookAheadTime, PathPoints);
+
+		const FRotator heading = vehicle->GetChassisLinearVelocity().GetSafeNormal2D().Rotation();
+		for (int32 i = 0; i < PathPoints.Num(); i++)
+		{
+			FWorldPartitionStreamingSource& source = Sources.AddDefaulted_GetRef();
+			source.Name = *FString::Printf(TEXT("%s_Path%d"), *vehicle->GetName(), i);
+			source.Location = PathPoints[i];
+			source.Rotation = heading;
+			source.TargetState = EStreamingSourceTargetState::Activated;
+			//The first half of the path is about to be driven through, it goes ahead of everything else.
+			source.Priority = i < PathPoints.Num() / 2 ? EStreamingSourcePriority::High : EStreamingSourcePriority::Normal;
+		}
+		GatherPathLevels(PathPoints, levelRanks);
+
+		if (stalledVehicle == nullptr && !IsLoadedAt(location))
+			stalledVehicle = vehicle;
+		int32 loaded = 0;
+		while (loaded < PathPoints.Num() && IsLoadedAt(PathPoints[loaded]))
+			loaded++;
+		pathPoints += PathPoints.Num();
+		pathPointsLoaded += loaded;
+		loadedLookAhead = FMath::Min(loadedLookAhead, PathPoints.Num() > 0 ? lookAheadTime * loaded / PathPoints.Num() : 0.0f);
+	}
+	ApplyLevelPriorities(levelRanks);
+
+	LoadedLookAhead = pathPoints > 0 ? loadedLookAhead : 0;
+	const bool stalled = stalledVehicle != nullptr;
+	if (stalled)
+	{
+		StallFrames++;
+		INC_DWORD_STAT(STAT_ManiacCab_StreamingStallFrames);
+		if (!Stalled)
+			UE_LOG(LogManiacCab, Log, TEXT("Streaming stall: %s reached %s at %.0f cm/s before it was loaded."), *stalledVehicle->GetName(),
+				*stalledVehicle->CarChassis->GetComponentLocation().ToCompactString(), stalledVehicle->GetChassisLinearVelocity().Size());
+	}
+	Stalled = stalled;
+
+	SET_DWORD_STAT(STAT_ManiacCab_StreamingPathPoints, pathPoints);
+	SET_DWORD_STAT(STAT_ManiacCab_StreamingPathPointsLoaded, pathPointsLoaded);
+	SET_FLOAT_STAT(STAT_ManiacCab_StreamingLoadedLookAhead, LoadedLookAhead);
+	CSV_CUSTOM_STAT(ManiacCab, StreamingLoadedLookAhead, LoadedLookAhead, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ManiacCab, StreamingStall, stalled ? 1 : 0, ECsvCustomStatOp::Set);
+}
+
+bool UCarStreamingSubsystem::GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const
+{
+	OutStreamingSources.Append(Sources);
+	return Sources.Num() > 0;
+}
+
+bool UCarStreamingSubsystem::IsLoadedAt(const FVector& a_Location) const
+{
+	const UWorld* world = GetWorld();
+	if (RegisteredProvider)
+	{
+		const UWorldPartitionSubsystem* worldPartition = world->GetSubsystem<UWorldPartitionSubsystem>();
+		FWorldPartitionStreamingQuerySource query;
+		query.Location = a_Location;
+		query.Radius = LoadedQueryRadius;
+		query.bUseGridLoadingRange = false;
+		query.bSpatialQuery = true;
+		return worldPartition == nullptr || worldPartition->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, { query }, false);
+	}
+
+	for (const ULevelStreaming* level : world->GetStreamingLevels())
+	{
+		if (level != nullptr && !level->IsLevelVisible() && IsInStreamingVolume(level, a_Location))
+			return false;
+	}
+	return true;
+}
+
+bool UCarStreamingSubsystem::IsInStreamingVolume(const ULevelStreaming* a_Level, const FVector& a_Location)
+{
+	//The same volumes UWorld::ProcessLevelStreamingVolumes streams the level by.
+	for (const ALevelStreamingVolume* volume : a_Level->EditorStreamingVolumes)
+	{
+		if (volume != nullptr && !volume->bDisabled && volume->EncompassesPoint(a_Location))
+			return true;
+	}
+	return false;
+}
+
+void UCarStreamingSubsystem::GatherPathLevels(TConstArrayView<FVector> a_Path, TMap<ULevelStreaming*, int32>& o_Ranks) const
+{
+	if (RegisteredProvider)
+		return;
+
+	for (ULevelStreaming* level : GetWorld()->GetStreamingLevels())
+	{
+		if (level == nullptr || level->EditorStreamingVolumes.IsEmpty())
+			continue;
+		//Ranked by the first point inside the level's volumes.
+		for (int32 i = 0; i < a_Path.Num(); i++)
+		{
+			if (IsInStreamingVolume(level, a_Path[i]))
+			{
+				int32& rank = o_Ranks.FindOrAdd(level, 0);
+				rank = FMath::Max(rank, a_Path.Num() - i);
+				break;
+			}
+		}
+	}
+}
+
+void UCarStreamingSubsystem::ApplyLevelPriorities(const TMap<ULevelStreaming*, int32>& a_Ranks)
+{
+	for (auto it = RaisedLevels.CreateIterator(); it; ++it)
+	{
+		ULevelStreaming* level = it.Key().Get();
+		if (level == nullptr || !a_Ranks.Contains(level))
+		{
+			if (level != nullptr)
+				level->SetPriority(it.Value());
+			it.RemoveCurrent();
+		}
+	}
+	for (const TPair<ULevelStreaming*, int32>& rank : a_Ranks)
+	{
+		const int32 originalPriority = RaisedLevels.FindOrAdd(rank.Key, rank.Key->GetPriority());
+		rank.Key->SetPriority(originalPriority + rank.Value);
+	}
+}
+
+TStatId UCarStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCarStreamingSubsystem, STATGROUP_Tickables);
+}
+
+bool UCarStreamingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,190 @@
+#include "CarSurfaceSubsystem.h"
+
+#include "ManiacCab.h"
+#include "EngineUtils.h"
+#include "LandscapeProxy.h"
+#include "LandscapeHeightfieldCollisionComponent.h"
+#include "LandscapeLayerInfoObject.h"
+#include "Engine/Level.h"
+
+DECLARE_CYCLE_STAT(TEXT("Surface Grid Rasterise"), STAT_ManiacCab_SurfaceRasterise, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Raster Traces"), STAT_ManiacCab_SurfaceRasterTraces, STATGROUP_ManiacCab);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Surface Grid Tiles"), STAT_ManiacCab_SurfaceTiles, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<int32> CVarSurfaceTracesPerFrame(
+	TEXT("ManiacCab.SurfaceTracesPerFrame"),
+	2048,
+	TEXT("Traces per frame spent rasterising streamed in landscape components into the surface grid."));
+
+namespace
+{
+	//Starts above the landscape so roads and bridges over it are found first.
+	constexpr float RasterTraceHeight = 1000.0f;
+	//Landscape that is painted with no layer the cars know about.
+	constexpr ECarSurfaceType UnmatchedLandscapeSurface = ECarSurfaceType::Grass;
+
+	FIntPoint ToCell(const FVector& a_Location)
+	{
+		return FIntPoint(FMath::FloorToInt32(a_Location.X / UCarSurfaceSubsystem::CellSize), FMath::FloorToInt32(a_Location.Y / UCarSurfaceSubsystem::CellSize));
+	}
+}
+
+void UCarSurfaceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (TActorIterator<ALandscapeProxy> it(&InWorld); it; ++it)
+		QueueLandscape(*it);
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UCarSurfaceSubsystem::OnLevelAdded);
+}
+
+void UCarSurfaceSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	DEC_DWORD_STAT_BY(STAT_ManiacCab_SurfaceTiles, Tiles.Num());
+	Tiles.Reset();
+	PendingComponents.Reset();
+	LayerSurfaces.Reset();
+	Super::Deinitialize();
+}
+
+bool UCarSurfaceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UCarSurfaceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCarSurfaceSubsystem, STATGROUP_Tickables);
+}
+
+void UCarSurfaceSubsystem::OnLevelAdded(ULevel* a_Level, UWorld* a_World)
+{
+	if (a_World != GetWorld() || a_Level == nullptr)
+		return;
+
+	for (AActor* actor : a_Level->Actors)
+	{
+		if (ALandscapeProxy* landscape = Cast<ALandscapeProxy>(actor))
+			QueueLandscape(landscape);
+	}
+}
+
+void UCarSurfaceSubsystem::QueueLandscape(ALandscapeProxy* a_Landscape)
+{
+	const UEnum* surfaceEnum = StaticEnum<ECarSurfaceType>();
+	for (ULandscapeHeightfieldCollisionComponent* component : a_Landscape->CollisionComponents)
+	{
+		if (component == nullptr)
+			continue;
+
+		//Layers are matched once, by the surface type's name appearing in the layer's, e.g. Grass_LayerInfo is named Grass.
+		for (const ULandscapeLayerInfoObject* layerInfo : component->ComponentLayerInfos)
+		{
+			if (layerInfo == nullptr || layerInfo->PhysMaterial == nullptr || LayerSurfaces.Contains(layerInfo->PhysMaterial.Get()))
+				continue;
+
+			const FString layerName = layerInfo->LayerName.ToString();
+			for (int32 i = 0; i < SurfaceTypeCount; i++)
+			{
+				if (layerName.Contains(surfaceEnum->GetNameStringByIndex(i)))
+				{
+					LayerSurfaces.Add(layerInfo->PhysMaterial.Get(), ECarSurfaceType(i));
+					break;
+				}
+			}
+		}
+
+		const FBox bounds = component->Bounds.GetBox();
+		FPendingComponent& pending = PendingComponents.AddDefaulted_GetRef();
+		pending.Component = component;
+		pending.MinCell = ToCell(bounds.Min);
+		pending.MaxCell = ToCell(bounds.Max);
+	}
+}
+
+void UCarSurfaceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (PendingComponents.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_SurfaceRasterise);
+	int32 traceBudget = FMath::Max(CVarSurfaceTracesPerFrame.GetValueOnGameThread(), 1);
+	while (traceBudget > 0 && PendingComponents.Num() > 0)
+	{
+		FPendingComponent& pending = PendingComponents.Last();
+		const int32 cellCount = (pending.MaxCell.X - pending.MinCell.X + 1) * (pending.MaxCell.Y - pending.MinCell.Y + 1);
+		if (pending.Component.IsValid())
+			traceBudget -= RasteriseComponent(pending, traceBudget);
+
+		if (!pending.Component.IsValid() || pending.NextCell >= cellCount)
+			PendingComponents.Pop(EAllowShrinking::No);
+	}
+
+	if (PendingComponents.Num() == 0)
+		UE_LOG(LogManiacCab, Log, TEXT("Surface grid rasterised: %d tiles, %d KB"), Tiles.Num(), Tiles.Num() * int32(sizeof(FSurfaceTile)) / 1024);
+}
+
+int32 UCarSurfaceSubsystem::RasteriseComponent(FPendingComponent& a_Pending, int32 a_TraceBudget)
+{
+	const UWorld* world = GetWorld();
+	const FBox bounds = a_Pending.Component->Bounds.GetBox();
+	const int32 width = a_Pending.MaxCell.X - a_Pending.MinCell.X + 1;
+	const int32 cellCount = width * (a_Pending.MaxCell.Y - a_Pending.MinCell.Y + 1);
+
+	FCollisionQueryParams queryParams(SCENE_QUERY_STAT(CarSurfaceRaster), false);
+	queryParams.bReturnPhysicalMaterial = true;
+	const FCollisionObjectQueryParams objectParams(ECC_WorldStatic);
+
+	int32 traces = 0;
+	for (; a_Pending.NextCell < cellCount && traces < a_TraceBudget; a_Pending.NextCell++, traces++)
+	{
+		const FIntPoint cell(a_Pending.MinCell.X + a_Pending.NextCell % width, a_Pending.MinCell.Y + a_Pending.NextCell / width);
+		const FVector cellCenter((cell.X + 0.5f) * CellSize, (cell.Y + 0.5f) * CellSize, 0);
+		const FVector traceStart(cellCenter.X, cellCenter.Y, bounds.Max.Z + RasterTraceHeight);
+		const FVector traceEnd(cellCenter.X, cellCenter.Y, bounds.Min.Z - 1.0f);
+
+		FHitResult hit;
+		if (world->LineTraceSingleByObjectType(hit, traceStart, traceEnd, objectParams, queryParams))
+			SetCell(cell, ClassifyHit(hit));
+	}
+
+	INC_DWORD_STAT_BY(STAT_ManiacCab_SurfaceRasterTraces, traces);
+	return traces;
+}
+
+ECarSurfaceType UCarSurfaceSubsystem::ClassifyHit(const FHitResult& a_Hit) const
+{
+	//Everything placed on top of the landscape that cars drive over is a road.
+	const UPrimitiveComponent* component = a_Hit.GetComponent();
+	if (component == nullptr || !component->IsA<ULandscapeHeightfieldCollisionComponent>())
+		return ECarSurfaceType::Road;
+
+	const ECarSurfaceType* layerSurface = LayerSurfaces.Find(a_Hit.PhysMaterial.Get());
+	return layerSurface != nullptr ? *layerSurface : UnmatchedLandscapeSurface;
+}
+
+void UCarSurfaceSubsystem::SetCell(const FIntPoint& a_Cell, ECarSurfaceType a_Surface)
+{
+	const FIntPoint tileKey(a_Cell.X >> TileShift, a_Cell.Y >> TileShift);
+	TUniquePtr<FSurfaceTile>& tile = Tiles.FindOrAdd(tileKey);
+	if (!tile.IsValid())
+	{
+		tile = MakeUnique<FSurfaceTile>();
+		FMemory::Memset(tile->Cells, UnknownSurface, sizeof(tile->Cells));
+		INC_DWORD_STAT(STAT_ManiacCab_SurfaceTiles);
+	}
+	tile->Cells[(a_Cell.Y & (TileCells - 1)) * TileCells + (a_Cell.X & (TileCells - 1))] = uint8(a_Surface);
+}
+
+ECarSurfaceType UCarSurfaceSubsystem::GetSurfaceAt(const FVector& a_Location) const
+{
+	const FIntPoint cell = ToCell(a_Location);
+	const TUniquePtr<FSurfaceTile>* tile = Tiles.Find(FIntPoint(cell.X >> TileShift, cell.Y >> TileShift));
+	if (tile == nullptr)
+		return ECarSurfaceType::Road;
+
+	const uint8 surface = (*tile)->Cells[(cell.Y & (TileCells - 1)) * TileCells + (cell.X & (TileCells - 1))];
+	return surface == UnknownSurface ? ECarSurfaceType::Road : ECarSurfaceType(surface);
+}
@@ -0,0 +1,49 @@
+#include "CurveBakingSubsystem.h"
+
+#include "ManiacCab.h"
+#include "Curves/CurveFloat.h"
+
+static TAutoConsoleVariable<float> CVarCurveBakeTolerance(
+	TEXT("ManiacCab.CurveBakeTolerance"),
+	0.01f,
+	TEXT("Largest allowed difference between a baked curve table and its source curve before a warning is logged."));
+
+const FBakedCurve* UCurveBakingSubsystem::GetBakedCurve(const UCurveFloat* a_Curve)
+{
+	if (a_Curve == nullptr)
+		return nullptr;
+
+	if (const TUniquePtr<FBakedCurve>* existing = BakedCurves.Find(a_Curve))
+		return existing->Get();
+
+	TUniquePtr<FBakedCurve>& bakedCurve = BakedCurves.Add(a_Curve, MakeUnique<FBakedCurve>());
+	BakeCurve(a_Curve, *bakedCurve);
+
+#if WITH_EDITOR
+	const_cast<UCurveFloat*>(a_Curve)->OnUpdateCurve.AddUObject(this, &UCurveBakingSubsystem::OnCurveUpdated);
+#endif
+	return bakedCurve.Get();
+}
+
+void UCurveBakingSubsystem::BakeCurve(const UCurveFloat* a_Curve, FBakedCurve& o_BakedCurve) const
+{
+	const FRichCurve& sourceCurve = a_Curve->FloatCurve;
+	auto evaluate = [&sourceCurve](float a_Time) { return sourceCurve.Eval(a_Time); };
+	o_BakedCurve.Bake(0.0f, 1.0f, evaluate);
+
+	const float maxError = o_BakedCurve.MeasureMaxError(evaluate);
+	if (maxError > CVarCurveBakeTolerance.GetValueOnGameThread())
+	{
+		UE_LOG(LogManiacCab, Warning, TEXT("Baked curve %s differs from the source by up to %f, it may need more than %d samples."),
+			*a_Curve->GetName(), maxError, FBakedCurve::SampleCount);
+	}
+}
+
+#if WITH_EDITOR
+void UCurveBakingSubsystem::OnCurveUpdated(UCurveBase* a_Curve, EPropertyChangeType::Type a_ChangeType)
+{
+	const UCurveFloat* curve = Cast<UCurveFloat>(a_Curve);
+	if (const TUniquePtr<FBakedCurve>* bakedCurve = curve != nullptr ? BakedCurves.Find(curve) : nullptr)
+		BakeCurve(curve, **bakedCurve);
+}
+#endif
@@ -0,0 +1,304 @@
+#include "GhostCarManager.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "Algo/Count.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ghost Playback Tick"), STAT_ManiacCab_GhostTick, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Ghosts"), STAT_ManiacCab_ActiveGhosts, STATGROUP_ManiacCab);
+
+namespace
+{
+	//Free ghost slots keep their instances, collapsed to nothing.
+	const FTransform HiddenTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+}
+
+AGhostCarManager::AGhostCarManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	//Record and draw after the cars have moved this frame.
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+
+	const TCHAR* partNames[PartCount] = { TEXT("BodyInstances"), TEXT("FrontLeftWheelInstances"), TEXT("FrontRightWheelInstances"),
+		TEXT("BackLeftWheelInstances"), TEXT("BackRightWheelInstances") };
+	for (const TCHAR* partName : partNames)
+	{
+		UInstancedStaticMeshComponent* instances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(partName);
+		instances->SetupAttachment(RootComponent);
+		instances->SetMobility(EComponentMobility::Movable);
+		instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		instances->SetCanEverAffectNavigation(false);
+		PartInstances.Add(instances);
+	}
+}
+
+void AGhostCarManager::BeginPlay()
+{
+	Super::BeginPlay();
+	ApplyMeshes();
+}
+
+void AGhostCarManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	RemoveAllGhosts();
+	Recordings.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGhostCarManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_GhostTick);
+
+	UpdateRecordings(DeltaTime);
+
+	int32 activeGhosts = 0;
+	for (int32 i = 0; i < Ghosts.Num(); i++)
+	{
+		FGhostPlayback& ghost = *Ghosts[i];
+		FTransform transforms[PartCount];
+		bool visible = false;
+		if (ghost.Active)
+		{
+			ghost.PlaybackTime += DeltaTime;
+			UpdateDecoding(ghost);
+			visible = SampleGhost(ghost, transforms);
+
+			const double lastSample = double(ghost.FirstSampleIndex + ghost.Samples.Num() - 1);
+			if (ghost.ReachedEnd && ghost.PlaybackTime * ghost.Reader.GetSampleRate() >= lastSample)
+			{
+				RemoveGhost(i);
+				visible = false;
+			}
+			else
+			{
+				activeGhosts++;
+			}
+		}
+
+		for (int32 part = 0; part < PartCount; part++)
+			PartTransforms[part][i] = visible ? transforms[part] : HiddenTransform;
+	}
+
+	if (Ghosts.Num() > 0)
+	{
+		for (int32 part = 0; part < PartCount; part++)
+			PartInstances[part]->BatchUpdateInstancesTransforms(0, PartTransforms[part], true, true, true);
+	}
+	SET_DWORD_STAT(STAT_ManiacCab_ActiveGhosts, activeGhosts);
+}
+
+void AGhostCarManager::CopyMeshesFromCar(const ACarController* a_Car)
+{
+	if (a_Car == nullptr)
+		return;
+
+	BodyMesh = a_Car->CarChassis->GetStaticMesh();
+	FrontLeftWheelMesh = a_Car->FrontLeftWheel->GetStaticMesh();
+	FrontRightWheelMesh = a_Car->FrontRightWheel->GetStaticMesh();
+	BackLeftWheelMesh = a_Car->BackLeftWheel->GetStaticMesh();
+	BackRightWheelMesh = a_Car->BackRightWheel->GetStaticMesh();
+	ApplyMeshes();
+}
+
+void AGhostCarManager::ApplyMeshes()
+{
+	UStaticMesh* meshes[PartCount] = { BodyMesh, FrontLeftWheelMesh, FrontRightWheelMesh, BackLeftWheelMesh, BackRightWheelMesh };
+	for (int32 part = 0; part < PartCount; part++)
+	{
+		PartInstances[part]->SetStaticMesh(meshes[part]);
+		if (GhostMaterial != nullptr)
+		{
+			for (int32 slot = 0; slot < PartInstances[part]->GetNumMaterials(); slot++)
+				PartInstances[part]->SetMaterial(slot, GhostMaterial);
+		}
+	}
+}
+
+int32 AGhostCarManager::AddGhost(const FString& a_Path, bool a_Loop, float a_StartTime)
+{
+	int32 ghostId = Ghosts.IndexOfByPredicate([](const TUniquePtr<FGhostPlayback>& a_Ghost) { return !a_Ghost->Active; });
+	if (ghostId == INDEX_NONE)
+	{
+		ghostId = Ghosts.Add(MakeUnique<FGhostPlayback>());
+		for (int32 part = 0; part < PartCount; part++)
+		{
+			PartInstances[part]->AddInstance(HiddenTransform, true);
+			PartTransforms[part].Add(HiddenTransform);
+		}
+	}
+
+	FGhostPlayback& ghost = *Ghosts[ghostId];
+	if (!ghost.Reader.Open(a_Path))
+		return INDEX_NONE;
+
+	const int64 startSample = int64(FMath::Max(a_StartTime, 0.0f) * ghost.Reader.GetSampleRate());
+	ghost.Reader.Seek(startSample);
+	ghost.Samples.Reset();
+	ghost.Staging.Reset();
+	ghost.FirstSampleIndex = startSample;
+	ghost.PlaybackTime = startSample / ghost.Reader.GetSampleRate();
+	ghost.Loop = a_Loop;
+	ghost.ReachedEnd = false;
+	ghost.DecodedToEnd = false;
+	ghost.Active = true;
+	UpdateDecoding(ghost);
+	return ghostId;
+}
+
+void AGhostCarManager::RemoveGhost(int32 a_GhostId)
+{
+	if (!Ghosts.IsValidIndex(a_GhostId))
+		return;
+
+	FGhostPlayback& ghost = *Ghosts[a_GhostId];
+	ghost.DecodeTask.Wait();
+	ghost.Reader.Close();
+	ghost.Samples.Empty();
+	ghost.Staging.Empty();
+	ghost.Active = false;
+}
+
+void AGhostCarManager::RemoveAllGhosts()
+{
+	for (int32 i = 0; i < Ghosts.Num(); i++)
+		RemoveGhost(i);
+}
+
+int32 AGhostCarManager::GetNumActiveGhosts() const
+{
+	return Algo::CountIf(Ghosts, [](const TUniquePtr<FGhostPlayback>& a_Ghost) { return a_Ghost->Active; });
+}
+
+void AGhostCarManager::UpdateDecoding(FGhostPlayback& a_Ghost)
+{
+	if (!a_Ghost.DecodeTask.IsCompleted())
+		return;
+
+	a_Ghost.Samples.Append(MoveTemp(a_Ghost.Staging));
+	a_Ghost.Staging.Reset();
+	a_Ghost.ReachedEnd = a_Ghost.DecodedToEnd;
+
+	//Drop what the playhead has passed, in blocks so the buffer is not shifted every frame.
+	const int64 playhead = int64(a_Ghost.PlaybackTime * a_Ghost.Reader.GetSampleRate());
+	const int32 consumed = int32(FMath::Clamp<int64>(playhead - a_Ghost.FirstSampleIndex, 0, a_Ghost.Samples.Num()));
+	if (consumed >= DecodeBlockSize)
+	{
+		a_Ghost.Samples.RemoveAt(0, consumed, EAllowShrinking::No);
+		a_Ghost.FirstSampleIndex += consumed;
+	}
+
+	const int64 bufferedAhead = a_Ghost.FirstSampleIndex + a_Ghost.Samples.Num() - playhead;
+	if (bufferedAhead >= DecodeBlockSize || a_Ghost.ReachedEnd)
+		return;
+
+	FGhostPlayback* ghost = &a_Ghost;
+	a_Ghost.DecodeTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [ghost]()
+	{
+		if (ghost->Reader.ReadSamples(ghost->Staging, DecodeBlockSize) > 0)
+			return;
+
+		if (ghost->Loop)
+		{
+			ghost->Reader.Rewind();
+			ghost->Reader.ReadSamples(ghost->Staging, DecodeBlockSize);
+		}
+		else
+		{
+			ghost->DecodedToEnd = true;
+		}
+	});
+}
+
+bool AGhostCarManager::SampleGhost(FGhostPlayback& a_Ghost, FTransform (&o_PartTransforms)[PartCount]) const
+{
+	const int32 numSamples = a_Ghost.Samples.Num();
+	const double samplePosition = a_Ghost.PlaybackTime * a_Ghost.Reader.GetSampleRate() - a_Ghost.FirstSampleIndex;
+	if (numSamples == 0 || samplePosition < 0)
+		return false;
+
+	//If decoding falls behind the ghost holds its last decoded pose.
+	const int32 from = FMath::Min(FMath::FloorToInt32(samplePosition), numSamples - 1);
+	const int32 to = FMath::Min(from + 1, numSamples - 1);
+	const float alpha = from == to ? 0.0f : float(samplePosition - from);
+	const FCarGhostSample& fromSample = a_Ghost.Samples[from];
+	const FCarGhostSample& toSample = a_Ghost.Samples[to];
+
+	const FTransform chassis(FQuat(FQuat4f::Slerp(fromSample.ChassisRotation, toSample.ChassisRotation, alpha)),
+		FVector(FMath::Lerp(fromSample.ChassisLocation, toSample.ChassisLocation, alpha)));
+	o_PartTransforms[0] = chassis;
+	for (int32 i = 0; i < FCarGhostSample::WheelCount; i++)
+	{
+		const FTransform wheel(FQuat(FQuat4f::Slerp(fromSample.WheelRotations[i], toSample.WheelRotations[i], alpha)),
+			FVector(FMath::Lerp(fromSample.WheelLocations[i], toSample.WheelLocations[i], alpha)));
+		o_PartTransforms[1 + i] = wheel * chassis;
+	}
+	return true;
+}
+
+bool AGhostCarManager::StartRecordingGhost(ACarController* a_Car, const FString& a_Path)
+{
+	if (a_Car == nullptr)
+		return false;
+
+	StopRecordingGhost(a_Car);
+	FGhostRecording& recording = Recordings.AddDefaulted_GetRef();
+	recording.Car = a_Car;
+	recording.Writer = MakeUnique<FCarGhostWriter>();
+	if (!recording.Writer->Open(a_Path, RecordingSampleRate))
+	{
+		Recordings.Pop();
+		return false;
+	}
+	//Take the first sample on the next tick.
+	recording.TimeSinceSample = 1.0 / RecordingSampleRate;
+	return true;
+}
+
+void AGhostCarManager::StopRecordingGhost(ACarController* a_Car)
+{
+	Recordings.RemoveAll([a_Car](const FGhostRecording& a_Recording) { return a_Recording.Car.Get() == a_Car; });
+}
+
+void AGhostCarManager::UpdateRecordings(float a_DeltaTime)
+{
+	for (int32 i = Recordings.Num() - 1; i >= 0; i--)
+	{
+		FGhostRecording& recording = Recordings[i];
+		const ACarController* car = recording.Car.Get();
+		if (car == nullptr)
+		{
+			Recordings.RemoveAtSwap(i);
+			continue;
+		}
+
+		//Samples are at a fixed rate so their index is their timestamp. In a long frame the current pose fills every missed slot.
+		const double interval = 1.0 / recording.Writer->GetSampleRate();
+		recording.TimeSinceSample += a_DeltaTime;
+		if (recording.TimeSinceSample < interval)
+			continue;
+
+		const FCarGhostSample sample = CaptureSample(car);
+		for (; recording.TimeSinceSample >= interval; recording.TimeSinceSample -= interval)
+			recording.Writer->WriteSample(sample);
+	}
+}
+
+FCarGhostSample AGhostCarManager::CaptureSample(const ACarController* a_Car)
+{
+	const UStaticMeshComponent* wheels[FCarGhostSample::WheelCount] = { a_Car->FrontLeftWheel, a_Car->FrontRightWheel, a_Car->BackLeftWheel, a_Car->BackRightWheel };
+	const FTransform chassis = a_Car->CarChassis->GetComponentTransform();
+
+	FCarGhostSample sample;
+	sample.ChassisLocation = FVector3f(chassis.GetLocation());
+	sample.ChassisRotation = FQuat4f(chassis.GetRotation());
+	for (int32 i = 0; i < FCarGhostSample::WheelCount; i++)
+	{
+		const FTransform wheel = wheels[i]->GetComponentTransform().GetRelativeTransform(chassis);
+		sample.WheelLocations[i] = FVector3f(wheel.GetLocation());
+		sample.WheelRotations[i] = FQuat4f(wheel.GetRotation());
+	}
+	return sample;
+}
@@ -0,0 +1,569 @@
+#include "RoadGraph.h"
+
+#include "ManiacCab.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeRWLock.h"
+#include "Tasks/Task.h"
+
+DECLARE_CYCLE_STAT(TEXT("Road Route Query"), STAT_ManiacCab_RoadRouteQuery, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Road Route Queries"), STAT_ManiacCab_RoadRouteQueries, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Road Route Cache Misses"), STAT_ManiacCab_RoadRouteCacheMisses, STATGROUP_ManiacCab);
+
+namespace
+{
+	struct FQueueEntry
+	{
+		float Priority = 0;
+		int32 Node = 0;
+	};
+
+	struct FQueueOrder
+	{
+		bool operator()(const FQueueEntry& a_A, const FQueueEntry& a_B) const { return a_A.Priority < a_B.Priority; }
+	};
+
+	FIntPoint ToCell(const FVector3f& a_Location, float a_CellSize)
+	{
+		return FIntPoint(FMath::FloorToInt32(a_Location.X / a_CellSize), FMath::FloorToInt32(a_Location.Y / a_CellSize));
+	}
+}
+
+int32 FRoadGraph::FindNearestNode(const FVector3f& a_Location) const
+{
+	const FIntPoint cell = ToCell(a_Location, LookupCellSize);
+	int32 nearest = INDEX_NONE;
+	float nearestDistanceSquared = FMath::Square(LookupCellSize);
+	for (int32 y = -1; y <= 1; y++)
+	{
+		for (int32 x = -1; x <= 1; x++)
+		{
+			const TArray<int32>* nodes = LookupCells.Find(cell + FIntPoint(x, y));
+			if (nodes == nullptr)
+				continue;
+
+			for (const int32 node : *nodes)
+			{
+				const float distanceSquared = FVector3f::DistSquared(NodePositions[node], a_Location);
+				if (distanceSquared < nearestDistanceSquared)
+				{
+					nearest = node;
+					nearestDistanceSquared = distanceSquared;
+				}
+			}
+		}
+	}
+	return nearest;
+}
+
+FRoadGraphBuilder::FRoadGraphBuilder(float a_SnapDistance, float a_RegionSize)
+	: SnapDistance(FMath::Max(a_SnapDistance, 1.0f))
+	, RegionSize(FMath::Max(a_RegionSize, a_SnapDistance))
+{
+}
+
+int32 FRoadGraphBuilder::FindOrAddNode(const FVector3f& a_Location)
+{
+	const FIntPoint cell = ToCell(a_Location, SnapDistance);
+	for (int32 y = -1; y <= 1; y++)
+	{
+		for (int32 x = -1; x <= 1; x++)
+		{
+			const TArray<int32>* nodes = NodeCells.Find(cell + FIntPoint(x, y));
+			if (nodes == nullptr)
+				continue;
+
+			for (const int32 node : *nodes)
+			{
+				if (FVector3f::DistSquared(Nodes[node], a_Location) <= FMath::Square(SnapDistance))
+					return node;
+			}
+		}
+	}
+
+	const int32 node = Nodes.Add(a_Location);
+	NodeCells.FindOrAdd(cell).Add(node);
+	return node;
+}
+
+void FRoadGraphBuilder::AddRoad(TArrayView<const FVector3f> a_Points, bool a_OneWay)
+{
+	if (a_Points.Num() < 2)
+		return;
+
+	FRoad road;
+	road.From = FindOrAddNode(a_Points[0]);
+	road.To = FindOrAddNode(a_Points.Last());
+	road.OneWay = a_OneWay;
+	//Loops and roads shorter than the snap distance lead nowhere.
+	if (road.From == road.To)
+		return;
+
+	//The ends are moved onto the shared nodes so the road meets its neighbours, and so its length is never shorter
+	//than the straight line between its nodes, which A* relies on.
+	TArray<FVector3f> polyline(a_Points.GetData(), a_Points.Num());
+	polyline[0] = Nodes[road.From];
+	polyline.Last() = Nodes[road.To];
+
+	//Resampled at an even spacing so followers get steady points however the road was authored.
+	road.Samples.Add(polyline[0]);
+	float untilNext = SampleSpacing;
+	for (int32 i = 1; i < polyline.Num(); i++)
+	{
+		const float segmentLength = FVector3f::Dist(polyline[i - 1], polyline[i]);
+		road.Length += segmentLength;
+
+		float along = untilNext;
+		for (; along < segmentLength; along += SampleSpacing)
+			road.Samples.Add(FMath::Lerp(polyline[i - 1], polyline[i], along / segmentLength));
+		untilNext = along - segmentLength;
+	}
+
+	if (road.Samples.Num() > 1 && FVector3f::Dist(road.Samples.Last(), polyline.Last()) < SampleSpacing * 0.25f)
+		road.Samples.Last() = polyline.Last();
+	else
+		road.Samples.Add(polyline.Last());
+
+	Roads.Add(MoveTemp(road));
+}
+
+FRoadGraph FRoadGraphBuilder::Build() const
+{
+	FRoadGraph graph;
+	const int32 nodeCount = Nodes.Num();
+	graph.NodePositions = Nodes;
+
+	TMap<FIntPoint, int32> regions;
+	graph.NodeRegions.SetNumUninitialized(nodeCount);
+	for (int32 node = 0; node < nodeCount; node++)
+		graph.NodeRegions[node] = regions.FindOrAdd(ToCell(Nodes[node], RegionSize), regions.Num());
+	graph.NumRegions = regions.Num();
+
+	//Out edges are bucketed by source node: one edge per one way road, one each way otherwise.
+	graph.EdgeStarts.Init(0, nodeCount + 1);
+	for (const FRoad& road : Roads)
+	{
+		graph.EdgeStarts[road.From + 1]++;
+		if (!road.OneWay)
+			graph.EdgeStarts[road.To + 1]++;
+	}
+	for (int32 node = 0; node < nodeCount; node++)
+		graph.EdgeStarts[node + 1] += graph.EdgeStarts[node];
+
+	const int32 edgeCount = graph.EdgeStarts[nodeCount];
+	graph.EdgeSources.SetNumUninitialized(edgeCount);
+	graph.EdgeTargets.SetNumUninitialized(edgeCount);
+	graph.EdgeCosts.SetNumUninitialized(edgeCount);
+	TArray<const FRoad*> edgeRoads;
+	edgeRoads.SetNumUninitialized(edgeCount);
+
+	TArray<int32> nextEdge(graph.EdgeStarts.GetData(), nodeCount);
+	auto addEdge = [&](int32 a_From, int32 a_To, const FRoad& a_Road)
+	{
+		const int32 edge = nextEdge[a_From]++;
+		graph.EdgeSources[edge] = a_From;
+		graph.EdgeTargets[edge] = a_To;
+		graph.EdgeCosts[edge] = a_Road.Length;
+		edgeRoads[edge] = &a_Road;
+	};
+	for (const FRoad& road : Roads)
+	{
+		addEdge(road.From, road.To, road);
+		if (!road.OneWay)
+			addEdge(road.To, road.From, road);
+	}
+
+	graph.SampleStarts.SetNumUninitialized(edgeCount + 1);
+	for (int32 edge = 0; edge < edgeCount; edge++)
+	{
+		graph.SampleStarts[edge] = graph.Samples.Num();
+		const TArray<FVector3f>& samples = edgeRoads[edge]->Samples;
+		if (graph.EdgeSources[edge] == edgeRoads[edge]->From)
+		{
+			graph.Samples.Append(samples);
+		}
+		else
+		{
+			for (int32 i = samples.Num() - 1; i >= 0; i--)
+				graph.Samples.Add(samples[i]);
+		}
+	}
+	graph.SampleStarts[edgeCount] = graph.Samples.Num();
+
+	graph.ReverseEdgeStarts.Init(0, nodeCount + 1);
+	for (int32 edge = 0; edge < edgeCount; edge++)
+		graph.ReverseEdgeStarts[graph.EdgeTargets[edge] + 1]++;
+	for (int32 node = 0; node < nodeCount; node++)
+		graph.ReverseEdgeStarts[node + 1] += graph.ReverseEdgeStarts[node];
+
+	graph.ReverseEdges.SetNumUninitialized(edgeCount);
+	nextEdge = TArray<int32>(graph.ReverseEdgeStarts.GetData(), nodeCount);
+	for (int32 edge = 0; edge < edgeCount; edge++)
+		graph.ReverseEdges[nextEdge[graph.EdgeTargets[edge]]++] = edge;
+
+	for (int32 node = 0; node < nodeCount; node++)
+		graph.LookupCells.FindOrAdd(ToCell(Nodes[node], FRoadGraph::LookupCellSize)).Add(node);
+
+	return graph;
+}
+
+FRoadRouter::FRoadRouter(TSharedRef<const FRoadGraph> a_Graph, int32 a_CacheCapacity)
+	: Graph(MoveTemp(a_Graph))
+	, CacheCapacity(FMath::Max(a_CacheCapacity, 1))
+{
+	const FRoadGraph& graph = *Graph;
+
+	//A node is on its region's boundary when any edge in or out of it crosses into another region.
+	BoundaryIndices.Init(INDEX_NONE, graph.GetNumNodes());
+	for (int32 edge = 0; edge < graph.GetNumEdges(); edge++)
+	{
+		const int32 source = graph.EdgeSources[edge];
+		const int32 target = graph.EdgeTargets[edge];
+		if (graph.NodeRegions[source] == graph.NodeRegions[target])
+			continue;
+
+		if (BoundaryIndices[source] == INDEX_NONE)
+			BoundaryIndices[source] = BoundaryNodes.Add(source);
+		if (BoundaryIndices[target] == INDEX_NONE)
+			BoundaryIndices[target] = BoundaryNodes.Add(target);
+	}
+
+	RegionBoundaryStarts.Init(0, graph.NumRegions + 1);
+	for (const int32 node : BoundaryNodes)
+		RegionBoundaryStarts[graph.NodeRegions[node] + 1]++;
+	for (int32 region = 0; region < graph.NumRegions; region++)
+		RegionBoundaryStarts[region + 1] += RegionBoundaryStarts[region];
+
+	RegionBoundary.SetNumUninitialized(BoundaryNodes.Num());
+	TArray<int32> nextBoundary(RegionBoundaryStarts.GetData(), graph.NumRegions);
+	for (int32 index = 0; index < BoundaryNodes.Num(); index++)
+		RegionBoundary[nextBoundary[graph.NodeRegions[BoundaryNodes[index]]]++] = index;
+
+	//Each boundary node's shortcuts only need a search of its own region, so they are found in parallel.
+	TArray<TArray<FBoundaryEdge>> nodeEdges;
+	TArray<TArray<int32>> nodePaths;
+	nodeEdges.SetNum(BoundaryNodes.Num());
+	nodePaths.SetNum(BoundaryNodes.Num());
+	ParallelFor(BoundaryNodes.Num(), [&](int32 a_Index)
+	{
+		const int32 node = BoundaryNodes[a_Index];
+		const int32 region = graph.NodeRegions[node];
+		TArray<FBoundaryEdge>& edges = nodeEdges[a_Index];
+		TArray<int32>& paths = nodePaths[a_Index];
+
+		FRegionSearch search;
+		SearchRegion(node, false, search);
+		TArray<int32> path;
+		for (const int32 other : GetRegionBoundary(region))
+		{
+			const float* distance = search.Distances.Find(BoundaryNodes[other]);
+			if (other == a_Index || distance == nullptr)
+				continue;
+
+			path.Reset();
+			TracePath(search, BoundaryNodes[other], false, path);
+			edges.Add({ a_Index, other, *distance, paths.Num(), path.Num() });
+			paths.Append(path);
+		}
+
+		for (int32 edge = graph.EdgeStarts[node]; edge < graph.EdgeStarts[node + 1]; edge++)
+		{
+			const int32 target = graph.EdgeTargets[edge];
+			if (graph.NodeRegions[target] == region)
+				continue;
+
+			edges.Add({ a_Index, BoundaryIndices[target], graph.EdgeCosts[edge], paths.Num(), 1 });
+			paths.Add(edge);
+		}
+	});
+
+	BoundaryEdgeStarts.SetNumUninitialized(BoundaryNodes.Num() + 1);
+	for (int32 index = 0; index < BoundaryNodes.Num(); index++)
+	{
+		BoundaryEdgeStarts[index] = BoundaryEdges.Num();
+		for (FBoundaryEdge& edge : nodeEdges[index])
+		{
+			edge.PathStart += ShortcutEdges.Num();
+			BoundaryEdges.Add(edge);
+		}
+		ShortcutEdges.Append(nodePaths[index]);
+	}
+	BoundaryEdgeStarts[BoundaryNodes.Num()] = BoundaryEdges.Num();
+}
+
+void FRoadRouter::SearchRegion(int32 a_Source, bool a_Reverse, FRegionSearch& o_Search) const
+{
+	const FRoadGraph& graph = *Graph;
+	const int32 region = graph.NodeRegions[a_Source];
+	o_Search.Distances.Reset();
+	o_Search.ParentEdges.Reset();
+	o_Search.Distances.Add(a_Source, 0);
+
+	TArray<FQueueEntry> queue;
+	queue.HeapPush({ 0, a_Source }, FQueueOrder());
+	while (queue.Num() > 0)
+	{
+		FQueueEntry entry;
+		queue.HeapPop(entry, FQueueOrder(), EAllowShrinking::No);
+		if (entry.Priority > o_Search.Distances.FindChecked(entry.Node))
+			continue;
+
+		const int32 begin = a_Reverse ? graph.ReverseEdgeStarts[entry.Node] : graph.EdgeStarts[entry.Node];
+		const int32 end = a_Reverse ? graph.ReverseEdgeStarts[entry.Node + 1] : graph.EdgeStarts[entry.Node + 1];
+		for (int32 i = begin; i < end; i++)
+		{
+			const int32 edge = a_Reverse ? graph.ReverseEdges[i] : i;
+			const int32 next = a_Reverse ? graph.EdgeSources[edge] : graph.EdgeTargets[edge];
+			if (graph.NodeRegions[next] != region)
+				continue;
+
+			const float distance = entry.Priority + graph.EdgeCosts[edge];
+			const float* known = o_Search.Distances.Find(next);
+			if (known != nullptr && *known <= distance)
+				continue;
+
+			o_Search.Distances.Add(next, distance);
+			o_Search.ParentEdges.Add(next, edge);
+			queue.HeapPush({ distance, next }, FQueueOrder());
+		}
+	}
+}
+
+void FRoadRouter::TracePath(const FRegionSearch& a_Search, int32 a_Node, bool a_Reverse, TArray<int32>& o_Edges) const
+{
+	//Reverse search parents already point along the road towards the source.
+	const int32 firstEdge = o_Edges.Num();
+	for (const int32* edge = a_Search.ParentEdges.Find(a_Node); edge != nullptr; edge = a_Search.ParentEdges.Find(a_Node))
+	{
+		o_Edges.Add(*edge);
+		a_Node = a_Reverse ? Graph->EdgeTargets[*edge] : Graph->EdgeSources[*edge];
+	}
+
+	if (!a_Reverse)
+		Algo::Reverse(MakeArrayView(o_Edges.GetData() + firstEdge, o_Edges.Num() - firstEdge));
+}
+
+TSharedPtr<const FRoadRouter::FRegionTrees> FRoadRouter::GetRegionTrees(int32 a_Region) const
+{
+	{
+		FReadScopeLock readLock(CacheLock);
+		if (const TSharedPtr<const FRegionTrees>* cached = Cache.Find(a_Region))
+		{
+			CacheHits++;
+			return *cached;
+		}
+	}
+
+	CacheMisses++;
+	INC_DWORD_STAT(STAT_ManiacCab_RoadRouteCacheMisses);
+	TSharedPtr<const FRegionTrees> trees = BuildRegionTrees(a_Region);
+
+	FWriteScopeLock writeLock(CacheLock);
+	//Another query may have built the same region meanwhile, keep the first so they share it.
+	if (const TSharedPtr<const FRegionTrees>* cached = Cache.Find(a_Region))
+		return *cached;
+
+	if (CacheOrder.Num() >= CacheCapacity)
+	{
+		Cache.Remove(CacheOrder[0]);
+		CacheOrder.RemoveAt(0);
+	}
+	Cache.Add(a_Region, trees);
+	CacheOrder.Add(a_Region);
+	return trees;
+}
+
+TSharedPtr<const FRoadRouter::FRegionTrees> FRoadRouter::BuildRegionTrees(int32 a_Region) const
+{
+	const TArrayView<const int32> sources = GetRegionBoundary(a_Region);
+	const int32 boundaryCount = BoundaryNodes.Num();
+
+	TSharedPtr<FRegionTrees> trees = MakeShared<FRegionTrees>();
+	trees->Distances.Init(MAX_flt, sources.Num() * boundaryCount);
+	trees->ParentEdges.Init(INDEX_NONE, sources.Num() * boundaryCount);
+
+	TArray<FQueueEntry> queue;
+	for (int32 row = 0; row < sources.Num(); row++)
+	{
+		float* distances = trees->Distances.GetData() + row * boundaryCount;
+		int32* parentEdges = trees->ParentEdges.GetData() + row * boundaryCount;
+		distances[sources[row]] = 0;
+
+		queue.Reset();
+		queue.HeapPush({ 0, sources[row] }, FQueueOrder());
+		while (queue.Num() > 0)
+		{
+			FQueueEntry entry;
+			queue.HeapPop(entry, FQueueOrder(), EAllowShrinking::No);
+			if (entry.Priority > distances[entry.Node])
+				continue;
+
+			for (int32 edge = BoundaryEdgeStarts[entry.Node]; edge < BoundaryEdgeStarts[entry.Node + 1]; edge++)
+			{
+				const FBoundaryEdge& boundaryEdge = BoundaryEdges[edge];
+				const float distance = entry.Priority + boundaryEdge.Cost;
+				if (distance >= distances[boundaryEdge.Target])
+					continue;
+
+				distances[boundaryEdge.Target] = distance;
+				parentEdges[boundaryEdge.Target] = edge;
+				queue.HeapPush({ distance, boundaryEdge.Target }, FQueueOrder());
+			}
+		}
+	}
+	return trees;
+}
+
+void FRoadRouter::AppendEdges(TArrayView<const int32> a_Edges, FRoadRoute& o_Route) const
+{
+	for (const int32 edge : a_Edges)
+	{
+		//Consecutive edges share the node between them.
+		const TArrayView<const FVector3f> samples = Graph->GetEdgeSamples(edge);
+		o_Route.Points.Append(samples.GetData() + 1, samples.Num() - 1);
+		o_Route.Edges.Add(edge);
+		o_Route.Length += Graph->EdgeCosts[edge];
+	}
+}
+
+FRoadRoute FRoadRouter::FindRoute(const FVector3f& a_From, const FVector3f& a_To) const
+{
+	return FindRoute(Graph->FindNearestNode(a_From), Graph->FindNearestNode(a_To));
+}
+
+UE::Tasks::TTask<FRoadRoute> FRoadRouter::FindRouteAsync(const FVector3f& a_From, const FVector3f& a_To) const
+{
+	return UE::Tasks::Launch(UE_SOURCE_LOCATION, [router = AsShared(), a_From, a_To]()
+	{
+		return router->FindRoute(a_From, a_To);
+	});
+}
+
+FRoadRoute FRoadRouter::FindRoute(int32 a_FromNode, int32 a_ToNode) const
+{
+	if (a_FromNode == INDEX_NONE || a_ToNode == INDEX_NONE)
+		return FRoadRoute();
+
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_RoadRouteQuery);
+	INC_DWORD_STAT(STAT_ManiacCab_RoadRouteQueries);
+
+	//The best route between two nodes of one region can still leave it, only a full search finds it.
+	const int32 fromRegion = Graph->NodeRegions[a_FromNode];
+	const int32 toRegion = Graph->NodeRegions[a_ToNode];
+	if (fromRegion == toRegion)
+		return FindRouteFlat(a_FromNode, a_ToNode);
+
+	FRegionSearch fromSearch;
+	FRegionSearch toSearch;
+	SearchRegion(a_FromNode, false, fromSearch);
+	SearchRegion(a_ToNode, true, toSearch);
+	const TSharedPtr<const FRegionTrees> trees = GetRegionTrees(fromRegion);
+
+	//Every route leaves the origin region for the first time at one of its boundary nodes and enters the destination
+	//region for the last time at one of its, the cached trees have the best way between every such pair.
+	const TArrayView<const int32> exits = GetRegionBoundary(fromRegion);
+	const TArrayView<const int32> entries = GetRegionBoundary(toRegion);
+	const int32 boundaryCount = BoundaryNodes.Num();
+	float bestDistance = MAX_flt;
+	int32 bestRow = INDEX_NONE;
+	int32 bestEntry = INDEX_NONE;
+	for (int32 row = 0; row < exits.Num(); row++)
+	{
+		const float* toExit = fromSearch.Distances.Find(BoundaryNodes[exits[row]]);
+		if (toExit == nullptr)
+			continue;
+
+		const float* distances = trees->Distances.GetData() + row * boundaryCount;
+		for (const int32 entry : entries)
+		{
+			const float* fromEntry = toSearch.Distances.Find(BoundaryNodes[entry]);
+			if (fromEntry == nullptr || distances[entry] == MAX_flt)
+				continue;
+
+			const float distance = *toExit + distances[entry] + *fromEntry;
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestRow = row;
+				bestEntry = entry;
+			}
+		}
+	}
+
+	if (bestRow == INDEX_NONE)
+		return FRoadRoute();
+
+	TArray<int32> edges;
+	TracePath(fromSearch, BoundaryNodes[exits[bestRow]], false, edges);
+
+	TArray<int32, TInlineAllocator<64>> boundaryPath;
+	const int32* parentEdges = trees->ParentEdges.GetData() + bestRow * boundaryCount;
+	for (int32 node = bestEntry; parentEdges[node] != INDEX_NONE; node = BoundaryEdges[parentEdges[node]].Source)
+		boundaryPath.Add(parentEdges[node]);
+	for (int32 i = boundaryPath.Num() - 1; i >= 0; i--)
+	{
+		const FBoundaryEdge& boundaryEdge = BoundaryEdges[boundaryPath[i]];
+		edges.Append(ShortcutEdges.GetData() + boundaryEdge.PathStart, boundaryEdge.PathCount);
+	}
+
+	TracePath(toSearch, BoundaryNodes[bestEntry], true, edges);
+
+	FRoadRoute route;
+	route.Points.Add(Graph->NodePositions[a_FromNode]);
+	AppendEdges(edges, route);
+	return route;
+}
+
+FRoadRoute FRoadRouter::FindRouteFlat(int32 a_FromNode, int32 a_ToNode) const
+{
+	if (a_FromNode == INDEX_NONE || a_ToNode == INDEX_NONE)
+		return FRoadRoute();
+
+	const FRoadGraph& graph = *Graph;
+	const FVector3f& goal = graph.NodePositions[a_ToNode];
+	TArray<float> distances;
+	TArray<int32> parentEdges;
+	TBitArray<> closed(false, graph.GetNumNodes());
+	distances.Init(MAX_flt, graph.GetNumNodes());
+	parentEdges.Init(INDEX_NONE, graph.GetNumNodes());
+	distances[a_FromNode] = 0;
+
+	//Edge costs are road lengths, never shorter than the straight line, so the distance to the goal is admissible.
+	TArray<FQueueEntry> queue;
+	queue.HeapPush({ FVector3f::Dist(graph.NodePositions[a_FromNode], goal), a_FromNode }, FQueueOrder());
+	while (queue.Num() > 0)
+	{
+		FQueueEntry entry;
+		queue.HeapPop(entry, FQueueOrder(), EAllowShrinking::No);
+		if (entry.Node == a_ToNode)
+			break;
+		if (closed[entry.Node])
+			continue;
+		closed[entry.Node] = true;
+
+		for (int32 edge = graph.EdgeStarts[entry.Node]; edge < graph.EdgeStarts[entry.Node + 1]; edge++)
+		{
+			const int32 next = graph.EdgeTargets[edge];
+			const float distance = distances[entry.Node] + graph.EdgeCosts[edge];
+			if (closed[next] || distance >= distances[next])
+				continue;
+
+			distances[next] = distance;
+			parentEdges[next] = edge;
+			queue.HeapPush({ distance + FVector3f::Dist(graph.NodePositions[next], goal), next }, FQueueOrder());
+		}
+	}
+
+	if (distances[a_ToNode] == MAX_flt)
+		return FRoadRoute();
+
+	TArray<int32> edges;
+	for (int32 node = a_ToNode; parentEdges[node] != INDEX_NONE; node = graph.EdgeSources[parentEdges[node]])
+		edges.Add(parentEdges[node]);
+	Algo::Reverse(edges);
+
+	FRoadRoute route;
+	route.Points.Add(graph.NodePositions[a_FromNode]);
+	AppendEdges(edges, route);
+	return route;
+}
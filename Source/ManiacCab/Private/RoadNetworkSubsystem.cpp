@@ -0,0 +1,158 @@
+#include "RoadNetworkSubsystem.h"
+
+#include "ManiacCab.h"
+#include "EngineUtils.h"
+#include "Components/SplineComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+const FName URoadNetworkSubsystem::RoadTag(TEXT("Road"));
+const FName URoadNetworkSubsystem::OneWayTag(TEXT("OneWay"));
+
+namespace
+{
+	//Name of the modular road mesh, placed copies of it are roads whether or not their actor is tagged.
+	const FName RoadMeshName(TEXT("Road"));
+}
+
+void URoadNetworkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	StartBuild();
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &URoadNetworkSubsystem::OnLevelsChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &URoadNetworkSubsystem::OnLevelsChanged);
+}
+
+void URoadNetworkSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	//The build does not reference the subsystem, it finishes on its own and its router is dropped.
+	PendingBuild = {};
+	Router.Reset();
+	Super::Deinitialize();
+}
+
+void URoadNetworkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (PendingBuild.IsValid())
+	{
+		if (!PendingBuild.IsCompleted())
+			return;
+		//Routes already handed out keep the old router alive until they are done.
+		Router = PendingBuild.GetResult();
+		PendingBuild = {};
+	}
+	if (NetworkDirty)
+		StartBuild();
+}
+
+TStatId URoadNetworkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoadNetworkSubsystem, STATGROUP_Tickables);
+}
+
+bool URoadNetworkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoadNetworkSubsystem::OnLevelsChanged(ULevel* a_Level, UWorld* a_World)
+{
+	//Levels stream in several per frame, they are built once on the next tick.
+	if (a_World == GetWorld())
+		NetworkDirty = true;
+}
+
+void URoadNetworkSubsystem::StartBuild()
+{
+	NetworkDirty = false;
+	const double startTime = FPlatformTime::Seconds();
+
+	FRoadGraphBuilder builder;
+	for (TActorIterator<AActor> it(GetWorld()); it; ++it)
+		AddActorRoads(*it, builder);
+
+	if (builder.GetNumRoads() == 0)
+	{
+		Router.Reset();
+		return;
+	}
+
+	const double gatherMs = (FPlatformTime::Seconds() - startTime) * 1000.0;
+	PendingBuild = UE::Tasks::Launch(UE_SOURCE_LOCATION, [builder = MoveTemp(builder), gatherMs]()
+	{
+		const double buildStartTime = FPlatformTime::Seconds();
+		const TSharedRef<const FRoadGraph> graph = MakeShared<const FRoadGraph>(builder.Build());
+		const TSharedRef<const FRoadRouter> router = MakeShared<FRoadRouter>(graph);
+		UE_LOG(LogManiacCab, Log, TEXT("Road network built in %.1f ms on a worker after %.1f ms gathering: %d roads, %d nodes, %d edges, %d regions, %d boundary nodes"),
+			(FPlatformTime::Seconds() - buildStartTime) * 1000.0, gatherMs, builder.GetNumRoads(), graph->GetNumNodes(), graph->GetNumEdges(),
+			graph->GetNumRegions(), router->GetNumBoundaryNodes());
+		return TSharedPtr<const FRoadRouter>(router);
+	});
+}
+
+void URoadNetworkSubsystem::AddActorRoads(const AActor* a_Actor, FRoadGraphBuilder& a_Builder)
+{
+	const bool taggedRoad = a_Actor->ActorHasTag(RoadTag);
+	const bool oneWay = a_Actor->ActorHasTag(OneWayTag);
+
+	TArray<FVector3f> points;
+	if (taggedRoad)
+	{
+		TInlineComponentArray<USplineComponent*> splines(a_Actor);
+		for (const USplineComponent* spline : splines)
+		{
+			//Sampled finer than the graph resamples it, so curves keep their length.
+			const float length = spline->GetSplineLength();
+			const int32 segments = FMath::Max(FMath::CeilToInt32(length / (FRoadGraphBuilder::SampleSpacing * 0.5f)), 1);
+			points.Reset();
+			for (int32 i = 0; i <= segments; i++)
+				points.Add(FVector3f(spline->GetLocationAtDistanceAlongSpline(length * i / segments, ESplineCoordinateSpace::World)));
+			a_Builder.AddRoad(points, oneWay);
+		}
+		if (splines.Num() > 0)
+			return;
+	}
+
+	TInlineComponentArray<UStaticMeshComponent*> meshes(a_Actor);
+	for (const UStaticMeshComponent* mesh : meshes)
+	{
+		const UStaticMesh* staticMesh = mesh->GetStaticMesh();
+		if (staticMesh == nullptr || (!taggedRoad && staticMesh->GetFName() != RoadMeshName))
+			continue;
+
+		//Along the middle of the top of the mesh, in the direction of its longer side.
+		const FBox bounds = staticMesh->GetBoundingBox();
+		const FVector extent = bounds.GetExtent();
+		const FVector axis = extent.X >= extent.Y ? FVector(extent.X, 0, 0) : FVector(0, extent.Y, 0);
+		const FVector top(bounds.GetCenter().X, bounds.GetCenter().Y, bounds.Max.Z);
+		const FTransform& transform = mesh->GetComponentTransform();
+		points.Reset();
+		points.Add(FVector3f(transform.TransformPosition(top - axis)));
+		points.Add(FVector3f(transform.TransformPosition(top + axis)));
+		a_Builder.AddRoad(points, oneWay);
+	}
+}
+
+UE::Tasks::TTask<FRoadRoute> URoadNetworkSubsystem::FindRouteAsync(const FVector& a_From, const FVector& a_To) const
+{
+	if (!Router.IsValid())
+		return UE::Tasks::MakeCompletedTask<FRoadRoute>();
+
+	return Router->FindRouteAsync(FVector3f(a_From), FVector3f(a_To));
+}
+
+TArray<FVector> URoadNetworkSubsystem::FindRoutePoints(const FVector& a_From, const FVector& a_To) const
+{
+	TArray<FVector> points;
+	if (!Router.IsValid())
+		return points;
+
+	const FRoadRoute route = Router->FindRoute(FVector3f(a_From), FVector3f(a_To));
+	points.Reserve(route.Points.Num());
+	for (const FVector3f& point : route.Points)
+		points.Add(FVector(point));
+	return points;
+}
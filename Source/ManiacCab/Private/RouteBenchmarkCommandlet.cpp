@@ -0,0 +1,168 @@
+#include "RouteBenchmarkCommandlet.h"
+
+#include "ManiacCab.h"
+#include "RoadGraph.h"
+#include "Algo/Accumulate.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	//Routes the hierarchical search finds may differ from A* by float rounding in the summed costs.
+	constexpr float RouteLengthTolerance = 1.0f;
+
+	double Percentile(TArray<double> a_Values, double a_Percentile)
+	{
+		if (a_Values.Num() == 0)
+			return 0;
+		a_Values.Sort();
+		return a_Values[FMath::Clamp(FMath::CeilToInt(a_Percentile * a_Values.Num()) - 1, 0, a_Values.Num() - 1)];
+	}
+}
+
+URouteBenchmarkCommandlet::URouteBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 URouteBenchmarkCommandlet::Main(const FString& Params)
+{
+	FBenchmarkSettings settings;
+	FParse::Value(*Params, TEXT("Grid="), settings.GridSize);
+	FParse::Value(*Params, TEXT("Spacing="), settings.Spacing);
+	FParse::Value(*Params, TEXT("RegionSize="), settings.RegionSize);
+	FParse::Value(*Params, TEXT("OneWay="), settings.OneWayFraction);
+	FParse::Value(*Params, TEXT("Closed="), settings.ClosedFraction);
+	FParse::Value(*Params, TEXT("Queries="), settings.Queries);
+	FParse::Value(*Params, TEXT("Validate="), settings.ValidatedQueries);
+	FParse::Value(*Params, TEXT("Seed="), settings.Seed);
+	if (!FParse::Value(*Params, TEXT("Output="), settings.OutputPath))
+		settings.OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks/RouteBenchmark.csv");
+	settings.GridSize = FMath::Max(settings.GridSize, 2);
+
+	FBenchmarkResult result;
+	const double buildStart = FPlatformTime::Seconds();
+	const TSharedRef<FRoadRouter> router = BuildGridNetwork(settings);
+	result.BuildMs = (FPlatformTime::Seconds() - buildStart) * 1000.0;
+	result.Nodes = router->GetGraph().GetNumNodes();
+	result.Edges = router->GetGraph().GetNumEdges();
+	result.Regions = router->GetGraph().GetNumRegions();
+	result.BoundaryNodes = router->GetNumBoundaryNodes();
+
+	RunQueries(settings, *router, result);
+	result.Mismatches = ValidateRoutes(settings, *router);
+
+	WriteResult(settings.OutputPath, result);
+	UE_LOG(LogManiacCab, Display, TEXT("%d nodes, %d edges, %d regions, %d boundary nodes, built in %.1f ms"),
+		result.Nodes, result.Edges, result.Regions, result.BoundaryNodes, result.BuildMs);
+	UE_LOG(LogManiacCab, Display, TEXT("%d queries (%d routed): mean %.1f us, p50 %.1f us, p99 %.1f us, %.0f queries/s, %.1f%% cache hits, %d of %d validated routes longer than A*"),
+		result.Queries, result.Routed, result.MeanQueryUs, result.P50QueryUs, result.P99QueryUs, result.QueriesPerSecond,
+		result.CacheHitRate * 100.0, result.Mismatches, FMath::Min(settings.ValidatedQueries, settings.Queries));
+	return result.Mismatches == 0 ? 0 : 1;
+}
+
+TSharedRef<FRoadRouter> URouteBenchmarkCommandlet::BuildGridNetwork(const FBenchmarkSettings& a_Settings)
+{
+	//Blocks of a city: streets between grid neighbours with a bend in the middle, some one way and some closed.
+	FRandomStream random(a_Settings.Seed);
+	FRoadGraphBuilder builder(a_Settings.Spacing * 0.1f, a_Settings.RegionSize);
+	auto addStreet = [&](const FVector3f& a_From, const FVector3f& a_To)
+	{
+		if (random.FRand() < a_Settings.ClosedFraction)
+			return;
+
+		const FVector3f side = FVector3f(-(a_To - a_From).Y, (a_To - a_From).X, 0).GetSafeNormal();
+		const FVector3f middle = (a_From + a_To) * 0.5f + side * random.FRandRange(-0.1f, 0.1f) * a_Settings.Spacing;
+		const bool oneWay = random.FRand() < a_Settings.OneWayFraction;
+		TArray<FVector3f, TInlineAllocator<3>> street = { a_From, middle, a_To };
+		if (oneWay && random.FRand() < 0.5f)
+			Algo::Reverse(street);
+		builder.AddRoad(street, oneWay);
+	};
+
+	for (int32 y = 0; y < a_Settings.GridSize; y++)
+	{
+		for (int32 x = 0; x < a_Settings.GridSize; x++)
+		{
+			const FVector3f corner(x * a_Settings.Spacing, y * a_Settings.Spacing, 0);
+			if (x + 1 < a_Settings.GridSize)
+				addStreet(corner, corner + FVector3f(a_Settings.Spacing, 0, 0));
+			if (y + 1 < a_Settings.GridSize)
+				addStreet(corner, corner + FVector3f(0, a_Settings.Spacing, 0));
+		}
+	}
+
+	return MakeShared<FRoadRouter>(MakeShared<const FRoadGraph>(builder.Build()));
+}
+
+void URouteBenchmarkCommandlet::RunQueries(const FBenchmarkSettings& a_Settings, const FRoadRouter& a_Router, FBenchmarkResult& o_Result)
+{
+	const int32 nodeCount = a_Router.GetGraph().GetNumNodes();
+	FRandomStream random(a_Settings.Seed + 1);
+	TArray<FIntPoint> queries;
+	queries.SetNumUninitialized(a_Settings.Queries);
+	for (FIntPoint& query : queries)
+		query = FIntPoint(random.RandHelper(nodeCount), random.RandHelper(nodeCount));
+
+	//Every query is timed on the worker that answers it, the wall time of the whole batch gives the throughput.
+	TArray<double> latencies;
+	TArray<bool> routed;
+	latencies.SetNumZeroed(queries.Num());
+	routed.SetNumZeroed(queries.Num());
+	const double batchStart = FPlatformTime::Seconds();
+	ParallelFor(queries.Num(), [&](int32 a_Index)
+	{
+		const double queryStart = FPlatformTime::Seconds();
+		routed[a_Index] = a_Router.FindRoute(queries[a_Index].X, queries[a_Index].Y).IsValid();
+		latencies[a_Index] = (FPlatformTime::Seconds() - queryStart) * 1000000.0;
+	});
+	const double batchSeconds = FPlatformTime::Seconds() - batchStart;
+
+	const uint64 cacheQueries = a_Router.GetCacheHits() + a_Router.GetCacheMisses();
+	o_Result.Queries = queries.Num();
+	o_Result.Routed = Algo::Accumulate(routed, 0, [](int32 a_Sum, bool a_Routed) { return a_Sum + (a_Routed ? 1 : 0); });
+	o_Result.MeanQueryUs = latencies.Num() > 0 ? Algo::Accumulate(latencies, 0.0) / latencies.Num() : 0;
+	o_Result.P50QueryUs = Percentile(latencies, 0.5);
+	o_Result.P99QueryUs = Percentile(latencies, 0.99);
+	o_Result.QueriesPerSecond = batchSeconds > 0 ? queries.Num() / batchSeconds : 0;
+	o_Result.CacheHitRate = cacheQueries > 0 ? double(a_Router.GetCacheHits()) / cacheQueries : 0;
+}
+
+int32 URouteBenchmarkCommandlet::ValidateRoutes(const FBenchmarkSettings& a_Settings, const FRoadRouter& a_Router)
+{
+	const int32 nodeCount = a_Router.GetGraph().GetNumNodes();
+	FRandomStream random(a_Settings.Seed + 1);
+	int32 mismatches = 0;
+	for (int32 i = 0; i < FMath::Min(a_Settings.ValidatedQueries, a_Settings.Queries); i++)
+	{
+		const int32 from = random.RandHelper(nodeCount);
+		const int32 to = random.RandHelper(nodeCount);
+		const FRoadRoute route = a_Router.FindRoute(from, to);
+		const FRoadRoute reference = a_Router.FindRouteFlat(from, to);
+		if (route.IsValid() != reference.IsValid() || route.Length > reference.Length + RouteLengthTolerance)
+		{
+			mismatches++;
+			UE_LOG(LogManiacCab, Warning, TEXT("Route %d to %d is %.1f long, A* found %.1f"), from, to, route.Length, reference.Length);
+		}
+	}
+	return mismatches;
+}
+
+void URouteBenchmarkCommandlet::WriteResult(const FString& a_Path, const FBenchmarkResult& a_Result)
+{
+	FString line;
+	if (!FPaths::FileExists(a_Path))
+		line = TEXT("Timestamp,Nodes,Edges,Regions,BoundaryNodes,BuildMs,Queries,Routed,MeanQueryUs,P50QueryUs,P99QueryUs,QueriesPerSecond,CacheHitRate,Mismatches\n");
+
+	line += FString::Printf(TEXT("%s,%d,%d,%d,%d,%.2f,%d,%d,%.2f,%.2f,%.2f,%.0f,%.4f,%d\n"),
+		*FDateTime::UtcNow().ToIso8601(), a_Result.Nodes, a_Result.Edges, a_Result.Regions, a_Result.BoundaryNodes, a_Result.BuildMs,
+		a_Result.Queries, a_Result.Routed, a_Result.MeanQueryUs, a_Result.P50QueryUs, a_Result.P99QueryUs, a_Result.QueriesPerSecond,
+		a_Result.CacheHitRate, a_Result.Mismatches);
+
+	FFileHelper::SaveStringToFile(line, *a_Path, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
@@ -0,0 +1,69 @@
+#include "BakedCurve.h"
+
+#include "Curves/RichCurve.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	//Within the default ManiacCab.CurveBakeTolerance.
+	constexpr float BakeTolerance = 0.01f;
+	constexpr int32 CheckedPoints = 1000;
+
+	//Shaped like the car's curves: friction falling off with slip, torque falling off towards top speed.
+	void MakeTestCurves(TArray<FRichCurve>& o_Curves)
+	{
+		FRichCurve& friction = o_Curves.AddDefaulted_GetRef();
+		friction.SetKeyInterpMode(friction.AddKey(0.0f, 1.0f), RCIM_Cubic);
+		friction.SetKeyInterpMode(friction.AddKey(0.3f, 0.85f), RCIM_Cubic);
+		friction.SetKeyInterpMode(friction.AddKey(0.6f, 0.4f), RCIM_Cubic);
+		friction.SetKeyInterpMode(friction.AddKey(1.0f, 0.3f), RCIM_Cubic);
+		friction.AutoSetTangents();
+
+		FRichCurve& torque = o_Curves.AddDefaulted_GetRef();
+		torque.SetKeyInterpMode(torque.AddKey(0.0f, 1.0f), RCIM_Linear);
+		torque.SetKeyInterpMode(torque.AddKey(0.8f, 0.9f), RCIM_Linear);
+		torque.SetKeyInterpMode(torque.AddKey(1.0f, 0.5f), RCIM_Linear);
+
+		//Keys inside the range only, the ends hold the nearest key's value.
+		FRichCurve& inner = o_Curves.AddDefaulted_GetRef();
+		inner.SetKeyInterpMode(inner.AddKey(0.2f, 0.5f), RCIM_Cubic);
+		inner.SetKeyInterpMode(inner.AddKey(0.7f, 1.5f), RCIM_Cubic);
+		inner.AutoSetTangents();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBakedCurveMatchesSourceTest, "ManiacCab.BakedCurve.MatchesSource",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBakedCurveMatchesSourceTest::RunTest(const FString& Parameters)
+{
+	TArray<FRichCurve> curves;
+	MakeTestCurves(curves);
+
+	for (int32 curveIndex = 0; curveIndex < curves.Num(); curveIndex++)
+	{
+		const FRichCurve& sourceCurve = curves[curveIndex];
+		auto evaluate = [&sourceCurve](float a_Time) { return sourceCurve.Eval(a_Time); };
+		//Baked over [0, 1] like UCurveBakingSubsystem does.
+		FBakedCurve bakedCurve;
+		bakedCurve.Bake(0.0f, 1.0f, evaluate);
+
+		float maxError = 0;
+		for (int32 i = 0; i <= CheckedPoints; i++)
+		{
+			const float time = float(i) / CheckedPoints;
+			maxError = FMath::Max(maxError, FMath::Abs(bakedCurve.Evaluate(time) - sourceCurve.Eval(time)));
+		}
+		TestTrue(FString::Printf(TEXT("Curve %d stays within %f of its source, largest difference %f"), curveIndex, BakeTolerance, maxError),
+			maxError <= BakeTolerance);
+
+		//Inputs outside the baked range clamp to its ends, like the wheel inputs the range was chosen for.
+		TestEqual(TEXT("Below the range"), bakedCurve.Evaluate(-1.0f), sourceCurve.Eval(0.0f), BakeTolerance);
+		TestEqual(TEXT("Above the range"), bakedCurve.Evaluate(2.0f), sourceCurve.Eval(1.0f), BakeTolerance);
+	}
+	return true;
+}
+
+#endif
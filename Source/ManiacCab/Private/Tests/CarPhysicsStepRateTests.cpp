@@ -0,0 +1,61 @@
+#include "CarPhysicsCallback.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr float ChassisMass = 1000.0f;
+	constexpr float LateralSpeed = 500.0f;
+	constexpr float SimulatedTime = 1.0f;
+
+	//A car sliding sideways with its wheels at spring rest, stepped the way FCarPhysicsCallback steps it, with the chassis
+	//integrated like AddForce does over each step. Only friction acts, so this is the lateral speed left after SimulatedTime.
+	float SimulateLateralDecay(float a_StepRate)
+	{
+		FBakedCurve friction;
+		friction.Bake(0.0f, 1.0f, [](float a_Time) { return 0.2f; });
+
+		FVehicleDynamicsBatch batch;
+		batch.SetNumVehicles(1);
+		FVehicleDynamicsParams& params = batch.Params[0];
+		for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			params.FrictionCurves[wheel] = &friction;
+
+		const float stepTime = 1.0f / a_StepRate;
+		float lateralSpeed = LateralSpeed;
+		for (int32 step = 0; step < FMath::RoundToInt32(SimulatedTime * a_StepRate); step++)
+		{
+			params.ChassisVelocity = FVector3f(0, lateralSpeed, 0);
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			{
+				batch.SetWheel(wheel, FVector3f::ZeroVector, FVector3f::ForwardVector, FVector3f::RightVector, params.ChassisVelocity,
+					params.SpringRestDistance, true);
+			}
+			FCarPhysicsCallback::SolveStep(batch);
+
+			float lateralForce = 0;
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+				lateralForce += batch.GetForce(wheel).Y * FCarPhysicsCallback::ForceScale;
+			lateralSpeed += lateralForce / ChassisMass * stepTime;
+		}
+		return lateralSpeed;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCarPhysicsStepRateTest, "ManiacCab.Physics.LateralDecayStepRate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCarPhysicsStepRateTest::RunTest(const FString& Parameters)
+{
+	const float speedAt120 = SimulateLateralDecay(120.0f);
+	const float speedAt240 = SimulateLateralDecay(240.0f);
+	TestTrue(TEXT("Friction slows the slide"), speedAt120 < LateralSpeed * 0.5f && speedAt240 < LateralSpeed * 0.5f);
+	TestTrue(TEXT("The slide does not reverse"), speedAt120 > 0 && speedAt240 > 0);
+	//The discrete steps differ a little from each other, a per step friction would differ by about the square.
+	TestEqual(TEXT("Lateral speed left after a second at 240Hz matches 120Hz"), speedAt240, speedAt120, speedAt120 * 0.05f);
+	return true;
+}
+
+#endif
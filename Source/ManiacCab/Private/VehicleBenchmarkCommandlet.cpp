@@ -0,0 +1,238 @@
+#include "VehicleBenchmarkCommandlet.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "Algo/Accumulate.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PBDRigidsSolver.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include <atomic>
+
+namespace
+{
+	//Adds up the time each solver step spends from its start to the end of the constraint solve. Steps run on the physics
+	//thread under async physics, not between any two tick groups, so the game thread cannot time them.
+	//Registered before any car so the car callbacks count as physics too.
+	class FPhysicsStepTimer : public Chaos::TSimCallbackObject<Chaos::FSimCallbackNoInput, Chaos::FSimCallbackNoOutput,
+		Chaos::ESimCallbackOptions::Presimulate | Chaos::ESimCallbackOptions::PostSolve>
+	{
+	public:
+		std::atomic<uint64> Cycles{0};
+
+	private:
+		virtual void OnPreSimulate_Internal() override
+		{
+			StepStartCycles = FPlatformTime::Cycles64();
+		}
+
+		virtual void OnPostSolve_Internal() override
+		{
+			Cycles += FPlatformTime::Cycles64() - StepStartCycles;
+		}
+
+		//Physics thread only.
+		uint64 StepStartCycles = 0;
+	};
+
+	double Percentile(TArray<double> a_Values, double a_Percentile)
+	{
+		if (a_Values.Num() == 0)
+			return 0;
+		a_Values.Sort();
+		return a_Values[FMath::Clamp(FMath::CeilToInt(a_Percentile * a_Values.Num()) - 1, 0, a_Values.Num() - 1)];
+	}
+}
+
+UVehicleBenchmarkCommandlet::UVehicleBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UVehicleBenchmarkCommandlet::Main(const FString& Params)
+{
+	FBenchmarkSettings settings;
+	FString terrain = TEXT("All");
+	FParse::Value(*Params, TEXT("Vehicles="), settings.Vehicles);
+	FParse::Value(*Params, TEXT("Frames="), settings.Frames);
+	FParse::Value(*Params, TEXT("Warmup="), settings.WarmupFrames);
+	FParse::Value(*Params, TEXT("DeltaTime="), settings.DeltaTime);
+	FParse::Value(*Params, TEXT("VehicleClass="), settings.VehicleClass);
+	FParse::Value(*Params, TEXT("Terrain="), terrain);
+	if (!FParse::Value(*Params, TEXT("Output="), settings.OutputPath))
+		settings.OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks/VehicleBenchmark.csv");
+
+	TArray<FString> terrains;
+	if (terrain == TEXT("All"))
+		terrains = { TEXT("Flat"), TEXT("Bumpy"), TEXT("Ramp") };
+	else
+		terrains.Add(terrain);
+
+	for (const FString& terrainName : terrains)
+	{
+		FBenchmarkResult result;
+		if (!RunBenchmark(settings, terrainName, result))
+			return 1;
+
+		WriteResult(settings.OutputPath, result);
+		UE_LOG(LogManiacCab, Display, TEXT("%s: %d vehicles, frame %.3f ms (p99 %.3f ms), cars %.3f ms (p99 %.3f ms), %.4f ms per vehicle, physics %.3f ms, %.1f scene queries per frame, %.1f KB per vehicle"),
+			*result.Terrain, result.Vehicles, result.MeanFrameMs, result.P99FrameMs, result.MeanVehicleMs, result.P99VehicleMs, result.MeanVehicleMs / result.Vehicles,
+			result.MeanPhysicsMs, result.SceneQueriesPerFrame, result.MemoryKBPerVehicle);
+	}
+	return 0;
+}
+
+bool UVehicleBenchmarkCommandlet::RunBenchmark(const FBenchmarkSettings& a_Settings, const FString& a_Terrain, FBenchmarkResult& o_Result) const
+{
+	UClass* vehicleClass = LoadClass<ACarController>(nullptr, *a_Settings.VehicleClass);
+	if (vehicleClass == nullptr)
+	{
+		UE_LOG(LogManiacCab, Error, TEXT("Could not load vehicle class %s"), *a_Settings.VehicleClass);
+		return false;
+	}
+
+	UWorld* world = UWorld::CreateWorld(EWorldType::Game, false, TEXT("VehicleBenchmark"));
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+	world->InitializeActorsForPlay(FURL());
+	world->GetWorldSettings()->NotifyBeginPlay();
+
+	SpawnTerrain(world, a_Terrain);
+
+	Chaos::FPhysicsSolver* solver = world->GetPhysicsScene()->GetSolver();
+	FPhysicsStepTimer* physicsTimer = solver->CreateAndRegisterSimCallbackObject_External<FPhysicsStepTimer>();
+
+	const uint64 memoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+	TArray<ACarController*> vehicles;
+	const int32 gridSize = FMath::CeilToInt(FMath::Sqrt(float(a_Settings.Vehicles)));
+	for (int32 i = 0; i < a_Settings.Vehicles; i++)
+	{
+		const FVector location((i / gridSize) * 1000.0f, (i % gridSize) * 600.0f - gridSize * 300.0f, 300.0f);
+		if (ACarController* vehicle = world->SpawnActor<ACarController>(vehicleClass, location, FRotator::ZeroRotator))
+			vehicles.Add(vehicle);
+	}
+	//Curves and effects load asynchronously, the measured frames should not include it.
+	FlushAsyncLoading();
+	const uint64 memoryAfter = FPlatformMemory::GetStats().UsedPhysical;
+
+	TArray<double> frameTimes;
+	TArray<double> vehicleTimes;
+	frameTimes.Reserve(a_Settings.Frames);
+	vehicleTimes.Reserve(a_Settings.Frames);
+	uint64 sceneQueries = 0;
+	uint64 physicsCyclesBefore = 0;
+
+	for (int32 frame = 0; frame < a_Settings.WarmupFrames + a_Settings.Frames; frame++)
+	{
+		DriveVehicles(vehicles, frame * a_Settings.DeltaTime);
+		FApp::SetDeltaTime(a_Settings.DeltaTime);
+		FApp::SetCurrentTime(FApp::GetCurrentTime() + a_Settings.DeltaTime);
+
+		const uint64 queriesBefore = ManiacCab::SceneQueryCount;
+		const uint64 vehicleCyclesBefore = ManiacCab::VehicleUpdateCycles;
+		const double frameStart = FPlatformTime::Seconds();
+		world->Tick(LEVELTICK_All, a_Settings.DeltaTime);
+		const double frameEnd = FPlatformTime::Seconds();
+		GFrameCounter++;
+
+		if (frame < a_Settings.WarmupFrames)
+		{
+			physicsCyclesBefore = physicsTimer->Cycles;
+			continue;
+		}
+
+		frameTimes.Add((frameEnd - frameStart) * 1000.0);
+		vehicleTimes.Add(FPlatformTime::ToMilliseconds64(ManiacCab::VehicleUpdateCycles - vehicleCyclesBefore));
+		sceneQueries += ManiacCab::SceneQueryCount - queriesBefore;
+	}
+
+	//Async steps lag the frames they belong to, over the whole run the total still splits evenly across the frames.
+	const uint64 physicsCycles = physicsTimer->Cycles - physicsCyclesBefore;
+	solver->UnregisterAndFreeSimCallbackObject_External(physicsTimer);
+
+	o_Result.Terrain = a_Terrain;
+	o_Result.Vehicles = vehicles.Num();
+	o_Result.Frames = frameTimes.Num();
+	o_Result.MeanFrameMs = frameTimes.Num() > 0 ? Algo::Accumulate(frameTimes, 0.0) / frameTimes.Num() : 0;
+	o_Result.P99FrameMs = Percentile(frameTimes, 0.99);
+	o_Result.MeanVehicleMs = vehicleTimes.Num() > 0 ? Algo::Accumulate(vehicleTimes, 0.0) / vehicleTimes.Num() : 0;
+	o_Result.P99VehicleMs = Percentile(vehicleTimes, 0.99);
+	o_Result.MeanPhysicsMs = frameTimes.Num() > 0 ? FPlatformTime::ToMilliseconds64(physicsCycles) / frameTimes.Num() : 0;
+	o_Result.SceneQueriesPerFrame = frameTimes.Num() > 0 ? double(sceneQueries) / frameTimes.Num() : 0;
+	o_Result.MemoryKBPerVehicle = vehicles.Num() > 0 ? double(memoryAfter > memoryBefore ? memoryAfter - memoryBefore : 0) / 1024.0 / vehicles.Num() : 0;
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+	return o_Result.Vehicles > 0;
+}
+
+void UVehicleBenchmarkCommandlet::SpawnTerrain(UWorld* a_World, const FString& a_Terrain)
+{
+	UStaticMesh* cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+
+	//The basic cube is 100 units wide, centred on its origin.
+	//Blocks are static like level geometry, so cars using the ground heightfield can bake it. A static component cannot be
+	//moved or given a mesh once registered, so everything is set before the spawn finishes.
+	auto spawnBlock = [a_World, cube](const FVector& a_Location, const FRotator& a_Rotation, const FVector& a_Scale)
+	{
+		const FTransform transform(a_Rotation, a_Location, a_Scale);
+		AStaticMeshActor* block = a_World->SpawnActorDeferred<AStaticMeshActor>(AStaticMeshActor::StaticClass(), transform);
+		block->GetStaticMeshComponent()->SetMobility(EComponentMobility::Static);
+		block->GetStaticMeshComponent()->SetStaticMesh(cube);
+		block->FinishSpawning(transform);
+	};
+
+	spawnBlock(FVector(0, 0, -50), FRotator::ZeroRotator, FVector(1000, 1000, 1));
+
+	if (a_Terrain == TEXT("Bumpy"))
+	{
+		FRandomStream random(1234);
+		for (int32 i = 0; i < 400; i++)
+		{
+			const FVector location(random.FRandRange(-20000, 40000), random.FRandRange(-20000, 20000), 0);
+			spawnBlock(location, FRotator(0, random.FRandRange(0, 180), 0), FVector(random.FRandRange(1, 4), random.FRandRange(1, 4), random.FRandRange(0.05f, 0.2f)));
+		}
+	}
+	else if (a_Terrain == TEXT("Ramp"))
+	{
+		for (int32 i = 0; i < 10; i++)
+			spawnBlock(FVector(3000 + i * 5000, 0, 0), FRotator(15, 0, 0), FVector(20, 200, 1));
+	}
+}
+
+void UVehicleBenchmarkCommandlet::DriveVehicles(const TArray<ACarController*>& a_Vehicles, float a_Time)
+{
+	for (int32 i = 0; i < a_Vehicles.Num(); i++)
+	{
+		//Full throttle with a slow weave, every car out of phase, and a one second handbrake every six seconds.
+		const float phase = i * 0.7f;
+		const float steering = FMath::Sin(a_Time * 0.8f + phase) * 0.6f;
+		const bool handBrake = FMath::Fmod(a_Time + phase, 6.0f) > 5.0f;
+		a_Vehicles[i]->SetScriptedInput(steering, 1.0f, handBrake);
+	}
+}
+
+void UVehicleBenchmarkCommandlet::WriteResult(const FString& a_Path, const FBenchmarkResult& a_Result)
+{
+	FString line;
+	if (!FPaths::FileExists(a_Path))
+		line = TEXT("Timestamp,Terrain,Vehicles,Frames,MeanTotalFrameMs,P99TotalFrameMs,MeanVehicleMs,P99VehicleMs,MeanVehicleMsPerVehicle,P99VehicleMsPerVehicle,MeanPhysicsMs,SceneQueriesPerFrame,MemoryKBPerVehicle\n");
+
+	line += FString::Printf(TEXT("%s,%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%.5f,%.5f,%.4f,%.2f,%.2f\n"),
+		*FDateTime::UtcNow().ToIso8601(), *a_Result.Terrain, a_Result.Vehicles, a_Result.Frames, a_Result.MeanFrameMs, a_Result.P99FrameMs,
+		a_Result.MeanVehicleMs, a_Result.P99VehicleMs, a_Result.MeanVehicleMs / a_Result.Vehicles, a_Result.P99VehicleMs / a_Result.Vehicles,
+		a_Result.MeanPhysicsMs, a_Result.SceneQueriesPerFrame, a_Result.MemoryKBPerVehicle);
+
+	FFileHelper::SaveStringToFile(line, *a_Path, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
@@ -0,0 +1,113 @@
+#include "VehicleBudgetSubsystem.h"
+
+#include "ManiacCab.h"
+#include "RenderCore.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Vehicle Budget Level"), STAT_ManiacCab_VehicleBudgetLevel, STATGROUP_ManiacCab);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Vehicle Budget Level Changes"), STAT_ManiacCab_VehicleBudgetChanges, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Average Game Thread ms"), STAT_ManiacCab_AverageGameThreadMs, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Budget Tier Distance Scale"), STAT_ManiacCab_BudgetTierDistanceScale, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Budget Air Probe Scale"), STAT_ManiacCab_BudgetAirProbeScale, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Budget Drift Effects Density"), STAT_ManiacCab_BudgetDriftEffectsDensity, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<bool> CVarVehicleBudget(
+	TEXT("ManiacCab.VehicleBudget"),
+	true,
+	TEXT("Reduce the fidelity of cars other than the player's while the game thread is over ManiacCab.VehicleBudgetTargetMs."));
+
+static TAutoConsoleVariable<float> CVarVehicleBudgetTargetMs(
+	TEXT("ManiacCab.VehicleBudgetTargetMs"),
+	16.6f,
+	TEXT("Game thread frame time the vehicle budget aims for, in milliseconds."));
+
+static TAutoConsoleVariable<int32> CVarVehicleBudgetForceLevel(
+	TEXT("ManiacCab.VehicleBudgetForceLevel"),
+	-1,
+	TEXT("Holds the vehicle budget at this level, 0 being full fidelity. -1 follows the frame time."));
+
+namespace
+{
+	//Level 0 is full fidelity, each level after gives up more.
+	const FVehicleBudget BudgetLevels[] = {
+		{ 1.0f, 1.0f, 1.0f, true },
+		{ 0.8f, 1.0f, 0.75f, false },
+		{ 0.6f, 0.5f, 0.5f, false },
+		{ 0.45f, 0.5f, 0.25f, false },
+		{ 0.3f, 0.25f, 0.0f, false },
+	};
+	constexpr int32 MaxBudgetLevel = UE_ARRAY_COUNT(BudgetLevels) - 1;
+
+	//Seconds for a frame time change to mostly show in the average, so one hitch does not move the level.
+	constexpr float AverageTime = 0.5f;
+	//How long the average has to stay over the target before a level is given up, and under RecoverFraction of it before one
+	//is taken back. Recovering is slower, stepping back up too eagerly would put the frame time straight back over.
+	constexpr float StepUpDelay = 0.5f;
+	constexpr float StepDownDelay = 3.0f;
+	constexpr float RecoverFraction = 0.8f;
+}
+
+void UVehicleBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	//GGameThreadTime is the game thread's work last frame, without the time spent waiting on the render thread.
+	const float gameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	AverageGameThreadMs = FMath::Lerp(AverageGameThreadMs, gameThreadMs, 1.0f - FMath::Exp(-DeltaTime / AverageTime));
+
+	const int32 forcedLevel = CVarVehicleBudgetForceLevel.GetValueOnGameThread();
+	if (!CVarVehicleBudget.GetValueOnGameThread())
+	{
+		SetBudgetLevel(0);
+	}
+	else if (forcedLevel >= 0)
+	{
+		SetBudgetLevel(FMath::Min(forcedLevel, MaxBudgetLevel));
+	}
+	else
+	{
+		const float targetMs = CVarVehicleBudgetTargetMs.GetValueOnGameThread();
+		OverBudgetTime = AverageGameThreadMs > targetMs ? OverBudgetTime + DeltaTime : 0;
+		UnderBudgetTime = AverageGameThreadMs < targetMs * RecoverFraction ? UnderBudgetTime + DeltaTime : 0;
+		if (OverBudgetTime >= StepUpDelay && BudgetLevel < MaxBudgetLevel)
+		{
+			SetBudgetLevel(BudgetLevel + 1);
+			OverBudgetTime = 0;
+		}
+		else if (UnderBudgetTime >= StepDownDelay && BudgetLevel > 0)
+		{
+			SetBudgetLevel(BudgetLevel - 1);
+			UnderBudgetTime = 0;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ManiacCab_VehicleBudgetLevel, BudgetLevel);
+	SET_FLOAT_STAT(STAT_ManiacCab_AverageGameThreadMs, AverageGameThreadMs);
+	SET_FLOAT_STAT(STAT_ManiacCab_BudgetTierDistanceScale, Budget.TierDistanceScale);
+	SET_FLOAT_STAT(STAT_ManiacCab_BudgetAirProbeScale, Budget.AirProbeScale);
+	SET_FLOAT_STAT(STAT_ManiacCab_BudgetDriftEffectsDensity, Budget.DriftEffectsDensity);
+	CSV_CUSTOM_STAT(ManiacCab, VehicleBudgetLevel, BudgetLevel, ECsvCustomStatOp::Set);
+}
+
+void UVehicleBudgetSubsystem::SetBudgetLevel(int32 a_Level)
+{
+	if (a_Level == BudgetLevel)
+		return;
+
+	const FVehicleBudget& budget = BudgetLevels[a_Level];
+	UE_LOG(LogManiacCab, Log, TEXT("Vehicle budget level %d -> %d, game thread %.2f ms against %.2f ms. Tier distances x%.2f, air probes x%.2f, drift effects x%.2f, debug draws %s."),
+		BudgetLevel, a_Level, AverageGameThreadMs, CVarVehicleBudgetTargetMs.GetValueOnGameThread(),
+		budget.TierDistanceScale, budget.AirProbeScale, budget.DriftEffectsDensity, budget.DebugDraws ? TEXT("on") : TEXT("off"));
+	INC_DWORD_STAT(STAT_ManiacCab_VehicleBudgetChanges);
+	BudgetLevel = a_Level;
+	Budget = budget;
+}
+
+TStatId UVehicleBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool UVehicleBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
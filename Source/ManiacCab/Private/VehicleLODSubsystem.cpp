@@ -0,0 +1,235 @@
+#include "VehicleLODSubsystem.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "VehicleManagerSubsystem.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Vehicle LOD Tick"), STAT_ManiacCab_VehicleLODTick, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxied Vehicles"), STAT_ManiacCab_ProxiedVehicles, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxy Instance Components"), STAT_ManiacCab_ProxyComponents, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<bool> CVarProxyLOD(
+	TEXT("ManiacCab.ProxyLOD"),
+	true,
+	TEXT("Swap cars far from the camera to shared instanced render proxies."));
+
+static TAutoConsoleVariable<float> CVarProxyLODDistance(
+	TEXT("ManiacCab.ProxyLODDistance"),
+	10000.0f,
+	TEXT("Distance from the camera beyond which cars become render proxies. They come back at 85% of it."));
+
+static TAutoConsoleVariable<float> CVarProxyCoastTime(
+	TEXT("ManiacCab.ProxyCoastTime"),
+	3.0f,
+	TEXT("Seconds for a proxied car's dead reckoned speed to fall to about a third, standing in for the rolling resistance it no longer simulates."));
+
+namespace
+{
+	const FTransform HiddenTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	constexpr float PromoteDistanceFraction = 0.85f;
+}
+
+void UVehicleLODSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FActorSpawnParameters spawnParameters;
+	spawnParameters.Name = TEXT("VehicleProxies");
+	spawnParameters.ObjectFlags = RF_Transient;
+	ProxyOwner = InWorld.SpawnActor<AActor>(spawnParameters);
+	USceneComponent* root = NewObject<USceneComponent>(ProxyOwner, TEXT("Root"));
+	ProxyOwner->SetRootComponent(root);
+	root->RegisterComponent();
+}
+
+void UVehicleLODSubsystem::Deinitialize()
+{
+	Proxies.Reset();
+	Pools.Reset();
+	PoolsByMesh.Reset();
+	PoolComponents.Reset();
+	ProxyOwner = nullptr;
+	Super::Deinitialize();
+}
+
+void UVehicleLODSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_VehicleLODTick);
+
+	UWorld* world = GetWorld();
+	const APlayerController* playerController = world->GetFirstPlayerController();
+	//Proxied cars stop sending snapshots, so this is single player only.
+	const bool proxiesAllowed = CVarProxyLOD.GetValueOnGameThread() && world->GetNetMode() == NM_Standalone && ProxyOwner != nullptr;
+	if (!proxiesAllowed || playerController == nullptr || playerController->PlayerCameraManager == nullptr)
+	{
+		for (int32 i = Proxies.Num() - 1; i >= 0; i--)
+			PromoteVehicle(i);
+		return;
+	}
+
+	const FVector cameraLocation = playerController->PlayerCameraManager->GetCameraLocation();
+	const float demoteDistanceSquared = FMath::Square(CVarProxyLODDistance.GetValueOnGameThread());
+	const float promoteDistanceSquared = demoteDistanceSquared * FMath::Square(PromoteDistanceFraction);
+	const float velocityDecay = FMath::Exp(-DeltaTime / FMath::Max(CVarProxyCoastTime.GetValueOnGameThread(), 0.01f));
+
+	for (int32 i = Proxies.Num() - 1; i >= 0; i--)
+	{
+		FVehicleProxy& proxy = Proxies[i];
+		if (!proxy.Vehicle.IsValid())
+		{
+			ReleaseInstances(proxy);
+			Proxies.RemoveAtSwap(i);
+			continue;
+		}
+
+		//Flat dead reckoning: there are no ground probes out here, so height and anything but yaw are held until promotion.
+		proxy.LinearVelocity.Z = 0;
+		proxy.LinearVelocity *= velocityDecay;
+		proxy.AngularVelocity = FVector(0, 0, proxy.AngularVelocity.Z * velocityDecay);
+		proxy.ChassisTransform.AddToTranslation(proxy.LinearVelocity * DeltaTime);
+		proxy.ChassisTransform.SetRotation(FQuat(FVector::UpVector, FMath::DegreesToRadians(proxy.AngularVelocity.Z * DeltaTime)) * proxy.ChassisTransform.GetRotation());
+
+		if (FVector::DistSquared(proxy.ChassisTransform.GetLocation(), cameraLocation) < promoteDistanceSquared)
+		{
+			PromoteVehicle(i);
+			continue;
+		}
+
+		for (int32 part = 0; part < PartCount; part++)
+			Pools[proxy.Pools[part]].Transforms[proxy.Instances[part]] = proxy.PartOffsets[part] * proxy.ChassisTransform;
+	}
+
+	if (UVehicleManagerSubsystem* vehicleManager = world->GetSubsystem<UVehicleManagerSubsystem>())
+	{
+		//Copied, demoting unregisters the car from the manager.
+		const TArray<TObjectPtr<ACarController>> vehicles = vehicleManager->GetVehicles();
+		for (ACarController* vehicle : vehicles)
+		{
+			if (vehicle == nullptr || vehicle->IsPlayerControlled() || vehicle->GetLocalRole() == ROLE_SimulatedProxy)
+				continue;
+			if (FVector::DistSquared(vehicle->CarChassis->GetComponentLocation(), cameraLocation) > demoteDistanceSquared)
+				DemoteVehicle(vehicle);
+		}
+	}
+
+	for (int32 i = 0; i < Pools.Num(); i++)
+	{
+		if (Pools[i].Transforms.Num() > 0)
+			PoolComponents[i]->BatchUpdateInstancesTransforms(0, Pools[i].Transforms, true, true, true);
+	}
+
+	SET_DWORD_STAT(STAT_ManiacCab_ProxiedVehicles, Proxies.Num());
+	SET_DWORD_STAT(STAT_ManiacCab_ProxyComponents, PoolComponents.Num());
+}
+
+void UVehicleLODSubsystem::DemoteVehicle(ACarController* a_Vehicle)
+{
+	const UStaticMeshComponent* parts[PartCount];
+	GetVehicleParts(a_Vehicle, parts);
+
+	FVehicleProxy& proxy = Proxies.AddDefaulted_GetRef();
+	proxy.Vehicle = a_Vehicle;
+	proxy.ChassisTransform = a_Vehicle->CarChassis->GetComponentTransform();
+	proxy.LinearVelocity = a_Vehicle->GetChassisLinearVelocity();
+	proxy.AngularVelocity = a_Vehicle->GetChassisAngularVelocity();
+	proxy.RideHeight = a_Vehicle->GetRideHeight();
+
+	//Drop the chassis scale from the pose so the dead reckoned transform stays rigid, the offsets carry it instead.
+	proxy.ChassisTransform.SetScale3D(FVector::OneVector);
+	for (int32 part = 0; part < PartCount; part++)
+	{
+		proxy.PartOffsets[part] = parts[part]->GetComponentTransform().GetRelativeTransform(proxy.ChassisTransform);
+		proxy.Pools[part] = FindOrAddPool(parts[part]);
+
+		FInstancePool& pool = Pools[proxy.Pools[part]];
+		if (pool.FreeInstances.Num() > 0)
+		{
+			proxy.Instances[part] = pool.FreeInstances.Pop();
+		}
+		else
+		{
+			proxy.Instances[part] = PoolComponents[proxy.Pools[part]]->AddInstance(HiddenTransform, true);
+			pool.Transforms.Add(HiddenTransform);
+		}
+		pool.Transforms[proxy.Instances[part]] = proxy.PartOffsets[part] * proxy.ChassisTransform;
+	}
+
+	a_Vehicle->EnterProxyLOD();
+}
+
+void UVehicleLODSubsystem::PromoteVehicle(int32 a_ProxyIndex)
+{
+	const FVehicleProxy& proxy = Proxies[a_ProxyIndex];
+	ReleaseInstances(proxy);
+	if (ACarController* vehicle = proxy.Vehicle.Get())
+	{
+		//The offset of the chassis part carries the scale that was taken off the pose.
+		FTransform chassisTransform = proxy.PartOffsets[0] * proxy.ChassisTransform;
+		//The ground under the dead reckoned position can be far above or below the height held since the handoff.
+		FVector location = chassisTransform.GetLocation();
+		float groundHeight;
+		if (vehicle->FindGroundHeight(location, groundHeight))
+		{
+			location.Z = groundHeight + proxy.RideHeight;
+			chassisTransform.SetLocation(location);
+		}
+		vehicle->ExitProxyLOD(chassisTransform, proxy.LinearVelocity, proxy.AngularVelocity);
+	}
+	Proxies.RemoveAtSwap(a_ProxyIndex);
+}
+
+void UVehicleLODSubsystem::ReleaseInstances(const FVehicleProxy& a_Proxy)
+{
+	for (int32 part = 0; part < PartCount; part++)
+	{
+		FInstancePool& pool = Pools[a_Proxy.Pools[part]];
+		pool.Transforms[a_Proxy.Instances[part]] = HiddenTransform;
+		pool.FreeInstances.Add(a_Proxy.Instances[part]);
+	}
+}
+
+int32 UVehicleLODSubsystem::FindOrAddPool(const UStaticMeshComponent* a_Part)
+{
+	UStaticMesh* mesh = a_Part->GetStaticMesh();
+	if (const int32* existing = PoolsByMesh.Find(mesh))
+		return *existing;
+
+	UHierarchicalInstancedStaticMeshComponent* component = NewObject<UHierarchicalInstancedStaticMeshComponent>(ProxyOwner);
+	component->SetStaticMesh(mesh);
+	component->SetMobility(EComponentMobility::Movable);
+	component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	component->SetCanEverAffectNavigation(false);
+	//Materials come from the first car seen with this mesh.
+	for (int32 slot = 0; slot < a_Part->GetNumMaterials(); slot++)
+		component->SetMaterial(slot, a_Part->GetMaterial(slot));
+	component->SetupAttachment(ProxyOwner->GetRootComponent());
+	component->RegisterComponent();
+
+	PoolComponents.Add(component);
+	const int32 poolIndex = Pools.AddDefaulted();
+	PoolsByMesh.Add(mesh, poolIndex);
+	return poolIndex;
+}
+
+void UVehicleLODSubsystem::GetVehicleParts(const ACarController* a_Vehicle, const UStaticMeshComponent* (&o_Parts)[PartCount])
+{
+	o_Parts[0] = a_Vehicle->CarChassis;
+	o_Parts[1] = a_Vehicle->FrontLeftWheel;
+	o_Parts[2] = a_Vehicle->FrontRightWheel;
+	o_Parts[3] = a_Vehicle->BackLeftWheel;
+	o_Parts[4] = a_Vehicle->BackRightWheel;
+}
+
+TStatId UVehicleLODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleLODSubsystem, STATGROUP_Tickables);
+}
+
+bool UVehicleLODSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
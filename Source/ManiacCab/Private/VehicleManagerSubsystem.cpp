@@ -0,0 +1,221 @@
+#include "VehicleManagerSubsystem.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "VehicleBudgetSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Vehicle Manager Tick"), STAT_ManiacCab_VehicleManagerTick, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Managed Vehicles"), STAT_ManiacCab_ManagedVehicles, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Vehicles Per Game Thread ms"), STAT_ManiacCab_VehiclesPerMs, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Full Tier Vehicles"), STAT_ManiacCab_FullTierVehicles, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reduced Tier Vehicles"), STAT_ManiacCab_ReducedTierVehicles, STATGROUP_ManiacCab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Kinematic Tier Vehicles"), STAT_ManiacCab_KinematicTierVehicles, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Full Tier Game Thread ms"), STAT_ManiacCab_FullTierMs, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Reduced Tier Game Thread ms"), STAT_ManiacCab_ReducedTierMs, STATGROUP_ManiacCab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Kinematic Tier Game Thread ms"), STAT_ManiacCab_KinematicTierMs, STATGROUP_ManiacCab);
+
+static TAutoConsoleVariable<bool> CVarBatchVehicles(
+	TEXT("ManiacCab.BatchVehicles"),
+	true,
+	TEXT("Update all cars from the vehicle manager in one parallel pass instead of ticking each car."));
+
+static TAutoConsoleVariable<bool> CVarSimulationTiers(
+	TEXT("ManiacCab.SimulationTiers"),
+	true,
+	TEXT("Run cars away from the camera on the reduced and kinematic car models."));
+
+static TAutoConsoleVariable<float> CVarFullTierDistance(
+	TEXT("ManiacCab.FullTierDistance"),
+	3000.0f,
+	TEXT("Distance from the camera within which cars run the full car model."));
+
+static TAutoConsoleVariable<float> CVarReducedTierDistance(
+	TEXT("ManiacCab.ReducedTierDistance"),
+	6000.0f,
+	TEXT("Distance from the camera within which cars run the reduced car model, kinematic beyond."));
+
+namespace
+{
+	//Cars behind the camera are treated as this much further away.
+	constexpr float OutOfViewDistanceScale = 2.0f;
+	//A car has to get this much past a boundary before it drops a tier, so cars on the boundary do not flip every frame.
+	constexpr float TierHysteresis = 1.1f;
+}
+
+void UVehicleManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	IsBatching = CVarBatchVehicles.GetValueOnGameThread();
+}
+
+void UVehicleManagerSubsystem::RegisterVehicle(ACarController* a_Vehicle)
+{
+	Vehicles.AddUnique(a_Vehicle);
+	if (IsBatching)
+		a_Vehicle->SetActorTickEnabled(false);
+}
+
+void UVehicleManagerSubsystem::UnregisterVehicle(ACarController* a_Vehicle)
+{
+	//Keep the order stable, it decides the order forces are applied in.
+	Vehicles.Remove(a_Vehicle);
+}
+
+bool UVehicleManagerSubsystem::AreVehiclesReady() const
+{
+	for (const ACarController* vehicle : Vehicles)
+	{
+		if (!vehicle->IsVehicleReady())
+			return false;
+	}
+	return true;
+}
+
+void UVehicleManagerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	ManiacCab::FVehicleUpdateScope updateScope;
+
+	const bool shouldBatch = CVarBatchVehicles.GetValueOnGameThread();
+	if (shouldBatch != IsBatching)
+	{
+		IsBatching = shouldBatch;
+		SetVehicleTicksEnabled(!IsBatching);
+	}
+
+	//Self ticking cars read their tier as well, so this runs whether or not the manager batches.
+	UpdateSimulationTiers();
+
+	if (!IsBatching || Vehicles.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_ManiacCab_VehicleManagerTick);
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	uint64 tierCycles[TierCount] = {};
+	int32 tierVehicles[TierCount] = {};
+
+	UpdatedVehicles.Reset();
+	for (ACarController* vehicle : Vehicles)
+	{
+		const int32 tier = int32(vehicle->GetSimulationTier());
+		tierVehicles[tier]++;
+		if (vehicle->GetSimulationTier() != EVehicleSimulationTier::Kinematic && vehicle->IsUpdateDue())
+		{
+			UpdatedVehicles.Add(vehicle);
+			continue;
+		}
+
+		const uint64 vehicleStart = FPlatformTime::Cycles64();
+		if (vehicle->GetSimulationTier() == EVehicleSimulationTier::Kinematic)
+			vehicle->UpdateKinematic(DeltaTime);
+		else
+			vehicle->HoldVehicleUpdate();
+		tierCycles[tier] += FPlatformTime::Cycles64() - vehicleStart;
+	}
+
+	const int32 numVehicles = UpdatedVehicles.Num();
+	Batch.SetNumVehicles(numVehicles);
+
+	for (int32 i = 0; i < numVehicles; i++)
+	{
+		const uint64 vehicleStart = FPlatformTime::Cycles64();
+		UpdatedVehicles[i]->PrepareVehicleUpdate(Batch, i);
+		tierCycles[int32(UpdatedVehicles[i]->GetSimulationTier())] += FPlatformTime::Cycles64() - vehicleStart;
+	}
+
+	//Only the batch and the baked curve tables are touched here.
+	ParallelFor(FMath::DivideAndRoundUp(numVehicles, VehiclesPerTask), [this, numVehicles](int32 a_Task)
+	{
+		const int32 firstVehicle = a_Task * VehiclesPerTask;
+		const int32 taskVehicles = FMath::Min(VehiclesPerTask, numVehicles - firstVehicle);
+
+		VehicleDynamics::Solve(Batch, firstVehicle, taskVehicles);
+	});
+
+	//Scatter in registration order so the result does not depend on how the workers were scheduled.
+	for (int32 i = 0; i < numVehicles; i++)
+	{
+		const uint64 vehicleStart = FPlatformTime::Cycles64();
+		UpdatedVehicles[i]->FinishVehicleUpdate(Batch, i);
+		tierCycles[int32(UpdatedVehicles[i]->GetSimulationTier())] += FPlatformTime::Cycles64() - vehicleStart;
+	}
+
+	const double elapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+	SET_DWORD_STAT(STAT_ManiacCab_ManagedVehicles, Vehicles.Num());
+	SET_FLOAT_STAT(STAT_ManiacCab_VehiclesPerMs, elapsedMs > 0 ? Vehicles.Num() / elapsedMs : 0);
+	SET_DWORD_STAT(STAT_ManiacCab_FullTierVehicles, tierVehicles[int32(EVehicleSimulationTier::Full)]);
+	SET_DWORD_STAT(STAT_ManiacCab_ReducedTierVehicles, tierVehicles[int32(EVehicleSimulationTier::Reduced)]);
+	SET_DWORD_STAT(STAT_ManiacCab_KinematicTierVehicles, tierVehicles[int32(EVehicleSimulationTier::Kinematic)]);
+	SET_FLOAT_STAT(STAT_ManiacCab_FullTierMs, FPlatformTime::ToMilliseconds64(tierCycles[int32(EVehicleSimulationTier::Full)]));
+	SET_FLOAT_STAT(STAT_ManiacCab_ReducedTierMs, FPlatformTime::ToMilliseconds64(tierCycles[int32(EVehicleSimulationTier::Reduced)]));
+	SET_FLOAT_STAT(STAT_ManiacCab_KinematicTierMs, FPlatformTime::ToMilliseconds64(tierCycles[int32(EVehicleSimulationTier::Kinematic)]));
+}
+
+void UVehicleManagerSubsystem::UpdateSimulationTiers()
+{
+	const UWorld* world = GetWorld();
+	const APlayerController* playerController = world->GetFirstPlayerController();
+	//Tiers follow the local camera, which says nothing about what remote players see.
+	const bool tiersAllowed = CVarSimulationTiers.GetValueOnGameThread() && world->GetNetMode() == NM_Standalone
+		&& playerController != nullptr && playerController->PlayerCameraManager != nullptr;
+	if (!tiersAllowed)
+	{
+		for (ACarController* vehicle : Vehicles)
+			vehicle->SetSimulationTier(EVehicleSimulationTier::Full);
+		return;
+	}
+
+	const APlayerCameraManager* camera = playerController->PlayerCameraManager;
+	const FVector cameraLocation = camera->GetCameraLocation();
+	const FVector cameraForward = camera->GetCameraRotation().Vector();
+	const float viewCosine = FMath::Cos(FMath::DegreesToRadians(FMath::Min(camera->GetFOVAngle() * 0.5f + 15.0f, 89.0f)));
+	//The player's car is always full, the budget only pulls the others in.
+	const UVehicleBudgetSubsystem* budget = world->GetSubsystem<UVehicleBudgetSubsystem>();
+	const float distanceScale = budget != nullptr ? budget->GetBudget().TierDistanceScale : 1.0f;
+	const float fullDistance = CVarFullTierDistance.GetValueOnGameThread() * distanceScale;
+	const float reducedDistance = CVarReducedTierDistance.GetValueOnGameThread() * distanceScale;
+
+	for (ACarController* vehicle : Vehicles)
+	{
+		if (vehicle->IsPlayerControlled())
+		{
+			vehicle->SetSimulationTier(EVehicleSimulationTier::Full);
+			continue;
+		}
+
+		const FVector toVehicle = vehicle->CarChassis->GetComponentLocation() - cameraLocation;
+		float distance = toVehicle.Size();
+		if (FVector::DotProduct(toVehicle.GetSafeNormal(), cameraForward) < viewCosine)
+			distance *= OutOfViewDistanceScale;
+
+		const EVehicleSimulationTier currentTier = vehicle->GetSimulationTier();
+		const float fullLimit = fullDistance * (currentTier == EVehicleSimulationTier::Full ? TierHysteresis : 1.0f);
+		const float reducedLimit = reducedDistance * (currentTier != EVehicleSimulationTier::Kinematic ? TierHysteresis : 1.0f);
+
+		if (distance < fullLimit)
+			vehicle->SetSimulationTier(EVehicleSimulationTier::Full);
+		else if (distance < reducedLimit)
+			vehicle->SetSimulationTier(EVehicleSimulationTier::Reduced);
+		else
+			vehicle->SetSimulationTier(EVehicleSimulationTier::Kinematic);
+	}
+}
+
+TStatId UVehicleManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleManagerSubsystem, STATGROUP_Tickables);
+}
+
+bool UVehicleManagerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVehicleManagerSubsystem::SetVehicleTicksEnabled(bool a_Enabled)
+{
+	for (ACarController* vehicle : Vehicles)
+		vehicle->SetActorTickEnabled(a_Enabled);
+}
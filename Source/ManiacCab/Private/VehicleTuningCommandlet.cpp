@@ -0,0 +1,295 @@
+#include "VehicleTuningCommandlet.h"
+
+#include "CarController.h"
+#include "ManiacCab.h"
+#include "Algo/Count.h"
+#include "Algo/Find.h"
+#include "Async/ParallelFor.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	const TCHAR* const SweepNames[] = {
+		TEXT("SpringStrength"), TEXT("DampingAmount"), TEXT("TireMass"), TEXT("MaxTorque"),
+		TEXT("CarTopSpeed"), TEXT("SpringRestDistance"), TEXT("FrictionScale"), TEXT("DriftFrictionScale")
+	};
+
+	//A missing curve bakes to zero, as the game evaluates a null curve.
+	void BakeScaled(const UCurveFloat* a_Curve, float a_Scale, FBakedCurve& o_BakedCurve)
+	{
+		if (a_Curve == nullptr)
+		{
+			o_BakedCurve.Bake(0.0f, 1.0f, [](float a_Time) { return 0.0f; });
+			return;
+		}
+
+		const FRichCurve& sourceCurve = a_Curve->FloatCurve;
+		o_BakedCurve.Bake(0.0f, 1.0f, [&sourceCurve, a_Scale](float a_Time) { return sourceCurve.Eval(a_Time) * a_Scale; });
+	}
+}
+
+UVehicleTuningCommandlet::UVehicleTuningCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UVehicleTuningCommandlet::Main(const FString& Params)
+{
+	FString vehicleClass = TEXT("/Game/I01_Core/Blueprints/Car/BP_Car.BP_Car_C");
+	FString sweep = TEXT("SpringStrength=8000:20000:5,DampingAmount=1000:5000:5,TireMass=20:40:3,FrictionScale=0.8:1.2:3");
+	FString outputPath;
+	int32 samples = 0;
+	int32 seed = 1234;
+	int32 maxConfigs = 100000;
+	float deltaTime = 1.0f / 60.0f;
+	FParse::Value(*Params, TEXT("VehicleClass="), vehicleClass);
+	FParse::Value(*Params, TEXT("Sweep="), sweep, false);
+	FParse::Value(*Params, TEXT("Samples="), samples);
+	FParse::Value(*Params, TEXT("Seed="), seed);
+	FParse::Value(*Params, TEXT("MaxConfigs="), maxConfigs);
+	FParse::Value(*Params, TEXT("DeltaTime="), deltaTime);
+	if (!FParse::Value(*Params, TEXT("Output="), outputPath))
+		outputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks/VehicleTuning.csv");
+
+	TArray<FSweepRange> ranges;
+	FVehicleSource source;
+	if (!ParseSweep(sweep, ranges) || !ReadVehicle(vehicleClass, source))
+		return 1;
+
+	int64 configCount = samples;
+	if (samples <= 0)
+	{
+		configCount = 1;
+		for (const FSweepRange& range : ranges)
+			configCount *= range.Steps;
+	}
+	if (configCount > maxConfigs)
+	{
+		UE_LOG(LogManiacCab, Error, TEXT("The sweep has %lld configurations, more than -MaxConfigs=%d"), configCount, maxConfigs);
+		return 1;
+	}
+
+	TArray<TArray<float>> values;
+	values.SetNum(int32(configCount));
+	FRandomStream random(seed);
+	for (int32 config = 0; config < values.Num(); config++)
+	{
+		//Grid sweeps count through the ranges like digits, the first range changing fastest.
+		int32 gridIndex = config;
+		for (const FSweepRange& range : ranges)
+		{
+			float value = range.Min;
+			if (samples > 0)
+				value = random.FRandRange(range.Min, range.Max);
+			else if (range.Steps > 1)
+				value = FMath::Lerp(range.Min, range.Max, float(gridIndex % range.Steps) / (range.Steps - 1));
+			gridIndex /= range.Steps;
+			values[config].Add(value);
+		}
+	}
+
+	TArray<FVehicleTuningConfig> configs;
+	MakeConfigs(source, ranges, values, configs);
+
+	TArray<FVehicleManeuverMetrics> metrics[int32(EVehicleManeuver::Count)];
+	const int32 taskCount = FMath::DivideAndRoundUp(configs.Num(), ConfigsPerTask);
+	const double startTime = FPlatformTime::Seconds();
+	double simulatedSeconds = 0;
+	for (int32 maneuver = 0; maneuver < int32(EVehicleManeuver::Count); maneuver++)
+	{
+		metrics[maneuver].SetNum(configs.Num());
+		ParallelFor(taskCount, [&](int32 a_Task)
+		{
+			const int32 first = a_Task * ConfigsPerTask;
+			const int32 count = FMath::Min(ConfigsPerTask, configs.Num() - first);
+			VehicleTuning::SimulateManeuver(source.Body, MakeArrayView(configs).Slice(first, count), EVehicleManeuver(maneuver), deltaTime,
+				MakeArrayView(metrics[maneuver]).Slice(first, count));
+		});
+		simulatedSeconds += double(configs.Num()) * VehicleTuning::GetManeuverDuration(EVehicleManeuver(maneuver));
+	}
+	const double wallSeconds = FPlatformTime::Seconds() - startTime;
+
+	WriteResults(outputPath, ranges, values, metrics);
+	UE_LOG(LogManiacCab, Display, TEXT("%d configurations through %d manoeuvres in %.2f s, %.0f simulated seconds per second. Written to %s"),
+		configs.Num(), int32(EVehicleManeuver::Count), wallSeconds, wallSeconds > 0 ? simulatedSeconds / wallSeconds : 0.0, *outputPath);
+	for (int32 maneuver = 0; maneuver < int32(EVehicleManeuver::Count); maneuver++)
+	{
+		const int32 unstable = Algo::CountIf(metrics[maneuver], [](const FVehicleManeuverMetrics& a_Metrics) { return a_Metrics.Unstable; });
+		UE_LOG(LogManiacCab, Display, TEXT("%s: %d unstable"), VehicleTuning::GetManeuverName(EVehicleManeuver(maneuver)), unstable);
+	}
+	return 0;
+}
+
+bool UVehicleTuningCommandlet::ParseSweep(const FString& a_Sweep, TArray<FSweepRange>& o_Ranges)
+{
+	TArray<FString> entries;
+	a_Sweep.ParseIntoArray(entries, TEXT(","));
+	for (const FString& entry : entries)
+	{
+		FString name;
+		FString rangeText;
+		TArray<FString> parts;
+		if (entry.Split(TEXT("="), &name, &rangeText))
+			rangeText.ParseIntoArray(parts, TEXT(":"));
+
+		FSweepRange& range = o_Ranges.AddDefaulted_GetRef();
+		range.Name = name.TrimStartAndEnd();
+		const bool knownName = Algo::FindByPredicate(SweepNames, [&range](const TCHAR* a_Name) { return range.Name == a_Name; }) != nullptr;
+		if (!knownName || parts.Num() != 3)
+		{
+			UE_LOG(LogManiacCab, Error, TEXT("Could not parse sweep entry '%s', expected Name=Min:Max:Steps with a name from the commandlet's documentation"), *entry);
+			return false;
+		}
+
+		range.Min = FCString::Atof(*parts[0]);
+		range.Max = FCString::Atof(*parts[1]);
+		range.Steps = FMath::Max(FCString::Atoi(*parts[2]), 1);
+	}
+	return true;
+}
+
+bool UVehicleTuningCommandlet::ReadVehicle(const FString& a_VehicleClass, FVehicleSource& o_Source)
+{
+	UClass* vehicleClass = LoadClass<ACarController>(nullptr, *a_VehicleClass);
+	if (vehicleClass == nullptr)
+	{
+		UE_LOG(LogManiacCab, Error, TEXT("Could not load vehicle class %s"), *a_VehicleClass);
+		return false;
+	}
+
+	const ACarController* defaults = vehicleClass->GetDefaultObject<ACarController>();
+	FVehicleTuningConfig& config = o_Source.Defaults;
+	config.Params.SpringRestDistance = defaults->SpringRestDistance;
+	config.Params.SpringStrength = defaults->SpringStrength;
+	config.Params.DampingAmount = defaults->DampingAmount;
+	config.Params.TireMass = defaults->TireMass;
+	config.Params.CarTopSpeed = defaults->CarTopSpeed;
+	config.Params.MaxTorque = defaults->MaxTorque;
+	config.MaxTurnAngle = defaults->MaxTurnAngle;
+	config.RotateSpeed = defaults->RotateSpeed;
+	o_Source.Body.FloorCheckLimit = defaults->FloorCheckLimit;
+	o_Source.Body.WheelCheckHeightOffset = defaults->WheelCheckHeightOffset;
+
+	//Only the road curves, the manoeuvres are all driven on road.
+	o_Source.TorqueCurve = defaults->CarTorqueCurve.LoadSynchronous();
+	o_Source.FrontWheelFrictionCurve = defaults->FrontWheelFrictionCurve.LoadSynchronous();
+	o_Source.BackWheelFrictionCurve = defaults->BackWheelFrictionCurve.LoadSynchronous();
+	o_Source.FrontWheelDriftFrictionCurve = defaults->FrontWheelDriftFrictionCurve.LoadSynchronous();
+	o_Source.BackWheelDriftFrictionCurve = defaults->BackWheelDriftFrictionCurve.LoadSynchronous();
+
+	//The components are set up in the Blueprint, so the body is read from a spawned car rather than the class defaults.
+	UWorld* world = UWorld::CreateWorld(EWorldType::Game, false, TEXT("VehicleTuning"));
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+	world->InitializeActorsForPlay(FURL());
+
+	bool readBody = false;
+	const ACarController* car = world->SpawnActor<ACarController>(vehicleClass, FVector::ZeroVector, FRotator::ZeroRotator);
+	if (car != nullptr && car->CarChassis != nullptr && car->CarChassis->GetMass() > 0)
+	{
+		const UStaticMeshComponent* wheels[4] = { car->FrontLeftWheel, car->FrontRightWheel, car->BackLeftWheel, car->BackRightWheel };
+		const FTransform chassisTransform = car->CarChassis->GetComponentTransform();
+		const FVector centerOfMass = car->CarChassis->GetCenterOfMass();
+		o_Source.Body.Mass = car->CarChassis->GetMass();
+		o_Source.Body.Inertia = FVector3f(car->CarChassis->GetInertiaTensor());
+		readBody = true;
+		for (int32 i = 0; i < 4; i++)
+		{
+			readBody &= wheels[i] != nullptr;
+			if (wheels[i] != nullptr)
+				o_Source.Body.WheelOffsets[i] = FVector3f(chassisTransform.InverseTransformVectorNoScale(wheels[i]->GetComponentLocation() - centerOfMass));
+		}
+	}
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+
+	if (!readBody)
+	{
+		UE_LOG(LogManiacCab, Error, TEXT("Could not read the chassis and wheels of %s"), *a_VehicleClass);
+		return false;
+	}
+
+	UE_LOG(LogManiacCab, Display, TEXT("%s: %.0f kg, inertia %s, wheelbase %.0f, track %.0f"), *vehicleClass->GetName(), o_Source.Body.Mass,
+		*o_Source.Body.Inertia.ToString(), o_Source.Body.WheelOffsets[0].X - o_Source.Body.WheelOffsets[2].X,
+		o_Source.Body.WheelOffsets[1].Y - o_Source.Body.WheelOffsets[0].Y);
+	return true;
+}
+
+void UVehicleTuningCommandlet::MakeConfigs(const FVehicleSource& a_Source, const TArray<FSweepRange>& a_Ranges, const TArray<TArray<float>>& a_Values,
+	TArray<FVehicleTuningConfig>& o_Configs)
+{
+	o_Configs.SetNum(a_Values.Num());
+	for (int32 config = 0; config < a_Values.Num(); config++)
+	{
+		FVehicleTuningConfig& tuning = o_Configs[config];
+		tuning = a_Source.Defaults;
+		float frictionScale = 1;
+		float driftFrictionScale = 1;
+		for (int32 i = 0; i < a_Ranges.Num(); i++)
+		{
+			const FString& name = a_Ranges[i].Name;
+			const float value = a_Values[config][i];
+			if (name == TEXT("SpringStrength"))
+				tuning.Params.SpringStrength = value;
+			else if (name == TEXT("DampingAmount"))
+				tuning.Params.DampingAmount = value;
+			else if (name == TEXT("TireMass"))
+				tuning.Params.TireMass = value;
+			else if (name == TEXT("MaxTorque"))
+				tuning.Params.MaxTorque = value;
+			else if (name == TEXT("CarTopSpeed"))
+				tuning.Params.CarTopSpeed = value;
+			else if (name == TEXT("SpringRestDistance"))
+				tuning.Params.SpringRestDistance = value;
+			else if (name == TEXT("FrictionScale"))
+				frictionScale = value;
+			else if (name == TEXT("DriftFrictionScale"))
+				driftFrictionScale = value;
+		}
+
+		BakeScaled(a_Source.TorqueCurve, 1.0f, tuning.TorqueCurve);
+		BakeScaled(a_Source.FrontWheelFrictionCurve, frictionScale, tuning.FrontWheelFriction);
+		BakeScaled(a_Source.BackWheelFrictionCurve, frictionScale, tuning.BackWheelFriction);
+		BakeScaled(a_Source.FrontWheelDriftFrictionCurve, driftFrictionScale, tuning.FrontWheelDriftFriction);
+		BakeScaled(a_Source.BackWheelDriftFrictionCurve, driftFrictionScale, tuning.BackWheelDriftFriction);
+	}
+}
+
+void UVehicleTuningCommandlet::WriteResults(const FString& a_Path, const TArray<FSweepRange>& a_Ranges, const TArray<TArray<float>>& a_Values,
+	const TArray<FVehicleManeuverMetrics> (&a_Metrics)[int32(EVehicleManeuver::Count)])
+{
+	//Rewritten every run, the columns follow the sweep.
+	FString text = TEXT("Config");
+	for (const FSweepRange& range : a_Ranges)
+		text += TEXT(",") + range.Name;
+	for (int32 maneuver = 0; maneuver < int32(EVehicleManeuver::Count); maneuver++)
+	{
+		const TCHAR* name = VehicleTuning::GetManeuverName(EVehicleManeuver(maneuver));
+		text += FString::Printf(TEXT(",%sTopSpeed,%sOscillation,%sTimeToSettle,%sMaxDriftAngle,%sMaxRoll,%sUnstable"), name, name, name, name, name, name);
+	}
+	text += TEXT("\n");
+
+	for (int32 config = 0; config < a_Values.Num(); config++)
+	{
+		text += FString::FromInt(config);
+		for (const float value : a_Values[config])
+			text += FString::Printf(TEXT(",%g"), value);
+		for (int32 maneuver = 0; maneuver < int32(EVehicleManeuver::Count); maneuver++)
+		{
+			const FVehicleManeuverMetrics& metrics = a_Metrics[maneuver][config];
+			text += FString::Printf(TEXT(",%.1f,%.2f,%.3f,%.1f,%.1f,%d"), metrics.TopSpeed, metrics.Oscillation, metrics.TimeToSettle,
+				metrics.MaxDriftAngle, metrics.MaxRoll, metrics.Unstable ? 1 : 0);
+		}
+		text += TEXT("\n");
+	}
+
+	FFileHelper::SaveStringToFile(text, *a_Path);
+}
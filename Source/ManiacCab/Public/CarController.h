@@ -7,13 +7,72 @@
 #include "InputAction.h"
 #include "CoreMinimal.h"
 #include "InputMappingContext.h"
+#include "WorldCollision.h"
+#include "VehicleDynamics.h"
+#include "CarInputRecording.h"
+#include "CarNetSnapshot.h"
+#include "CarSurfaceSubsystem.h"
+#include "Engine/StreamableManager.h"
 #include "CarController.generated.h"
 
+class FCarPhysicsCallback;
+class ACarController;
+struct FVehicleBudget;
+
+//Whether the car touches the ground, with the in-between states that keep a single missed probe from counting as a jump.
+UENUM(BlueprintType)
+enum class ECarContactState : uint8
+{
+	Grounded,
+	//No wheel touches, but not for long enough to count as a jump yet.
+	Leaving,
+	Airborne,
+	//Touched down after a jump, waiting for the contact to hold.
+	Landing,
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCarContactEvent, ACarController*, Car);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCarReadyEvent, ACarController*, Car);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FCarContactStateChanged, ACarController*, Car, ECarContactState, PreviousState, ECarContactState, NewState);
+
+//Curves used while a wheel is on a surface other than road. Unset curves fall back to the car's road curves.
+USTRUCT(BlueprintType)
+struct FCarSurfaceCurves
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<UCurveFloat> TorqueCurve;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<UCurveFloat> FrontWheelFrictionCurve;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<UCurveFloat> BackWheelFrictionCurve;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<UCurveFloat> FrontWheelDriftFrictionCurve;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<UCurveFloat> BackWheelDriftFrictionCurve;
+};
+
+//How much of the car model runs, picked by UVehicleManagerSubsystem from distance to and visibility from the camera.
+UENUM(BlueprintType)
+enum class EVehicleSimulationTier : uint8
+{
+	//Four probes, air correction and effects every frame.
+	Full,
+	//Updated every few frames from a single ground probe, the last wheel forces are held in between.
+	Reduced,
+	//No physics, probes or effects, the car keeps driving along its heading.
+	Kinematic,
+};
+
 UCLASS()
 class MANIACCAB_API ACarController : public APawn
 {
 	GENERATED_BODY()
 
+	friend class UVehicleManagerSubsystem;
+	friend class UVehicleLODSubsystem;
+
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Camera");
 	UCameraComponent* FollowCamera;
@@ -28,6 +87,11 @@ public:
 	float FloorCheckLimit = 100;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Physics")
 	float TireMass = 30;
+	//Runs the spring, friction and acceleration forces on the physics thread every physics step instead of once per frame.
+	//The step rate is the project's async physics tick, Async Fixed Time Step Size in DefaultEngine.ini (120Hz, 240Hz at 0.004167).
+	//Cars always run on the physics thread while the project ticks physics async, whatever this is set to.
+	UPROPERTY(EditAnywhere, Category="Car Physics")
+	bool UseFixedRatePhysics = false;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Movement")
 	float CarTopSpeed = 2000;
@@ -44,10 +108,17 @@ public:
 	float InAirCorrectionSpeed = 0.5f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
 	float AirLogicEnableDelay = 0.9f;
+	//How long the wheels have to keep touching after a jump before the car counts as landed.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
-	float AirFloorCheckResetDelay = 1.0f;
+	float LandingConfirmTime = 0.1f;
+	//How far ahead the landing is looked for along the jump arc, and in how many traces.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
-	float PerAirTraceAngle = 5.0f;
+	float LandingPredictionTime = 4.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
+	int32 LandingPredictionSegments = 8;
+	//The landing is predicted again once the velocity strays this far from the arc, e.g. after hitting something mid air.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
+	float LandingPredictionTolerance = 150.0f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
 	float InAirFloorCheckLimit = 110.0f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Air Settings")
@@ -55,20 +126,38 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Camera")
 	float CameraFOVAtMaxSpeed = 100.0f;
+
+	//Locally controlled cars have UCarStreamingSubsystem stream the world in along where they will be this many seconds from now.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Streaming")
+	bool UseStreamingSource = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Streaming", meta=(ClampMin="0"))
+	float StreamingLookAheadTime = 3.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Streaming", meta=(ClampMin="1"))
+	int32 StreamingPathPoints = 6;
 	
 	UPROPERTY(EditAnywhere, Category="Floor Checking Settings")
 	TEnumAsByte<ECollisionChannel> TraceChannelProperty = ECC_Pawn;
+	//Submits the wheel probes as one async batch and reads the results next tick. Off = synchronous traces.
+	UPROPERTY(EditAnywhere, Category="Floor Checking Settings")
+	bool UseAsyncTraces = true;
+	//Answers wheel probes from the baked static ground in UCarGroundSubsystem where it can, tracing only where it cannot.
+	UPROPERTY(EditAnywhere, Category="Floor Checking Settings")
+	bool UseGroundHeightfield = false;
 
+	//Curves and effects are soft references, loaded asynchronously from PostInitializeComponents. See IsVehicleReady.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
+	TSoftObjectPtr<UCurveFloat> CarTorqueCurve;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
-	UCurveFloat* CarTorqueCurve;
+	TSoftObjectPtr<UCurveFloat> FrontWheelFrictionCurve;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
-	UCurveFloat* FrontWheelFrictionCurve;
+	TSoftObjectPtr<UCurveFloat> BackWheelFrictionCurve;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
-	UCurveFloat* BackWheelFrictionCurve;
+	TSoftObjectPtr<UCurveFloat> FrontWheelDriftFrictionCurve;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
-	UCurveFloat* FrontWheelDriftFrictionCurve;
+	TSoftObjectPtr<UCurveFloat> BackWheelDriftFrictionCurve;
+	//The curves above are for road, these take over per wheel on the surfaces listed. See UCarSurfaceSubsystem.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Curve References")
-	UCurveFloat* BackWheelDriftFrictionCurve;
+	TMap<ECarSurfaceType, FCarSurfaceCurves> SurfaceCurves;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
 	UStaticMeshComponent* CarChassis;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
@@ -80,7 +169,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
 	UStaticMeshComponent* BackRightWheel;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
-	UNiagaraSystem* TireDriftingParticleEffect;
+	TSoftObjectPtr<UNiagaraSystem> TireDriftingParticleEffect;
+	//Falls back to the TireSkid material when not set. Cars sharing a material share one skid mark buffer.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
+	TSoftObjectPtr<UMaterialInterface> SkidMarkMaterial;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Asset References")
+	float SkidMarkWidth = 25.0f;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Car Input")
 	FVector InputAxis;
@@ -99,6 +193,25 @@ public:
 	UInputAction* ResetCarAction;
 
 	
+	//Ticks between chassis keyframes in input recordings.
+	UPROPERTY(EditAnywhere, Category="Car Recording")
+	int32 RecordingKeyframeInterval = 60;
+	//Teleports the chassis to each recorded keyframe during replay so long sessions do not drift apart.
+	UPROPERTY(EditAnywhere, Category="Car Recording")
+	bool ReplaySnapToKeyframes = true;
+
+	//Upper bound on snapshot traffic per car per connection. The net update rate is derived from it.
+	UPROPERTY(EditAnywhere, Category="Car Networking")
+	float NetBytesPerSecondBudget = 1200.0f;
+	//How far behind the server's time remote cars are drawn, enough to always have two snapshots to blend between.
+	UPROPERTY(EditAnywhere, Category="Car Networking")
+	float NetInterpolationDelay = 0.1f;
+	//Prediction errors above this are teleported away, smaller ones are blended out over a few frames.
+	UPROPERTY(EditAnywhere, Category="Car Networking")
+	float NetSnapDistance = 250.0f;
+	UPROPERTY(EditAnywhere, Category="Car Networking")
+	float NetCorrectionSpeed = 10.0f;
+
 	UPROPERTY(EditAnywhere, Category="Debug Settings")
 	bool DrawForces = true;
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category="Debug Settings")
@@ -106,45 +219,303 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category="Debug Settings")
 	bool AllowCarInput = true;
 
-	UPROPERTY()
-	FTimerHandle InAirTimerHandle;	
-	UPROPERTY()
-	FTimerHandle AirFloorCheckResetTimerHandle;
+	//Fires once the car has been off the ground for AirLogicEnableDelay.
+	UPROPERTY(BlueprintAssignable, Category="Car Contact")
+	FCarContactEvent OnTakeoff;
+	//Fires once the wheels have held the ground for LandingConfirmTime after a jump.
+	UPROPERTY(BlueprintAssignable, Category="Car Contact")
+	FCarContactEvent OnLanded;
+	UPROPERTY(BlueprintAssignable, Category="Car Contact")
+	FCarContactStateChanged OnContactStateChanged;
+	//Fires once the curves and effects are loaded and warmed up, driver input is ignored until then.
+	UPROPERTY(BlueprintAssignable, Category="Car Loading")
+	FCarReadyEvent OnVehicleReady;
 
+	//Borrowed from UCarEffectsSubsystem while the car drifts on the ground, null otherwise.
 	UPROPERTY()
 	UNiagaraComponent* BackLeftTireDriftEffect;
 	UPROPERTY()
 	UNiagaraComponent* BackRightTireDriftEffect;
 	
 private:
+	static constexpr int32 WheelCount = 4;
+
+	struct FProbeResult
+	{
+		FVector Location = FVector::ZeroVector;
+		bool BlockingHit = false;
+		bool Ready = false;
+	};
+
+	FCollisionQueryParams TraceQueryParams;
+	FTraceDelegate AsyncTraceDelegate;
+	FProbeResult ProbeResults[WheelCount];
+	//Signed, it goes below zero when the suspension is compressed past the probe start. Only meaningful where WheelGrounded is set.
+	float WheelFloorDistances[WheelCount] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	bool WheelGrounded[WheelCount] = { false, false, false, false };
+	//Wheels answered by the ground heightfield last update, no async probe is sent for them.
+	bool WheelUsedHeightfield[WheelCount] = { false, false, false, false };
+	FCarPhysicsCallback* PhysicsCallback = nullptr;
+	FVehicleDynamicsBatch DynamicsBatch;
+
+	//Tables for the curves above, shared with every other car using the same assets. See UCurveBakingSubsystem.
+	struct FBakedSurfaceCurves
+	{
+		const FBakedCurve* Torque = nullptr;
+		const FBakedCurve* FrontWheelFriction = nullptr;
+		const FBakedCurve* BackWheelFriction = nullptr;
+		const FBakedCurve* FrontWheelDriftFriction = nullptr;
+		const FBakedCurve* BackWheelDriftFriction = nullptr;
+	};
+
+	//Indexed by ECarSurfaceType, surfaces without their own curves hold the road tables.
+	FBakedSurfaceCurves BakedSurfaceCurves[UCarSurfaceSubsystem::SurfaceTypeCount];
+	//Surface under each wheel the last time it touched the ground.
+	ECarSurfaceType WheelSurfaces[WheelCount] = { ECarSurfaceType::Road, ECarSurfaceType::Road, ECarSurfaceType::Road, ECarSurfaceType::Road };
+
 	float OriginalCameraFov = 0;
 	float OriginalFloorCheckValue;
 	bool IsInAir = false;
 	bool HoldingSpace = false;
 	bool IsDrifting = false;
 
+	TUniquePtr<FCarInputRecorder> InputRecorder;
+	TUniquePtr<FCarReplayReader> InputReplay;
+	//Read one frame ahead, so its delta time can be handed to the engine before the tick it is applied in.
+	FCarInputFrame NextReplayFrame;
+	bool HasNextReplayFrame = false;
+	int32 RecordedFrameCount = 0;
+	bool PendingResetEvent = false;
+	bool ApplyingReplayInput = false;
+	bool UsingProxyLOD = false;
+
+	static constexpr int32 ReducedUpdateInterval = 3;
+	//Kinematic cars have no steering to hold a turn, their yaw rate falls to about a third in this many seconds.
+	static constexpr float KinematicYawDecayTime = 1.0f;
+	static constexpr float GroundSearchHeight = 5000.0f;
+
+	//Wheel forces in chassis space, so reduced cars can keep applying them between updates as the chassis moves.
+	struct FHeldWheelForce
+	{
+		FVector LocalForce = FVector::ZeroVector;
+		FVector LocalHeldForce = FVector::ZeroVector;
+		FVector LocalPosition = FVector::ZeroVector;
+		bool Grounded = false;
+	};
+
+	EVehicleSimulationTier SimulationTier = EVehicleSimulationTier::Full;
+	uint32 ReducedFrameCounter = 0;
+	FHeldWheelForce HeldWheelForces[WheelCount];
+	FVector KinematicVelocity = FVector::ZeroVector;
+	float KinematicYawRate = 0;
+	float KinematicRideHeight = 0;
+
+	static constexpr float MinSkidSegmentLength = 30.0f;
+	static constexpr float MaxSkidSegmentLength = 300.0f;
+
+	//Probe results of the last eight updates per wheel, newest in the lowest bit.
+	uint8 WheelContactHistory[WheelCount] = { 0, 0, 0, 0 };
+	//Contact in either of the last two updates keeps a landing going.
+	static constexpr uint8 RecentContactMask = 0b11;
+	ECarContactState ContactState = ECarContactState::Grounded;
+	float ContactStateTime = 0;
+	double LastContactUpdateTime = 0;
+
+	//Where the jump arc meets the ground, predicted on takeoff from the launch state.
+	struct FLandingPrediction
+	{
+		FVector Location = FVector::ZeroVector;
+		FVector Normal = FVector::UpVector;
+		//Chassis state the arc starts from, to tell when the car has left it.
+		FVector LaunchLocation = FVector::ZeroVector;
+		FVector LaunchVelocity = FVector::ZeroVector;
+		double LaunchTime = 0;
+		//Seconds from the launch to the landing.
+		float FlightTime = 0;
+		bool Valid = false;
+	};
+
+	static constexpr float LandingRetryInterval = 0.25f;
+	FLandingPrediction LandingPrediction;
+
+	TSharedPtr<FStreamableHandle> AssetLoadHandle;
+	double AssetLoadStartTime = 0;
+	bool VehicleReady = false;
+
+	bool DriftEffectsActive = false;
+	bool RightDriftEffectActive = false;
+	FVector LastSkidPoints[2];
+	bool HasSkidPoint[2] = { false, false };
+
+	static constexpr int32 PredictionHistorySize = 64;
+	static constexpr int32 InterpolationBufferSize = 16;
+
+	//Owning client pose after each sent input, stored without the corrections applied since so they are not counted twice.
+	struct FPredictedState
+	{
+		uint16 Sequence = 0;
+		FVector Location = FVector::ZeroVector;
+		bool Valid = false;
+	};
+
+	UPROPERTY(ReplicatedUsing=OnRep_ReplicatedState)
+	FCarNetSnapshot ReplicatedState;
+
+	FPredictedState PredictionHistory[PredictionHistorySize];
+	//Oldest first, in server time order.
+	FCarNetSnapshot InterpolationBuffer[InterpolationBufferSize];
+	int32 InterpolationSampleCount = 0;
+	FCarNetBaselines NetBaselines;
+	FCarNetSnapshotHistory ReceivedSnapshots;
+	uint16 NetInputSequence = 0;
+	float NetInputSendTimer = 0;
+	uint16 LastProcessedInput = 0;
+	uint16 LastReconciledInput = 0;
+	FVector PendingCorrection = FVector::ZeroVector;
+	FVector AppliedCorrection = FVector::ZeroVector;
+
 public:
 	UFUNCTION(BlueprintCallable)
 	void EnableCarInput(bool Allow) {AllowCarInput = Allow;}
+	//Drives the car without a player controller, used by the benchmark and tooling.
+	UFUNCTION(BlueprintCallable)
+	void SetScriptedInput(float a_Steering, float a_Throttle, bool a_HandBrake);
+
+	//Writes the input of every tick, plus periodic chassis keyframes, to a compact binary file. See CarInputRecording.h.
+	UFUNCTION(BlueprintCallable, Category="Car Recording")
+	bool StartRecording(const FString& a_Path);
+	UFUNCTION(BlueprintCallable, Category="Car Recording")
+	void StopRecording();
+	//Feeds a recording back through the input handlers, one recorded frame per tick, with the engine stepping by each frame's
+	//recorded delta time. Live input is ignored until it ends.
+	UFUNCTION(BlueprintCallable, Category="Car Recording")
+	bool StartReplay(const FString& a_Path);
+	UFUNCTION(BlueprintCallable, Category="Car Recording")
+	void StopReplay();
+	UFUNCTION(BlueprintPure, Category="Car Recording")
+	bool IsReplaying() const { return InputReplay.IsValid(); }
+
+	UFUNCTION(BlueprintPure, Category="Car Loading")
+	bool IsVehicleReady() const { return VehicleReady; }
+
+	UFUNCTION(BlueprintPure, Category="Car Simulation")
+	EVehicleSimulationTier GetSimulationTier() const { return SimulationTier; }
+	UFUNCTION(BlueprintPure, Category="Car Contact")
+	ECarContactState GetContactState() const { return ContactState; }
+	//Bit i is set if the wheel touched the ground i updates ago, for the last eight updates.
+	UFUNCTION(BlueprintPure, Category="Car Contact")
+	int32 GetWheelContactHistory(int32 a_WheelIndex) const { return a_WheelIndex >= 0 && a_WheelIndex < WheelCount ? WheelContactHistory[a_WheelIndex] : 0; }
+	UFUNCTION(BlueprintPure, Category="Car Physics")
+	ECarSurfaceType GetWheelSurface(int32 a_WheelIndex) const { return a_WheelIndex >= 0 && a_WheelIndex < WheelCount ? WheelSurfaces[a_WheelIndex] : ECarSurfaceType::Road; }
+	//Velocity of the body, or of the kinematic motion while it is not simulated.
+	FVector GetChassisLinearVelocity() const;
+	//Server: a_Connection decoded snapshot a_Sequence, later snapshots to it are written against that one.
+	void AcknowledgeSnapshot(const UNetConnection* a_Connection, uint16 a_Sequence);
+	FVector GetChassisAngularVelocity() const;
+	//Where the chassis is expected to be at StreamingPathPoints even steps up to a_LookAheadTime from now. Follows the
+	//jump arc to the predicted landing while in the air, and the current velocity turning at the current yaw rate on the ground.
+	void GetPredictedPath(float a_LookAheadTime, TArray<FVector>& o_Path) const;
 
 protected:
+	virtual void PostInitializeComponents() override;
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	//Takes the snapshot once per net update, so every sequence number is one clients can receive and acknowledge.
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual void PostNetReceiveRole() override;
 	
 	void ScaleCarFOVOnSpeed();
+	//Effects follow state changes: borrowed when the car starts drifting on the ground, returned when it stops, lifts off or drops a tier.
+	void UpdateDriftEffects();
+	//What UVehicleBudgetSubsystem leaves this car to do. Everything, for the player's car.
+	FVehicleBudget GetVehicleBudget() const;
+	void AddSkidMarks();
 	void ProcessAirRotation();
-	void UpdateAllWheels();
+	void UpdateAllWheels(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex);
+
+	//A frame is split into phases so UVehicleManagerSubsystem can run the force kernels for many cars at once.
+	//Prepare and Finish touch components and must run on the game thread, the kernels in between only read the batch and curves.
+	void PrepareVehicleUpdate(FVehicleDynamicsBatch& o_Batch, int32 a_VehicleIndex);
+	void FinishVehicleUpdate(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex);
+
+	//Adapter between the components and the engine independent wheel model: transforms are read once per wheel and forces written once.
+	void GatherWheelState(FVehicleDynamicsBatch& o_Batch, int32 a_VehicleIndex);
+	void FillDynamicsParams(FVehicleDynamicsParams& o_Params) const;
+	void ApplyWheelForces(const FVehicleDynamicsBatch& a_Batch, int32 a_VehicleIndex);
+	//Between updates only the spring and drive are held. The damping and friction were sized to cancel the velocity at the update.
+	void ApplyHeldWheelForces(bool a_BetweenUpdates);
+	const FBakedCurve* GetWheelFrictionCurve(int32 a_WheelIndex) const;
+	void BakeCurves();
+	//Starts loading the soft referenced curves and effects, during level load for placed cars.
+	void RequestVehicleAssets();
+	//Bakes the curves and prewarms the effects once both the load and BeginPlay are done, then enables driver input.
+	void OnVehicleAssetsLoaded();
+
+	bool WheelGroundCheck(int32 a_WheelIndex, const FVector& a_WheelLocation, const FVector& a_UpVector, float& o_DistanceToFloor) const;
+	//False when the heightfield cannot answer for this wheel and it has to be traced.
+	bool HeightfieldGroundCheck(const FVector& a_WheelLocation, const FVector& a_UpVector, float& o_DistanceToFloor, bool& o_Grounded) const;
+	//Reduced tier suspension: one probe under the middle of the wheels, every wheel measured against the plane it hits.
+	void SingleProbeGroundCheck(const FVector (&a_WheelLocations)[WheelCount], const FVector& a_UpVector);
+	void GetWheelTraceSegment(const FVector& a_WheelLocation, const FVector& a_UpVector, FVector& o_TraceStart, FVector& o_TraceEnd) const;
+
+	//Hands the car to a shared instanced proxy: hidden, without collision, physics or ticking, so its components never move.
+	void EnterProxyLOD();
+	//Tier changes carry the velocity between the physics body and the kinematic motion so cars do not pop.
+	void SetSimulationTier(EVehicleSimulationTier a_Tier);
+	//False for reduced cars between their updates, HoldVehicleUpdate stands in for those frames.
+	bool IsUpdateDue();
+	void HoldVehicleUpdate();
+	void UpdateKinematic(float a_DeltaTime);
+	//Ground height under a_Location for cars that run without wheel probes: the baked heightfield, or one trace when it cannot answer.
+	bool FindGroundHeight(const FVector& a_Location, float& o_Height) const;
+	//Height of the chassis origin above the ground under the wheels at their last probe, or at spring rest if none touched.
+	float GetRideHeight() const;
+	//Takes the car back at the proxy's pose and carries the proxy's velocity over to the physics body.
+	void ExitProxyLOD(const FTransform& a_ChassisTransform, const FVector& a_LinearVelocity, const FVector& a_AngularVelocity);
+
+	void RecordInputFrame();
+	void ApplyReplayFrame();
+	bool AcceptsHandlerInput() const { return !InputReplay.IsValid() || ApplyingReplayInput; }
+
+	//Server: publishes the snapshot. Owning client: sends input and blends out prediction error. Simulated proxies only interpolate.
+	void UpdateNetworking(float a_DeltaTime);
+	//Remote cars are drawn from snapshots without simulating, everything else simulates and is batched by the vehicle manager.
+	void ApplyNetRole();
+	void UpdateRemoteInterpolation();
+	//Snapshots per second the byte budget allows. Owning clients send their input at the same rate.
+	float GetNetSnapshotRate() const;
+	//The game state's estimate of the server's world time, the world time on the server itself.
+	double GetServerTime() const;
+	FCarNetSnapshot MakeSnapshot() const;
+	void ApplySnapshot(const FCarNetSnapshot& a_Snapshot);
+	void ReconcileWithServer(const FCarNetSnapshot& a_Snapshot);
+	void QueueSnapshotAck();
+	void SetFrontWheelSteer(float a_SteerAngle) const;
+	void SetDrifting(bool a_Drifting);
+
+	UFUNCTION()
+	void OnRep_ReplicatedState();
+	UFUNCTION(Server, Unreliable)
+	void ServerSendInput(const FCarNetInput& a_Input);
+	UFUNCTION(Server, Reliable)
+	void ServerResetCar();
 
-	bool IndividualWheelUpdate(UStaticMeshComponent* a_WheelToCheck, bool a_IsFrontWheel) const;
-	bool WheelGroundCheck(const UStaticMeshComponent* a_WheelToCheck, float& o_DistanceToFloor) const;
+	void PushPhysicsInput() const;
+	void SubmitAsyncTraces();
+	void OnAsyncTraceCompleted(const FTraceHandle& a_Handle, FTraceDatum& a_Datum);
 	
+	//O(1) per update: pushes each wheel's contact into its history and advances the contact state on accumulated time.
+	void UpdateContactState();
+	void SetContactState(ECarContactState a_State);
 	void EnableAirLogic();
-	void ResetFloorCheckToOriginal();
 	
-	FVector CalculateInAirRotation() const;
-	FVector CalculateSpringForce(const UStaticMeshComponent* a_Wheel, const float a_DistanceToFloor) const;
-	FVector CalculateWheelFrictionForce(const UStaticMeshComponent* a_Wheel, const UCurveFloat* a_FrictionCurve) const;
-	FVector CalculateAccelerationForce(UStaticMeshComponent* a_Wheel) const;
+	//Traces the ballistic arc from the chassis' current state in LandingPredictionSegments straight pieces.
+	void PredictLanding();
+	//Keeps the prediction while the car follows the arc, predicts again when it does not.
+	void RefineLandingPrediction();
+	FVector CalculateInAirRotation();
 	
 	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
 
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CarEffectsSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+class UNiagaraComponent;
+class UNiagaraSystem;
+
+//Effects shared by every car in the world.
+//Drift particles come from a pool of components created up front and lent to cars while they drift.
+//Skid marks are quads in an instanced mesh per material used as a ring buffer: the oldest mark is overwritten, nothing is allocated per mark.
+UCLASS()
+class MANIACCAB_API UCarEffectsSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//Makes sure there are a_Count more idle components for the system than were reserved before. Cars call this from BeginPlay.
+	void PrewarmDriftEffects(UNiagaraSystem* a_System, int32 a_Count);
+	//Attaches an idle component to a_Parent and activates it. Returns null if the system is not set.
+	UNiagaraComponent* AcquireDriftEffect(UNiagaraSystem* a_System, USceneComponent* a_Parent, const FVector& a_Offset);
+	//Deactivates the component, its particles play out before it is lent again.
+	void ReleaseDriftEffect(UNiagaraComponent* a_Effect);
+
+	//Makes sure there is a skid mark buffer for the material, null being the default TireSkid one. Cars call this once their
+	//material has loaded, the buffer is created as soon as the shared mesh has loaded too.
+	void PrewarmSkidMarks(UMaterialInterface* a_Material);
+	//Does nothing until the buffer for the material exists, a mark is never worth loading or allocating for mid drift.
+	void AddSkidSegment(const FVector& a_Start, const FVector& a_End, const FVector& a_Normal, float a_Width, UMaterialInterface* a_Material);
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 SkidMarkCapacity = 2048;
+
+	struct FDriftEffectPool
+	{
+		TArray<UNiagaraComponent*> Idle;
+		int32 Reserved = 0;
+		int32 Created = 0;
+	};
+
+	UNiagaraComponent* CreateDriftEffect(UNiagaraSystem* a_System);
+	void OnSkidMarkAssetsLoaded();
+	void CreateSkidMarks(UMaterialInterface* a_Material);
+
+	UPROPERTY()
+	TObjectPtr<AActor> EffectsOwner;
+	//Every component the pools have made, idle or lent, to keep them alive.
+	UPROPERTY()
+	TArray<TObjectPtr<UNiagaraComponent>> DriftEffects;
+	UPROPERTY()
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> SkidMarks;
+	UPROPERTY()
+	TObjectPtr<UStaticMesh> SkidMarkMesh;
+	UPROPERTY()
+	TObjectPtr<UMaterialInterface> DefaultSkidMarkMaterial;
+	//Materials asked for before the shared assets finished loading.
+	UPROPERTY()
+	TArray<TObjectPtr<UMaterialInterface>> PendingSkidMarkMaterials;
+
+	struct FSkidMarkBuffer
+	{
+		UInstancedStaticMeshComponent* Marks = nullptr;
+		int32 Next = 0;
+	};
+
+	TMap<TObjectKey<UNiagaraSystem>, FDriftEffectPool> DriftEffectPools;
+	//Keyed by the material the car asked for, null for the default.
+	TMap<TObjectKey<UMaterialInterface>, FSkidMarkBuffer> SkidMarkBuffers;
+	TSharedPtr<FStreamableHandle> SkidMarkAssetHandle;
+};
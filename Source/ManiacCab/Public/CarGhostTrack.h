@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+
+//Chassis pose plus the four wheels relative to it, in the order front left, front right, back left, back right.
+struct FCarGhostSample
+{
+	static constexpr int32 WheelCount = 4;
+
+	FVector3f ChassisLocation = FVector3f::ZeroVector;
+	FQuat4f ChassisRotation = FQuat4f::Identity;
+	FVector3f WheelLocations[WheelCount];
+	FQuat4f WheelRotations[WheelCount];
+};
+
+//Ghost track format, after a 12 byte header of magic, version and sample rate:
+//fixed size samples taken at the sample rate, so any sample can be found without scanning.
+//The chassis location is stored as int32 and wheel locations as int16, both in millimetres,
+//rotations as the three smallest quaternion components in 10 bits each plus the index of the dropped one.
+namespace CarGhostTrack
+{
+	constexpr uint32 Magic = 0x48474D43; //"MCGH"
+	constexpr uint32 Version = 1;
+	constexpr int32 HeaderSize = sizeof(uint32) * 2 + sizeof(float);
+	constexpr int32 SampleSize = sizeof(int32) * 3 + sizeof(uint32) + FCarGhostSample::WheelCount * (sizeof(int16) * 3 + sizeof(uint32));
+
+	void EncodeSample(const FCarGhostSample& a_Sample, uint8* o_Bytes);
+	void DecodeSample(const uint8* a_Bytes, FCarGhostSample& o_Sample);
+}
+
+//Streams samples to disk through a fixed size buffer.
+class MANIACCAB_API FCarGhostWriter
+{
+public:
+	~FCarGhostWriter();
+
+	bool Open(const FString& a_Path, float a_SampleRate);
+	void Close();
+	bool IsOpen() const { return FileHandle.IsValid(); }
+	float GetSampleRate() const { return SampleRate; }
+
+	void WriteSample(const FCarGhostSample& a_Sample);
+
+private:
+	static constexpr int32 BufferSize = 64 * 1024;
+
+	void Flush();
+
+	TUniquePtr<IFileHandle> FileHandle;
+	TArray<uint8> Buffer;
+	float SampleRate = 0;
+};
+
+//Reads samples in blocks. Not thread safe, but may be used from any one thread at a time.
+class MANIACCAB_API FCarGhostReader
+{
+public:
+	~FCarGhostReader();
+
+	bool Open(const FString& a_Path);
+	void Close();
+	bool IsOpen() const { return FileHandle.IsValid(); }
+	float GetSampleRate() const { return SampleRate; }
+	int64 GetNumSamples() const { return NumSamples; }
+
+	//Appends up to a_MaxSamples decoded samples, returns how many were read. Zero at the end of the track.
+	int32 ReadSamples(TArray<FCarGhostSample>& o_Samples, int32 a_MaxSamples);
+	void Seek(int64 a_Sample);
+	void Rewind() { Seek(0); }
+
+private:
+	TUniquePtr<IFileHandle> FileHandle;
+	TArray<uint8> ReadBuffer;
+	float SampleRate = 0;
+	int64 NumSamples = 0;
+	int64 NextSample = 0;
+};
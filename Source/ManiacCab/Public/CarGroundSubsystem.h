@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CarGroundSubsystem.generated.h"
+
+//Height and normal of the static ground, baked into tiles around the cars that ask for them so wheel probes can be
+//answered with a bilinear sample instead of a scene query. Tiles are baked a few thousand traces per frame on first use
+//and dropped when no car has sampled them for a while. Anything the bake cannot vouch for falls back to a trace:
+//cells under movable geometry or overhangs, cells near another car, and tiles not baked yet. Streaming a level in or out
+//only drops the tiles under its bounds.
+UCLASS()
+class MANIACCAB_API UCarGroundSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr float SampleSpacing = 100.0f;
+
+	//Height and normal of the ground under a_Location on a_Channel. False when the caller has to trace instead.
+	//Tiles are baked for the channel of the first car that asks, other channels always fall back. a_ProbeLength is how far
+	//the caller's trace reaches, ground further below the top surface than that is not an overhang to it.
+	bool SampleGround(const FVector& a_Location, float a_ProbeLength, ECollisionChannel a_Channel, const AActor* a_Querier, float& o_Height, FVector& o_Normal);
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 TileCells = 32;
+	//Tiles share their edge samples with the next tile so a bilinear sample never needs two tiles.
+	static constexpr int32 TileSamples = TileCells + 1;
+	//Cars are marked in cells this size, probes in a cell with another car in it trace.
+	static constexpr float OccupancyCellSize = 400.0f;
+
+	struct FGroundSample
+	{
+		float Height = 0;
+		FVector3f Normal = FVector3f::UpVector;
+		//No static ground was found, or there is geometry within probe reach under it. Probes touching this sample trace.
+		bool Unusable = true;
+	};
+
+	struct FGroundTile
+	{
+		FGroundSample Samples[TileSamples * TileSamples];
+		//Vertical range the bake traced, from the height of the car that asked for the tile.
+		float BakeTop = 0;
+		float BakeBottom = 0;
+		//Longest probe asked for before the bake started. Longer probes trace, they could reach ground the bake ignored.
+		float ProbeReach = 0;
+		int32 NextSample = 0;
+		double LastUsedTime = 0;
+		bool Baked = false;
+	};
+
+	struct FOccupant
+	{
+		const AActor* Actor = nullptr;
+		bool Shared = false;
+	};
+
+	void OnLevelsChanged(ULevel* a_Level, UWorld* a_World);
+	void ResetTiles();
+	void ResetTiles(const FBox& a_Bounds);
+	void UpdateOccupancy();
+	bool IsOccupiedByOther(const FVector& a_Location, const AActor* a_Querier) const;
+	//Returns the number of traces used, at most a_TraceBudget.
+	int32 BakeTile(const FIntPoint& a_TileKey, FGroundTile& a_Tile, int32 a_TraceBudget);
+
+	TMap<FIntPoint, TUniquePtr<FGroundTile>> Tiles;
+	TArray<FIntPoint> PendingTiles;
+	TMap<FIntPoint, FOccupant> Occupancy;
+	TEnumAsByte<ECollisionChannel> BakeChannel = ECC_MAX;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
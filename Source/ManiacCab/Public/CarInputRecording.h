@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+struct FCarKeyframe
+{
+	FVector3f Location = FVector3f::ZeroVector;
+	FQuat4f Rotation = FQuat4f::Identity;
+	FVector3f LinearVelocity = FVector3f::ZeroVector;
+	FVector3f AngularVelocity = FVector3f::ZeroVector;
+};
+
+//Everything needed to reproduce one tick of car input.
+struct FCarInputFrame
+{
+	float Steering = 0;
+	float Throttle = 0;
+	float DeltaTime = 0;
+	bool Drifting = false;
+	bool Reset = false;
+	bool HasKeyframe = false;
+	FCarKeyframe Keyframe;
+};
+
+//Recording format, after a 8 byte header of magic and version:
+//one flag byte per tick, followed only by the fields that changed since the previous tick.
+//Steering and throttle are stored as int8, delta time as uint16 in 10 microsecond units, keyframes as raw floats.
+namespace CarInputRecording
+{
+	constexpr uint32 Magic = 0x50524D43; //"MCRP"
+	constexpr uint32 Version = 1;
+
+	enum EFrameFlags : uint8
+	{
+		SteeringChanged = 1 << 0,
+		ThrottleChanged = 1 << 1,
+		DeltaTimeChanged = 1 << 2,
+		Drifting = 1 << 3,
+		Reset = 1 << 4,
+		HasKeyframe = 1 << 5,
+	};
+}
+
+//Streams frames to disk through a fixed size buffer, nothing is allocated after Open.
+class MANIACCAB_API FCarInputRecorder
+{
+public:
+	~FCarInputRecorder();
+
+	bool Open(const FString& a_Path);
+	void Close();
+	bool IsOpen() const { return FileHandle.IsValid(); }
+
+	void RecordFrame(const FCarInputFrame& a_Frame);
+
+private:
+	static constexpr int32 BufferSize = 64 * 1024;
+
+	template <typename T>
+	void Write(const T& a_Value);
+	void Flush();
+
+	TUniquePtr<IFileHandle> FileHandle;
+	TArray<uint8> Buffer;
+	int8 LastSteering = 0;
+	int8 LastThrottle = 0;
+	uint16 LastDeltaTime = 0;
+};
+
+//Reads a recording through a memory mapped view, so long sessions can be scanned without copying them.
+class MANIACCAB_API FCarReplayReader
+{
+public:
+	~FCarReplayReader();
+
+	bool Open(const FString& a_Path);
+	void Close();
+	bool IsOpen() const { return MappedRegion.IsValid(); }
+
+	//Decodes the next frame, false at the end of the recording.
+	bool ReadFrame(FCarInputFrame& o_Frame);
+	void Rewind();
+
+private:
+	template <typename T>
+	bool Read(T& o_Value);
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	int64 Offset = 0;
+	int8 LastSteering = 0;
+	int8 LastThrottle = 0;
+	uint16 LastDeltaTime = 0;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "CarNetSnapshot.generated.h"
+
+class ACarController;
+class UNetConnection;
+struct FCarNetBaselines;
+
+//Authoritative car state sent from the server. Quantized in NetSerialize:
+//location to 0.1cm, rotation to 16 bits per axis, velocities to 1 unit per second with a single bit when at rest,
+//steering to half a degree, server time to a millisecond. Location and velocities are written as differences from the
+//newest snapshot the receiving connection has acknowledged, when the server still holds it.
+USTRUCT()
+struct MANIACCAB_API FCarNetSnapshot
+{
+	GENERATED_BODY()
+
+	//Rough serialized size of a full snapshot including the property header, used to turn a bytes per second budget into
+	//an update rate. Snapshots written against a baseline are smaller.
+	static constexpr float EstimatedBytes = 47.0f;
+
+	//Counts the snapshots the server has taken, never 0. Receivers acknowledge them so later ones can be written against them.
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	UPROPERTY()
+	FVector Location = FVector::ZeroVector;
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+	UPROPERTY()
+	FVector LinearVelocity = FVector::ZeroVector;
+	//Degrees per second.
+	UPROPERTY()
+	FVector AngularVelocity = FVector::ZeroVector;
+	UPROPERTY()
+	float SteerAngle = 0;
+	UPROPERTY()
+	bool Drifting = false;
+	//Last client input the server applied before taking this snapshot, used by the owning client to reconcile.
+	UPROPERTY()
+	uint16 LastProcessedInput = 0;
+	//Server world time the snapshot was taken at. Remote cars are interpolated on it, so network jitter does not
+	//stretch or squash the motion between snapshots the way interpolating on arrival times did.
+	UPROPERTY()
+	double ServerTime = 0;
+
+	//Server: the sent snapshots and acknowledgements NetSerialize picks each connection's baseline from. Not replicated.
+	const FCarNetBaselines* Baselines = nullptr;
+	//Client: set by NetSerialize when Location and the velocities hold differences from snapshot BaselineSequence.
+	bool IsDelta = false;
+	uint16 BaselineSequence = 0;
+
+	//Rounds to what NetSerialize sends, so the server's baselines match what the clients decoded bit for bit.
+	void Quantize();
+	//Turns a delta into a full snapshot. False when a_Baseline is not the snapshot it was written against.
+	bool ResolveDelta(const FCarNetSnapshot* a_Baseline);
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCarNetSnapshot> : public TStructOpsTypeTraitsBase2<FCarNetSnapshot>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+//The most recent snapshots by sequence: the ones the server sent, or the ones a client decoded.
+struct MANIACCAB_API FCarNetSnapshotHistory
+{
+	//Also the furthest back a baseline can be, NetSerialize writes the distance in five bits.
+	static constexpr int32 Size = 32;
+
+	void Add(const FCarNetSnapshot& a_Snapshot) { Snapshots[a_Snapshot.Sequence % Size] = a_Snapshot; }
+	const FCarNetSnapshot* Find(uint16 a_Sequence) const;
+
+private:
+	FCarNetSnapshot Snapshots[Size];
+};
+
+//Server side of the delta compression for one car: what was sent and which of it each connection has acknowledged.
+struct MANIACCAB_API FCarNetBaselines
+{
+	FCarNetSnapshotHistory Sent;
+	TMap<TObjectKey<UNetConnection>, uint16> Acknowledged;
+
+	void Acknowledge(const UNetConnection* a_Connection, uint16 a_Sequence);
+	//The snapshot a_Connection acknowledged last, if it is still held and older than a_Sequence.
+	const FCarNetSnapshot* FindBaseline(const UNetConnection* a_Connection, uint16 a_Sequence) const;
+};
+
+//A client telling the server it decoded a car's snapshot. Sent through the client's UCarSnapshotAckComponent.
+USTRUCT()
+struct MANIACCAB_API FCarSnapshotAck
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<ACarController> Car;
+	UPROPERTY()
+	uint16 Sequence = 0;
+};
+
+//Owning client input, sent unreliably at the snapshot rate.
+USTRUCT()
+struct MANIACCAB_API FCarNetInput
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 Sequence = 0;
+	UPROPERTY()
+	int8 Steering = 0;
+	UPROPERTY()
+	int8 Throttle = 0;
+	UPROPERTY()
+	bool Drifting = false;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCarNetInput> : public TStructOpsTypeTraitsBase2<FCarNetInput>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
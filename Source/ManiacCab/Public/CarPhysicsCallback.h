@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "VehicleDynamics.h"
+
+class FSingleParticlePhysicsProxy;
+
+struct FCarPhysicsWheelInput
+{
+	//Wheel pose relative to the chassis body, without scale.
+	FVector LocalPosition = FVector::ZeroVector;
+	FQuat LocalRotation = FQuat::Identity;
+	//Result of the latest game thread probe. The distance is signed and only meaningful when grounded.
+	float DistanceToFloor = 0.0f;
+	bool Grounded = false;
+};
+
+//Everything the physics thread needs for one car, written by the game thread once per frame and
+//handed over through the solver's sim callback input queue.
+struct FCarPhysicsInput : public Chaos::FSimCallbackInput
+{
+	FSingleParticlePhysicsProxy* ChassisProxy = nullptr;
+	FCarPhysicsWheelInput Wheels[4];
+	FVector InputAxis = FVector::ZeroVector;
+	//Tuning and throttle. Delta time, up vector, chassis velocity and the curve pointers are filled in on the physics thread.
+	FVehicleDynamicsParams Params;
+	//Copies of each wheel's curve tables. The shared tables are re-baked in place on the game thread when a curve is edited,
+	//so the physics thread only ever reads these. A wheel without a curve gets an all zero table.
+	FBakedCurve FrictionCurves[4];
+	FBakedCurve TorqueCurves[4];
+
+	void Reset()
+	{
+		ChassisProxy = nullptr;
+	}
+};
+
+//Runs the wheel force model every physics step so handling no longer depends on the render frame rate.
+class FCarPhysicsCallback : public Chaos::TSimCallbackObject<FCarPhysicsInput>
+{
+public:
+	FCarPhysicsCallback()
+	{
+		Batch.SetNumVehicles(1);
+	}
+
+	//The game thread path scaled forces by DeltaTime * 100 at 60fps, the tuning is kept against that frame time.
+	static constexpr float ReferenceFrameTime = 1.0f / 60.0f;
+	//Wheel forces times this are what AddForce gets each step. AddForce integrates over the step, so a force independent of
+	//the step rate gives the same push per second at any rate.
+	static constexpr float ForceScale = ReferenceFrameTime * 100;
+
+	//Solves the batch for one physics step. The friction term cancels lateral velocity within DeltaTime and so scales with
+	//1 / DeltaTime. It is handed the reference frame time, not the step, or each step would take the same share of the
+	//lateral velocity and grip per second would double from 120Hz to 240Hz.
+	static void SolveStep(FVehicleDynamicsBatch& a_Batch);
+
+private:
+	virtual void OnPreSimulate_Internal() override;
+
+	//Physics thread only.
+	FVehicleDynamicsBatch Batch;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CarNetSnapshot.h"
+#include "CarSnapshotAckComponent.generated.h"
+
+class ACarController;
+class AGameModeBase;
+class APlayerController;
+
+//Carries a client's snapshot acknowledgements to the server. Clients can only call the server on actors their connection
+//owns, and the player controller is the one every client has, whether it drives a car, spectates or has no pawn at all.
+//Acks are batched and sent at the fastest snapshot rate among the cars they are for.
+UCLASS()
+class MANIACCAB_API UCarSnapshotAckComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCarSnapshotAckComponent();
+
+	//Client: a_Car's snapshot a_Sequence was decoded. Only the newest per car is sent.
+	void QueueAck(ACarController* a_Car, uint16 a_Sequence, float a_SnapshotRate);
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	UFUNCTION(Server, Unreliable)
+	void ServerAckSnapshots(const TArray<FCarSnapshotAck>& a_Acks);
+
+	TMap<TWeakObjectPtr<ACarController>, uint16> PendingAcks;
+	float AckRate = 0;
+	float AckSendTimer = 0;
+};
+
+//Server: gives every player controller a UCarSnapshotAckComponent as it logs in, since the game mode is a blueprint.
+UCLASS()
+class MANIACCAB_API UCarSnapshotAckSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnPostLogin(AGameModeBase* a_GameMode, APlayerController* a_Player);
+	static void AddAckComponent(APlayerController* a_Player);
+
+	FDelegateHandle PostLoginHandle;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
+#include "CarStreamingSubsystem.generated.h"
+
+class ACarController;
+class ULevelStreaming;
+
+//Streams the world in ahead of locally controlled cars, along the path ACarController::GetPredictedPath expects them to take.
+//In world partition maps every path point is a streaming source, nearer points at a higher priority, so cells on the way load
+//before the car gets there and cells it has left behind are free to unload. In classic maps the streaming levels of the
+//streaming volumes on the path are moved up the load queue, the volumes themselves still decide what loads.
+//Counts a stall for every frame a car is somewhere that is not loaded yet.
+UCLASS()
+class MANIACCAB_API UCarStreamingSubsystem : public UTickableWorldSubsystem, public IWorldPartitionStreamingSourceProvider
+{
+	GENERATED_BODY()
+
+public:
+	int32 GetStallFrames() const { return StallFrames; }
+	//Seconds of predicted path that are loaded, counted from the car, for the worst off car.
+	float GetLoadedLookAhead() const { return LoadedLookAhead; }
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override;
+	virtual UObject* GetStreamingSourceOwner() override { return this; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	bool IsLoadedAt(const FVector& a_Location) const;
+	static bool IsInStreamingVolume(const ULevelStreaming* a_Level, const FVector& a_Location);
+	//Adds the levels of the volumes the path runs through, ranked so the ones reached first load first.
+	void GatherPathLevels(TConstArrayView<FVector> a_Path, TMap<ULevelStreaming*, int32>& o_Ranks) const;
+	//Raises the priority of the ranked levels and gives the others back the priority they had.
+	void ApplyLevelPriorities(const TMap<ULevelStreaming*, int32>& a_Ranks);
+
+	TArray<FWorldPartitionStreamingSource> Sources;
+	TArray<FVector> PathPoints;
+	bool RegisteredProvider = false;
+
+	//Levels whose priority was raised, with the priority they had before.
+	TMap<TWeakObjectPtr<ULevelStreaming>, int32> RaisedLevels;
+
+	int32 StallFrames = 0;
+	bool Stalled = false;
+	float LoadedLookAhead = 0;
+};
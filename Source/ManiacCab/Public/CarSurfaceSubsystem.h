@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CarSurfaceSubsystem.generated.h"
+
+class ALandscapeProxy;
+class ULandscapeHeightfieldCollisionComponent;
+class UPhysicalMaterial;
+
+//What a wheel is driving on. Each type has its own friction and torque curves on the car.
+UENUM(BlueprintType)
+enum class ECarSurfaceType : uint8
+{
+	Road,
+	Grass,
+	Dirt,
+};
+
+//Surface types of the landscapes in the world, rasterised into a grid of cells so wheels can look up what they drive on
+//by position without a trace. Landscape components are rasterised a few at a time as they stream in, by tracing down
+//the middle of every cell: road meshes on top are Road, landscape hits are classified by the physical material of the
+//painted layer, matched to the Grass and Dirt layer infos by name. Anything not rasterised yet, or off the landscapes, is Road.
+UCLASS()
+class MANIACCAB_API UCarSurfaceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr int32 SurfaceTypeCount = 3;
+	static constexpr float CellSize = 200.0f;
+
+	//O(1): one hash lookup for the tile and an index into it.
+	ECarSurfaceType GetSurfaceAt(const FVector& a_Location) const;
+	bool IsRasterising() const { return PendingComponents.Num() > 0; }
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 TileShift = 5;
+	static constexpr int32 TileCells = 1 << TileShift;
+	//Cells that have not been rasterised read as Road.
+	static constexpr uint8 UnknownSurface = 0xFF;
+
+	struct FSurfaceTile
+	{
+		uint8 Cells[TileCells * TileCells];
+	};
+
+	//A landscape component being rasterised, NextCell walks its cells row by row across ticks.
+	struct FPendingComponent
+	{
+		TWeakObjectPtr<ULandscapeHeightfieldCollisionComponent> Component;
+		FIntPoint MinCell;
+		FIntPoint MaxCell;
+		int32 NextCell = 0;
+	};
+
+	void OnLevelAdded(ULevel* a_Level, UWorld* a_World);
+	void QueueLandscape(ALandscapeProxy* a_Landscape);
+	//Returns the number of traces used, at most a_TraceBudget.
+	int32 RasteriseComponent(FPendingComponent& a_Pending, int32 a_TraceBudget);
+	ECarSurfaceType ClassifyHit(const FHitResult& a_Hit) const;
+	void SetCell(const FIntPoint& a_Cell, ECarSurfaceType a_Surface);
+
+	TMap<FIntPoint, TUniquePtr<FSurfaceTile>> Tiles;
+	TArray<FPendingComponent> PendingComponents;
+	//Physical materials of the landscape layers that are not Road.
+	TMap<TObjectKey<UPhysicalMaterial>, ECarSurfaceType> LayerSurfaces;
+	FDelegateHandle LevelAddedHandle;
+};
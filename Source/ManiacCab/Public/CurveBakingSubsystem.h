@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BakedCurve.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CurveBakingSubsystem.generated.h"
+
+class UCurveBase;
+class UCurveFloat;
+
+//Bakes each UCurveFloat once into an FBakedCurve shared by every car that references it.
+//In the editor the table is re-baked in place whenever the curve asset is edited.
+UCLASS()
+class MANIACCAB_API UCurveBakingSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//Baked over [0, 1], the range of every wheel curve input. Returns null for a null curve.
+	//The pointer stays valid for the lifetime of the engine.
+	const FBakedCurve* GetBakedCurve(const UCurveFloat* a_Curve);
+
+private:
+	void BakeCurve(const UCurveFloat* a_Curve, FBakedCurve& o_BakedCurve) const;
+
+#if WITH_EDITOR
+	void OnCurveUpdated(UCurveBase* a_Curve, EPropertyChangeType::Type a_ChangeType);
+#endif
+
+	TMap<TObjectKey<UCurveFloat>, TUniquePtr<FBakedCurve>> BakedCurves;
+};
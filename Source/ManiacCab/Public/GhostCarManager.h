@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include "CarGhostTrack.h"
+#include "GhostCarManager.generated.h"
+
+class ACarController;
+class UInstancedStaticMeshComponent;
+
+//Plays back recorded ghost tracks without spawning cars. Tracks are decoded in blocks on worker tasks,
+//and every ghost is one instance in the five instanced mesh components, one per car part.
+UCLASS()
+class MANIACCAB_API AGhostCarManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGhostCarManager();
+
+	//Chassis first, then the wheels in the order front left, front right, back left, back right.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UStaticMesh* BodyMesh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UStaticMesh* FrontLeftWheelMesh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UStaticMesh* FrontRightWheelMesh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UStaticMesh* BackLeftWheelMesh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UStaticMesh* BackRightWheelMesh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Ghost Meshes")
+	UMaterialInterface* GhostMaterial;
+
+	UPROPERTY(EditAnywhere, Category="Ghost Recording")
+	float RecordingSampleRate = 30.0f;
+
+	UFUNCTION(BlueprintCallable, Category="Ghosts")
+	void CopyMeshesFromCar(const ACarController* a_Car);
+
+	//Returns the ghost id, or INDEX_NONE if the track could not be opened.
+	UFUNCTION(BlueprintCallable, Category="Ghosts")
+	int32 AddGhost(const FString& a_Path, bool a_Loop = false, float a_StartTime = 0.0f);
+	UFUNCTION(BlueprintCallable, Category="Ghosts")
+	void RemoveGhost(int32 a_GhostId);
+	UFUNCTION(BlueprintCallable, Category="Ghosts")
+	void RemoveAllGhosts();
+	UFUNCTION(BlueprintPure, Category="Ghosts")
+	int32 GetNumActiveGhosts() const;
+
+	//Samples the car at RecordingSampleRate into a ghost track until stopped or the car is destroyed.
+	UFUNCTION(BlueprintCallable, Category="Ghost Recording")
+	bool StartRecordingGhost(ACarController* a_Car, const FString& a_Path);
+	UFUNCTION(BlueprintCallable, Category="Ghost Recording")
+	void StopRecordingGhost(ACarController* a_Car);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaTime) override;
+
+private:
+	static constexpr int32 PartCount = 1 + FCarGhostSample::WheelCount;
+	//Samples decoded per worker task, and how far ahead of playback decoding starts.
+	static constexpr int32 DecodeBlockSize = 128;
+
+	//The reader and Staging belong to the decode task while it runs, everything else is game thread only.
+	struct FGhostPlayback
+	{
+		FCarGhostReader Reader;
+		TArray<FCarGhostSample> Samples;
+		TArray<FCarGhostSample> Staging;
+		UE::Tasks::FTask DecodeTask;
+		int64 FirstSampleIndex = 0;
+		double PlaybackTime = 0;
+		bool Loop = false;
+		bool ReachedEnd = false;
+		bool DecodedToEnd = false;
+		bool Active = false;
+	};
+
+	struct FGhostRecording
+	{
+		TWeakObjectPtr<ACarController> Car;
+		TUniquePtr<FCarGhostWriter> Writer;
+		double TimeSinceSample = 0;
+	};
+
+	void UpdateDecoding(FGhostPlayback& a_Ghost);
+	bool SampleGhost(FGhostPlayback& a_Ghost, FTransform (&o_PartTransforms)[PartCount]) const;
+	void UpdateRecordings(float a_DeltaTime);
+	static FCarGhostSample CaptureSample(const ACarController* a_Car);
+	void ApplyMeshes();
+
+	UPROPERTY()
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> PartInstances;
+
+	TArray<TUniquePtr<FGhostPlayback>> Ghosts;
+	TArray<FGhostRecording> Recordings;
+	TArray<FTransform> PartTransforms[PartCount];
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Tasks/Task.h"
+#include <atomic>
+
+//A route over the road network: the graph edges driven and the sampled road to follow.
+struct FRoadRoute
+{
+	TArray<int32> Edges;
+	//Points along the roads, about FRoadGraphBuilder::SampleSpacing apart, from the first node to the last.
+	TArray<FVector3f> Points;
+	float Length = 0;
+	bool IsValid() const { return Points.Num() > 0; }
+};
+
+//Directed road graph in compressed sparse row layout, with every edge's road sampled once at build time.
+//Nodes are grouped into square regions for FRoadRouter. Immutable once built, so any number of threads may read it.
+class MANIACCAB_API FRoadGraph
+{
+public:
+	int32 GetNumNodes() const { return NodePositions.Num(); }
+	int32 GetNumEdges() const { return EdgeTargets.Num(); }
+	int32 GetNumRegions() const { return NumRegions; }
+	const FVector3f& GetNodePosition(int32 a_Node) const { return NodePositions[a_Node]; }
+	int32 GetNodeRegion(int32 a_Node) const { return NodeRegions[a_Node]; }
+	//INDEX_NONE if there is no node within LookupCellSize of a_Location.
+	int32 FindNearestNode(const FVector3f& a_Location) const;
+	TArrayView<const FVector3f> GetEdgeSamples(int32 a_Edge) const { return MakeArrayView(Samples.GetData() + SampleStarts[a_Edge], SampleStarts[a_Edge + 1] - SampleStarts[a_Edge]); }
+
+private:
+	friend class FRoadGraphBuilder;
+	friend class FRoadRouter;
+
+	static constexpr float LookupCellSize = 5000.0f;
+
+	TArray<FVector3f> NodePositions;
+	TArray<int32> NodeRegions;
+	int32 NumRegions = 0;
+
+	//Out edges of node n are [EdgeStarts[n], EdgeStarts[n + 1]).
+	TArray<int32> EdgeStarts;
+	TArray<int32> EdgeSources;
+	TArray<int32> EdgeTargets;
+	TArray<float> EdgeCosts;
+	//In edges of node n are ReverseEdges[ReverseEdgeStarts[n]..ReverseEdgeStarts[n + 1]), as forward edge indices.
+	TArray<int32> ReverseEdgeStarts;
+	TArray<int32> ReverseEdges;
+
+	//Samples of edge e are [SampleStarts[e], SampleStarts[e + 1]), both end nodes included.
+	TArray<int32> SampleStarts;
+	TArray<FVector3f> Samples;
+
+	TMap<FIntPoint, TArray<int32>> LookupCells;
+};
+
+//Collects roads as polylines and joins them where their ends meet. Roads only connect at their ends,
+//so splines and road meshes have to be split at junctions.
+class MANIACCAB_API FRoadGraphBuilder
+{
+public:
+	static constexpr float SampleSpacing = 500.0f;
+
+	//Road ends closer than a_SnapDistance share a node. Regions are a_RegionSize squares.
+	explicit FRoadGraphBuilder(float a_SnapDistance = 300.0f, float a_RegionSize = 50000.0f);
+
+	void AddRoad(TArrayView<const FVector3f> a_Points, bool a_OneWay);
+	int32 GetNumRoads() const { return Roads.Num(); }
+	FRoadGraph Build() const;
+
+private:
+	struct FRoad
+	{
+		int32 From = 0;
+		int32 To = 0;
+		TArray<FVector3f> Samples;
+		float Length = 0;
+		bool OneWay = false;
+	};
+
+	int32 FindOrAddNode(const FVector3f& a_Location);
+
+	float SnapDistance;
+	float RegionSize;
+	TArray<FVector3f> Nodes;
+	TMap<FIntPoint, TArray<int32>> NodeCells;
+	TArray<FRoad> Roads;
+};
+
+//Shortest routes over an FRoadGraph, split into a search inside the start and end regions and a search over a
+//precomputed graph of region boundary nodes. The boundary graph searches are cached per origin region, so
+//routes out of a busy region mostly cost the two local searches. All queries are thread safe.
+//Create with MakeShared, async queries keep the router alive until they finish.
+class MANIACCAB_API FRoadRouter : public TSharedFromThis<FRoadRouter>
+{
+public:
+	explicit FRoadRouter(TSharedRef<const FRoadGraph> a_Graph, int32 a_CacheCapacity = 64);
+
+	const FRoadGraph& GetGraph() const { return *Graph; }
+	FRoadRoute FindRoute(const FVector3f& a_From, const FVector3f& a_To) const;
+	FRoadRoute FindRoute(int32 a_FromNode, int32 a_ToNode) const;
+	//Runs FindRoute on a worker thread.
+	UE::Tasks::TTask<FRoadRoute> FindRouteAsync(const FVector3f& a_From, const FVector3f& a_To) const;
+	//Plain A* over the whole graph. The reference the hierarchical routes are checked against.
+	FRoadRoute FindRouteFlat(int32 a_FromNode, int32 a_ToNode) const;
+
+	int32 GetNumBoundaryNodes() const { return BoundaryNodes.Num(); }
+	uint64 GetCacheHits() const { return CacheHits.load(); }
+	uint64 GetCacheMisses() const { return CacheMisses.load(); }
+
+private:
+	//Between boundary nodes: a shortest path inside one region, or a single graph edge between regions.
+	struct FBoundaryEdge
+	{
+		int32 Source = 0;
+		int32 Target = 0;
+		float Cost = 0;
+		//Graph edges this stands for, in ShortcutEdges.
+		int32 PathStart = 0;
+		int32 PathCount = 0;
+	};
+
+	//Boundary graph shortest path trees from every boundary node of one region, row per source.
+	struct FRegionTrees
+	{
+		TArray<float> Distances;
+		TArray<int32> ParentEdges;
+	};
+
+	//Distances and parent graph edges of a search that never leaves the source node's region.
+	struct FRegionSearch
+	{
+		TMap<int32, float> Distances;
+		TMap<int32, int32> ParentEdges;
+	};
+
+	//Forward searches follow edges out of nodes, reverse searches follow them in and give distances to a_Source.
+	void SearchRegion(int32 a_Source, bool a_Reverse, FRegionSearch& o_Search) const;
+	//Graph edges between the search's source and a_Node, in driving order.
+	void TracePath(const FRegionSearch& a_Search, int32 a_Node, bool a_Reverse, TArray<int32>& o_Edges) const;
+	TSharedPtr<const FRegionTrees> GetRegionTrees(int32 a_Region) const;
+	TSharedPtr<const FRegionTrees> BuildRegionTrees(int32 a_Region) const;
+	TArrayView<const int32> GetRegionBoundary(int32 a_Region) const { return MakeArrayView(RegionBoundary.GetData() + RegionBoundaryStarts[a_Region], RegionBoundaryStarts[a_Region + 1] - RegionBoundaryStarts[a_Region]); }
+	void AppendEdges(TArrayView<const int32> a_Edges, FRoadRoute& o_Route) const;
+
+	TSharedRef<const FRoadGraph> Graph;
+	int32 CacheCapacity;
+
+	TArray<int32> BoundaryNodes;
+	//Boundary index of each graph node, INDEX_NONE for nodes inside a region.
+	TArray<int32> BoundaryIndices;
+	TArray<int32> BoundaryEdgeStarts;
+	TArray<FBoundaryEdge> BoundaryEdges;
+	TArray<int32> ShortcutEdges;
+	TArray<int32> RegionBoundaryStarts;
+	TArray<int32> RegionBoundary;
+
+	mutable FRWLock CacheLock;
+	mutable TMap<int32, TSharedPtr<const FRegionTrees>> Cache;
+	mutable TArray<int32> CacheOrder;
+	mutable std::atomic<uint64> CacheHits{0};
+	mutable std::atomic<uint64> CacheMisses{0};
+};
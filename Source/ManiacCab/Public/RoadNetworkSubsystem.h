@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RoadGraph.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoadNetworkSubsystem.generated.h"
+
+class AActor;
+
+//The road network fares and AI cabs are routed over, built from the roads in the world on begin play and again when
+//levels stream in or out. Roads are spline components on actors tagged Road, or failing that their static meshes
+//taken as a straight road along the mesh's long side, as are all placed Road meshes. Actors also tagged OneWay are
+//driven in spline or mesh X direction only. The roads are gathered on the game thread, the graph and router are built
+//on a worker and swapped in on a later tick. Routes are found on worker threads by FRoadRouter.
+UCLASS()
+class MANIACCAB_API URoadNetworkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static const FName RoadTag;
+	static const FName OneWayTag;
+
+	//Null until the first build after begin play has finished or when the world has no roads. Hold on to it for as long as its routes are used.
+	TSharedPtr<const FRoadRouter> GetRouter() const { return Router; }
+	//Between the road nodes nearest a_From and a_To, an invalid route if either has none nearby or there is no route.
+	UE::Tasks::TTask<FRoadRoute> FindRouteAsync(const FVector& a_From, const FVector& a_To) const;
+	//Blocks on the route, for Blueprints. Empty when there is no route.
+	UFUNCTION(BlueprintCallable, Category="Road Network")
+	TArray<FVector> FindRoutePoints(const FVector& a_From, const FVector& a_To) const;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnLevelsChanged(ULevel* a_Level, UWorld* a_World);
+	//Gathers the roads and launches the build. Only one build runs at a time, changes during it are picked up after it.
+	void StartBuild();
+	static void AddActorRoads(const AActor* a_Actor, FRoadGraphBuilder& a_Builder);
+
+	TSharedPtr<const FRoadRouter> Router;
+	UE::Tasks::TTask<TSharedPtr<const FRoadRouter>> PendingBuild;
+	bool NetworkDirty = false;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RouteBenchmarkCommandlet.generated.h"
+
+class FRoadRouter;
+
+//Builds a generated city grid road network without a world, answers random route queries on all worker threads and
+//appends the query latency to a CSV. The first -Validate routes are checked against a plain A* over the whole graph.
+//
+//UnrealEditor-Cmd ManiacCab.uproject -run=RouteBenchmark -nullrhi -unattended
+//	-Grid=100 -Spacing=5000 -RegionSize=50000 -OneWay=0.2 -Closed=0.1 -Queries=20000 -Validate=200 -Seed=1234
+//	-Output=Saved/Benchmarks/RouteBenchmark.csv
+UCLASS()
+class MANIACCAB_API URouteBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URouteBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FBenchmarkSettings
+	{
+		int32 GridSize = 100;
+		float Spacing = 5000.0f;
+		float RegionSize = 50000.0f;
+		float OneWayFraction = 0.2f;
+		float ClosedFraction = 0.1f;
+		int32 Queries = 20000;
+		int32 ValidatedQueries = 200;
+		int32 Seed = 1234;
+		FString OutputPath;
+	};
+
+	struct FBenchmarkResult
+	{
+		int32 Nodes = 0;
+		int32 Edges = 0;
+		int32 Regions = 0;
+		int32 BoundaryNodes = 0;
+		double BuildMs = 0;
+		int32 Queries = 0;
+		int32 Routed = 0;
+		double MeanQueryUs = 0;
+		double P50QueryUs = 0;
+		double P99QueryUs = 0;
+		double QueriesPerSecond = 0;
+		double CacheHitRate = 0;
+		int32 Mismatches = 0;
+	};
+
+	static TSharedRef<FRoadRouter> BuildGridNetwork(const FBenchmarkSettings& a_Settings);
+	static void RunQueries(const FBenchmarkSettings& a_Settings, const FRoadRouter& a_Router, FBenchmarkResult& o_Result);
+	static int32 ValidateRoutes(const FBenchmarkSettings& a_Settings, const FRoadRouter& a_Router);
+	static void WriteResult(const FString& a_Path, const FBenchmarkResult& a_Result);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VehicleBenchmarkCommandlet.generated.h"
+
+class ACarController;
+
+//Spawns cars on generated terrain in an empty world, drives them with scripted input and appends the cost to a CSV.
+//
+//UnrealEditor-Cmd ManiacCab.uproject -run=VehicleBenchmark -nullrhi -unattended
+//	-Vehicles=32 -Terrain=Flat|Bumpy|Ramp|All -Frames=600 -Warmup=60 -DeltaTime=0.016667
+//	-VehicleClass=/Game/I01_Core/Blueprints/Car/BP_Car.BP_Car_C -Output=Saved/Benchmarks/VehicleBenchmark.csv
+UCLASS()
+class MANIACCAB_API UVehicleBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVehicleBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FBenchmarkSettings
+	{
+		int32 Vehicles = 32;
+		int32 Frames = 600;
+		int32 WarmupFrames = 60;
+		float DeltaTime = 1.0f / 60.0f;
+		FString VehicleClass = TEXT("/Game/I01_Core/Blueprints/Car/BP_Car.BP_Car_C");
+		FString OutputPath;
+	};
+
+	struct FBenchmarkResult
+	{
+		FString Terrain;
+		int32 Vehicles = 0;
+		int32 Frames = 0;
+		//The whole world tick, physics and every other actor included.
+		double MeanFrameMs = 0;
+		double P99FrameMs = 0;
+		//Only the car ticks and the vehicle manager.
+		double MeanVehicleMs = 0;
+		double P99VehicleMs = 0;
+		//Solver steps per frame, wherever they ran, car physics callbacks included.
+		double MeanPhysicsMs = 0;
+		double SceneQueriesPerFrame = 0;
+		double MemoryKBPerVehicle = 0;
+	};
+
+	bool RunBenchmark(const FBenchmarkSettings& a_Settings, const FString& a_Terrain, FBenchmarkResult& o_Result) const;
+	static void SpawnTerrain(UWorld* a_World, const FString& a_Terrain);
+	static void DriveVehicles(const TArray<ACarController*>& a_Vehicles, float a_Time);
+	static void WriteResult(const FString& a_Path, const FBenchmarkResult& a_Result);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleBudgetSubsystem.generated.h"
+
+//How much of its usual work a car that is not the player's does at the current budget level.
+struct FVehicleBudget
+{
+	//Multiplies the full and reduced simulation tier distances.
+	float TierDistanceScale = 1;
+	//Multiplies LandingPredictionSegments, the traces along the jump arc.
+	float AirProbeScale = 1;
+	//1 is both drift particle effects and every skid mark. Lower spaces skid marks further apart, below a half there is one
+	//particle effect instead of two, at 0 there are no drift effects.
+	float DriftEffectsDensity = 1;
+	bool DebugDraws = true;
+};
+
+//Watches the game thread frame time against ManiacCab.VehicleBudgetTargetMs and trades away fidelity of the cars that are not
+//the player's when it stays over: shorter simulation tier distances, fewer air probes, sparser drift effects and no debug draws.
+//Steps up one level at a time while over budget and back down once there is headroom again. The player's car is never touched.
+UCLASS()
+class MANIACCAB_API UVehicleBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	int32 GetBudgetLevel() const { return BudgetLevel; }
+	const FVehicleBudget& GetBudget() const { return Budget; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void SetBudgetLevel(int32 a_Level);
+
+	int32 BudgetLevel = 0;
+	FVehicleBudget Budget;
+	float AverageGameThreadMs = 0;
+	//How long the average has been over budget, or under the recovery threshold.
+	float OverBudgetTime = 0;
+	float UnderBudgetTime = 0;
+};
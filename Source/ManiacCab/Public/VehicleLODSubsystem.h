@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleLODSubsystem.generated.h"
+
+class ACarController;
+class UHierarchicalInstancedStaticMeshComponent;
+
+//Swaps cars far from the camera to render proxies: one hierarchical instanced mesh per distinct mesh, shared by all proxied cars.
+//A proxied car is hidden and frozen, the proxy dead reckons from the car's velocity at handoff and the car is
+//teleported to the proxy's pose, put back on the ground, with that velocity when it comes back. Player cars and networked games are left alone.
+UCLASS()
+class MANIACCAB_API UVehicleLODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	int32 GetNumProxiedVehicles() const { return Proxies.Num(); }
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 PartCount = 5;
+
+	//Instances of one mesh, its component is at the same index in PoolComponents. Free instances are collapsed to nothing.
+	struct FInstancePool
+	{
+		TArray<FTransform> Transforms;
+		TArray<int32> FreeInstances;
+	};
+
+	struct FVehicleProxy
+	{
+		TWeakObjectPtr<ACarController> Vehicle;
+		FTransform ChassisTransform;
+		//Chassis first, then the wheels relative to the chassis.
+		FTransform PartOffsets[PartCount];
+		int32 Pools[PartCount];
+		int32 Instances[PartCount];
+		FVector LinearVelocity = FVector::ZeroVector;
+		FVector AngularVelocity = FVector::ZeroVector;
+		//Chassis height above the ground at handoff, restored over the ground found at the dead reckoned position on promotion.
+		float RideHeight = 0;
+	};
+
+	void DemoteVehicle(ACarController* a_Vehicle);
+	void PromoteVehicle(int32 a_ProxyIndex);
+	void ReleaseInstances(const FVehicleProxy& a_Proxy);
+	int32 FindOrAddPool(const UStaticMeshComponent* a_Part);
+	static void GetVehicleParts(const ACarController* a_Vehicle, const UStaticMeshComponent* (&o_Parts)[PartCount]);
+
+	UPROPERTY()
+	TObjectPtr<AActor> ProxyOwner;
+	UPROPERTY()
+	TArray<TObjectPtr<UHierarchicalInstancedStaticMeshComponent>> PoolComponents;
+
+	TArray<FInstancePool> Pools;
+	TMap<TObjectKey<UStaticMesh>, int32> PoolsByMesh;
+	TArray<FVehicleProxy> Proxies;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleDynamics.h"
+#include "VehicleManagerSubsystem.generated.h"
+
+class ACarController;
+
+//Updates every registered car in one pass. Component reads and writes stay on the game thread in registration order,
+//the wheel force kernels run across worker threads with ParallelFor. Per-actor ticking is off while batching is on.
+//Also picks each car's EVehicleSimulationTier from its distance to the camera and whether it is in view.
+UCLASS()
+class MANIACCAB_API UVehicleManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterVehicle(ACarController* a_Vehicle);
+	void UnregisterVehicle(ACarController* a_Vehicle);
+
+	bool IsBatchingVehicles() const { return IsBatching; }
+	const TArray<TObjectPtr<ACarController>>& GetVehicles() const { return Vehicles; }
+	//For loading screens: true once every registered car has loaded its assets and accepts input.
+	UFUNCTION(BlueprintPure, Category="Car Loading")
+	bool AreVehiclesReady() const;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	//Vehicles handed to one worker task. Small enough to spread traffic over all cores, large enough to amortise the task cost.
+	static constexpr int32 VehiclesPerTask = 8;
+
+	static constexpr int32 TierCount = 3;
+
+	void SetVehicleTicksEnabled(bool a_Enabled);
+	void UpdateSimulationTiers();
+
+	UPROPERTY()
+	TArray<TObjectPtr<ACarController>> Vehicles;
+
+	//Cars running the force model this frame, a subset of Vehicles in the same order.
+	TArray<ACarController*> UpdatedVehicles;
+	FVehicleDynamicsBatch Batch;
+	//Set from the cvar before any car registers, so cars spawned before the first manager tick are not updated twice.
+	bool IsBatching = false;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VehicleTuning.h"
+#include "VehicleTuningCommandlet.generated.h"
+
+class UCurveFloat;
+
+//Sweeps car tuning parameters through scripted manoeuvres on the engine independent car model, with no world, rendering
+//or frame cap, spread over every core, and writes the handling metrics of each configuration to a CSV.
+//Defaults and road curves come from the vehicle class, the mass, inertia and wheel layout from one car spawned in an empty world.
+//Each -Sweep entry is Name=Min:Max:Steps. The entries are swept as a grid, or drawn from uniformly with -Samples.
+//Names are SpringStrength, DampingAmount, TireMass, MaxTorque, CarTopSpeed, SpringRestDistance, FrictionScale and DriftFrictionScale.
+//
+//UnrealEditor-Cmd ManiacCab.uproject -run=VehicleTuning -nullrhi -unattended
+//	-Sweep=SpringStrength=8000:20000:5,DampingAmount=1000:5000:5,TireMass=20:40:3,FrictionScale=0.8:1.2:3
+//	-Samples=0 -Seed=1234 -DeltaTime=0.016667 -MaxConfigs=100000
+//	-VehicleClass=/Game/I01_Core/Blueprints/Car/BP_Car.BP_Car_C -Output=Saved/Benchmarks/VehicleTuning.csv
+UCLASS()
+class MANIACCAB_API UVehicleTuningCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVehicleTuningCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	//Configurations handed to one worker task, simulated in lockstep in one batch.
+	static constexpr int32 ConfigsPerTask = 16;
+
+	struct FSweepRange
+	{
+		FString Name;
+		float Min = 0;
+		float Max = 0;
+		int32 Steps = 1;
+	};
+
+	//Everything read from the vehicle class that the configurations start from.
+	struct FVehicleSource
+	{
+		FVehicleTuningBody Body;
+		FVehicleTuningConfig Defaults;
+		const UCurveFloat* TorqueCurve = nullptr;
+		const UCurveFloat* FrontWheelFrictionCurve = nullptr;
+		const UCurveFloat* BackWheelFrictionCurve = nullptr;
+		const UCurveFloat* FrontWheelDriftFrictionCurve = nullptr;
+		const UCurveFloat* BackWheelDriftFrictionCurve = nullptr;
+	};
+
+	static bool ReadVehicle(const FString& a_VehicleClass, FVehicleSource& o_Source);
+	static bool ParseSweep(const FString& a_Sweep, TArray<FSweepRange>& o_Ranges);
+	//o_Values holds the swept values of each configuration, one per range.
+	static void MakeConfigs(const FVehicleSource& a_Source, const TArray<FSweepRange>& a_Ranges, const TArray<TArray<float>>& a_Values,
+		TArray<FVehicleTuningConfig>& o_Configs);
+	static void WriteResults(const FString& a_Path, const TArray<FSweepRange>& a_Ranges, const TArray<TArray<float>>& a_Values,
+		const TArray<FVehicleManeuverMetrics> (&a_Metrics)[int32(EVehicleManeuver::Count)]);
+};
@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class ManiacCabDynamics : ModuleRules
+{
+	public ManiacCabDynamics(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		//Plain C++ vehicle math. Keep this to Core so it can be built and run headless without the engine.
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
@@ -0,0 +1,21 @@
+#include "BakedCurve.h"
+
+void FBakedCurve::Bake(float a_MinTime, float a_MaxTime, TFunctionRef<float(float)> a_Evaluate)
+{
+	MinTime = a_MinTime;
+	TimeToSample = (SampleCount - 1) / FMath::Max(a_MaxTime - a_MinTime, UE_KINDA_SMALL_NUMBER);
+
+	for (int32 i = 0; i < SampleCount; i++)
+		Samples[i] = a_Evaluate(MinTime + i / TimeToSample);
+}
+
+float FBakedCurve::MeasureMaxError(TFunctionRef<float(float)> a_Evaluate) const
+{
+	float maxError = 0;
+	for (int32 i = 0; i < SampleCount - 1; i++)
+	{
+		const float time = MinTime + (i + 0.5f) / TimeToSample;
+		maxError = FMath::Max(maxError, FMath::Abs(Evaluate(time) - a_Evaluate(time)));
+	}
+	return maxError;
+}
@@ -0,0 +1,192 @@
+#include "VehicleDynamics.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//Checks the SIMD wheel kernels against the scalar per-wheel force code ACarController ran before they existed.
+//Run from the Session Frontend or with: UnrealEditor-Cmd ManiacCab.uproject -ExecCmds="Automation RunTests ManiacCab.Dynamics;Quit" -nullrhi -unattended
+
+namespace
+{
+	constexpr int32 TestVehicles = 5;
+	constexpr float Tolerance = 1.e-3f;
+
+	struct FTestCurves
+	{
+		FBakedCurve Friction;
+		FBakedCurve Torque;
+
+		FTestCurves()
+		{
+			Friction.Bake(0.0f, 1.0f, [](float a_Time) { return 0.2f + 0.6f * a_Time * a_Time; });
+			Torque.Bake(0.0f, 1.0f, [](float a_Time) { return 1.0f - 0.5f * a_Time; });
+		}
+	};
+
+	FVector3f RandomVector(FRandomStream& a_Random, float a_Scale)
+	{
+		return FVector3f(a_Random.FRandRange(-1, 1), a_Random.FRandRange(-1, 1), a_Random.FRandRange(-1, 1)) * a_Scale;
+	}
+
+	//Vehicles with random poses and velocities. Every vehicle has one wheel in the air, one compressed past the probe start
+	//and one without curves, so the masking and the negative distances are covered.
+	void MakeTestBatch(const FTestCurves& a_Curves, FVehicleDynamicsBatch& o_Batch)
+	{
+		FRandomStream random(1234);
+		o_Batch.SetNumVehicles(TestVehicles);
+		for (int32 vehicle = 0; vehicle < TestVehicles; vehicle++)
+		{
+			FVehicleDynamicsParams& params = o_Batch.Params[vehicle];
+			params.Throttle = random.FRandRange(-1, 1);
+			params.DeltaTime = random.FRandRange(1.0f / 240, 1.0f / 30);
+			params.UpVector = (FVector3f::UpVector + RandomVector(random, 0.3f)).GetSafeNormal();
+			params.ChassisVelocity = RandomVector(random, 2500);
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			{
+				params.FrictionCurves[wheel] = wheel == 3 ? nullptr : &a_Curves.Friction;
+				params.TorqueCurves[wheel] = wheel == 3 ? nullptr : &a_Curves.Torque;
+
+				const FQuat4f rotation(FRotator3f(random.FRandRange(-20, 20), random.FRandRange(-180, 180), random.FRandRange(-20, 20)));
+				const float distance = wheel == 1 ? random.FRandRange(-50, -1) : random.FRandRange(0, 100);
+				o_Batch.SetWheel(FVehicleDynamicsBatch::WheelIndex(vehicle, wheel), RandomVector(random, 10000), rotation.GetForwardVector(),
+					rotation.GetRightVector(), params.ChassisVelocity + RandomVector(random, 300), distance, wheel != 2);
+			}
+		}
+		//A wheel standing still, where the slip is defined as zero.
+		o_Batch.VelocityX[0] = o_Batch.VelocityY[0] = o_Batch.VelocityZ[0] = 0;
+	}
+
+	FVector3f GetVector(const FVehicleDynamicsBatch::FFloatArray& a_X, const FVehicleDynamicsBatch::FFloatArray& a_Y,
+		const FVehicleDynamicsBatch::FFloatArray& a_Z, int32 a_Index)
+	{
+		return FVector3f(a_X[a_Index], a_Y[a_Index], a_Z[a_Index]);
+	}
+
+	//The scalar force code, one wheel at a time, as CalculateSpringForce, CalculateWheelFrictionForce and CalculateAccelerationForce did.
+	//Without the velocity terms it is the force reduced vehicles hold between updates.
+	FVector3f ScalarWheelForce(const FVehicleDynamicsBatch& a_Batch, int32 a_Vehicle, int32 a_Wheel, bool a_VelocityTerms = true)
+	{
+		const FVehicleDynamicsParams& params = a_Batch.Params[a_Vehicle];
+		const int32 i = FVehicleDynamicsBatch::WheelIndex(a_Vehicle, a_Wheel);
+		if (!a_Batch.IsGrounded(i))
+			return FVector3f::ZeroVector;
+
+		const FVector3f tireWorldVel = GetVector(a_Batch.VelocityX, a_Batch.VelocityY, a_Batch.VelocityZ, i);
+		const FVector3f forward = GetVector(a_Batch.ForwardX, a_Batch.ForwardY, a_Batch.ForwardZ, i);
+		const FVector3f right = GetVector(a_Batch.RightX, a_Batch.RightY, a_Batch.RightZ, i);
+
+		const float offset = params.SpringRestDistance - a_Batch.ContactDistance[i];
+		const float springVel = FVector3f::DotProduct(params.UpVector, tireWorldVel);
+		FVector3f spring = ((offset * params.SpringStrength) - (springVel * params.DampingAmount)) * params.UpVector;
+		spring.X = 0;
+		spring.Y = 0;
+
+		const FVector3f steeringDir = FVector3f::DotProduct(tireWorldVel, right) > FVector3f::DotProduct(tireWorldVel, -right) ? right : -right;
+		const float steeringVel = FVector3f::DotProduct(steeringDir, tireWorldVel);
+		const FBakedCurve* frictionCurve = params.FrictionCurves[a_Wheel];
+		const float friction = frictionCurve != nullptr ? frictionCurve->Evaluate(FVector3f::DotProduct(steeringDir, tireWorldVel.GetSafeNormal())) : 0.0f;
+		const FVector3f frictionForce = steeringDir * params.TireMass * (-steeringVel * friction / params.DeltaTime);
+
+		const float driveRatio = FMath::Clamp(FVector3f::DotProduct(params.ChassisVelocity, forward) / params.CarTopSpeed, 0.0f, 1.0f);
+		const FBakedCurve* torqueCurve = params.TorqueCurves[a_Wheel];
+		const float torque = torqueCurve != nullptr ? torqueCurve->Evaluate(driveRatio) : 0.0f;
+		const FVector3f driveForce = forward * (params.Throttle * torque * params.MaxTorque);
+
+		if (!a_VelocityTerms)
+			return FVector3f(0, 0, offset * params.SpringStrength * params.UpVector.Z) + driveForce;
+		return spring + frictionForce + driveForce;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVehicleDynamicsCurveInputsTest, "ManiacCab.Dynamics.ComputeCurveInputs",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FVehicleDynamicsCurveInputsTest::RunTest(const FString& Parameters)
+{
+	const FTestCurves curves;
+	FVehicleDynamicsBatch batch;
+	MakeTestBatch(curves, batch);
+	VehicleDynamics::ComputeCurveInputs(batch, 0, TestVehicles);
+
+	for (int32 vehicle = 0; vehicle < TestVehicles; vehicle++)
+	{
+		const FVehicleDynamicsParams& params = batch.Params[vehicle];
+		for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+		{
+			const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, wheel);
+			const FVector3f tireWorldVel = GetVector(batch.VelocityX, batch.VelocityY, batch.VelocityZ, i);
+			const FVector3f right = GetVector(batch.RightX, batch.RightY, batch.RightZ, i);
+			const FVector3f forward = GetVector(batch.ForwardX, batch.ForwardY, batch.ForwardZ, i);
+			const float slip = FMath::Abs(FVector3f::DotProduct(right, tireWorldVel.GetSafeNormal()));
+			const float driveRatio = FMath::Clamp(FVector3f::DotProduct(params.ChassisVelocity, forward) / params.CarTopSpeed, 0.0f, 1.0f);
+			TestEqual(FString::Printf(TEXT("Lateral slip of wheel %d"), i), batch.LateralSlip[i], slip, Tolerance);
+			TestEqual(FString::Printf(TEXT("Drive ratio of wheel %d"), i), batch.DriveRatio[i], driveRatio, Tolerance);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVehicleDynamicsEvaluateCurvesTest, "ManiacCab.Dynamics.EvaluateCurves",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FVehicleDynamicsEvaluateCurvesTest::RunTest(const FString& Parameters)
+{
+	const FTestCurves curves;
+	FVehicleDynamicsBatch batch;
+	MakeTestBatch(curves, batch);
+	VehicleDynamics::ComputeCurveInputs(batch, 0, TestVehicles);
+	VehicleDynamics::EvaluateCurves(batch, 0, TestVehicles);
+
+	for (int32 vehicle = 0; vehicle < TestVehicles; vehicle++)
+	{
+		const FVehicleDynamicsParams& params = batch.Params[vehicle];
+		for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+		{
+			const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, wheel);
+			const FBakedCurve* frictionCurve = params.FrictionCurves[wheel];
+			const FBakedCurve* torqueCurve = params.TorqueCurves[wheel];
+			TestEqual(FString::Printf(TEXT("Friction of wheel %d"), i), batch.FrictionCoefficient[i],
+				frictionCurve != nullptr ? frictionCurve->Evaluate(batch.LateralSlip[i]) : 0.0f, Tolerance);
+			TestEqual(FString::Printf(TEXT("Torque of wheel %d"), i), batch.TorqueCoefficient[i],
+				torqueCurve != nullptr ? torqueCurve->Evaluate(batch.DriveRatio[i]) : 0.0f, Tolerance);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVehicleDynamicsComputeForcesTest, "ManiacCab.Dynamics.ComputeForces",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FVehicleDynamicsComputeForcesTest::RunTest(const FString& Parameters)
+{
+	const FTestCurves curves;
+	FVehicleDynamicsBatch batch;
+	MakeTestBatch(curves, batch);
+	VehicleDynamics::Solve(batch, 0, TestVehicles);
+
+	for (int32 vehicle = 0; vehicle < TestVehicles; vehicle++)
+	{
+		for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+		{
+			const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, wheel);
+			const FVector3f expected = ScalarWheelForce(batch, vehicle, wheel);
+			const FVector3f force = batch.GetForce(i);
+			//Friction divides by DeltaTime, so the forces run into the millions. Compare relative to their size.
+			const float tolerance = FMath::Max(expected.GetAbsMax(), 1.0f) * Tolerance;
+			TestTrue(FString::Printf(TEXT("Force of wheel %d is %s, expected %s"), i, *force.ToString(), *expected.ToString()),
+				force.Equals(expected, tolerance));
+
+			const FVector3f expectedHeld = ScalarWheelForce(batch, vehicle, wheel, false);
+			const FVector3f heldForce = batch.GetHeldForce(i);
+			TestTrue(FString::Printf(TEXT("Held force of wheel %d is %s, expected %s"), i, *heldForce.ToString(), *expectedHeld.ToString()),
+				heldForce.Equals(expectedHeld, FMath::Max(expectedHeld.GetAbsMax(), 1.0f) * Tolerance));
+		}
+		//The spring has to push hardest when the suspension is compressed past the probe start.
+		TestTrue(TEXT("A wheel compressed past the probe start gets a force"), !batch.GetForce(FVehicleDynamicsBatch::WheelIndex(vehicle, 1)).IsZero());
+		TestTrue(TEXT("An airborne wheel gets no force"), batch.GetForce(FVehicleDynamicsBatch::WheelIndex(vehicle, 2)).IsZero());
+	}
+	return true;
+}
+
+#endif
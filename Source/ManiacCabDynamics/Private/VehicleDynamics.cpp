@@ -0,0 +1,157 @@
+#include "VehicleDynamics.h"
+
+#include "Math/VectorRegister.h"
+
+namespace
+{
+	FORCEINLINE VectorRegister4Float Load(const FVehicleDynamicsBatch::FFloatArray& a_Array, int32 a_Index)
+	{
+		return VectorLoadAligned(&a_Array[a_Index]);
+	}
+
+	FORCEINLINE void Store(FVehicleDynamicsBatch::FFloatArray& a_Array, int32 a_Index, const VectorRegister4Float& a_Value)
+	{
+		VectorStoreAligned(a_Value, &a_Array[a_Index]);
+	}
+
+	FORCEINLINE VectorRegister4Float Dot3(const VectorRegister4Float& a_AX, const VectorRegister4Float& a_AY, const VectorRegister4Float& a_AZ,
+		const VectorRegister4Float& a_BX, const VectorRegister4Float& a_BY, const VectorRegister4Float& a_BZ)
+	{
+		return VectorMultiplyAdd(a_AZ, a_BZ, VectorMultiplyAdd(a_AY, a_BY, VectorMultiply(a_AX, a_BX)));
+	}
+}
+
+void FVehicleDynamicsBatch::SetNumVehicles(int32 a_NumVehicles)
+{
+	const int32 numWheels = a_NumVehicles * WheelsPerVehicle;
+	Params.SetNum(a_NumVehicles, EAllowShrinking::No);
+
+	FFloatArray* arrays[] = {
+		&PositionX, &PositionY, &PositionZ, &ForwardX, &ForwardY, &ForwardZ, &RightX, &RightY, &RightZ,
+		&VelocityX, &VelocityY, &VelocityZ, &ContactDistance, &Grounded, &LateralSlip, &DriveRatio,
+		&FrictionCoefficient, &TorqueCoefficient, &ForceX, &ForceY, &ForceZ, &HeldForceX, &HeldForceY, &HeldForceZ
+	};
+	for (FFloatArray* array : arrays)
+		array->SetNumZeroed(numWheels, EAllowShrinking::No);
+}
+
+void FVehicleDynamicsBatch::SetWheel(int32 a_WheelIndex, const FVector3f& a_Position, const FVector3f& a_Forward, const FVector3f& a_Right, const FVector3f& a_Velocity,
+	float a_ContactDistance, bool a_Grounded)
+{
+	PositionX[a_WheelIndex] = a_Position.X;
+	PositionY[a_WheelIndex] = a_Position.Y;
+	PositionZ[a_WheelIndex] = a_Position.Z;
+	ForwardX[a_WheelIndex] = a_Forward.X;
+	ForwardY[a_WheelIndex] = a_Forward.Y;
+	ForwardZ[a_WheelIndex] = a_Forward.Z;
+	RightX[a_WheelIndex] = a_Right.X;
+	RightY[a_WheelIndex] = a_Right.Y;
+	RightZ[a_WheelIndex] = a_Right.Z;
+	VelocityX[a_WheelIndex] = a_Velocity.X;
+	VelocityY[a_WheelIndex] = a_Velocity.Y;
+	VelocityZ[a_WheelIndex] = a_Velocity.Z;
+	ContactDistance[a_WheelIndex] = a_ContactDistance;
+	Grounded[a_WheelIndex] = a_Grounded ? 1.0f : 0.0f;
+}
+
+void VehicleDynamics::ComputeCurveInputs(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles)
+{
+	const VectorRegister4Float zero = VectorZeroFloat();
+	const VectorRegister4Float one = VectorOneFloat();
+	//Same threshold as FVector::GetSafeNormal, below it the slip is treated as zero.
+	const VectorRegister4Float minSpeedSquared = VectorSetFloat1(1.e-8f);
+
+	for (int32 vehicle = a_FirstVehicle; vehicle < a_FirstVehicle + a_NumVehicles; vehicle++)
+	{
+		const FVehicleDynamicsParams& params = a_Batch.Params[vehicle];
+		const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, 0);
+
+		const VectorRegister4Float velX = Load(a_Batch.VelocityX, i);
+		const VectorRegister4Float velY = Load(a_Batch.VelocityY, i);
+		const VectorRegister4Float velZ = Load(a_Batch.VelocityZ, i);
+
+		const VectorRegister4Float lateral = Dot3(velX, velY, velZ, Load(a_Batch.RightX, i), Load(a_Batch.RightY, i), Load(a_Batch.RightZ, i));
+		const VectorRegister4Float speedSquared = Dot3(velX, velY, velZ, velX, velY, velZ);
+		const VectorRegister4Float slip = VectorDivide(VectorAbs(lateral), VectorSqrt(VectorMax(speedSquared, minSpeedSquared)));
+		Store(a_Batch.LateralSlip, i, VectorSelect(VectorCompareGT(speedSquared, minSpeedSquared), slip, zero));
+
+		const VectorRegister4Float forwardSpeed = Dot3(
+			VectorSetFloat1(params.ChassisVelocity.X), VectorSetFloat1(params.ChassisVelocity.Y), VectorSetFloat1(params.ChassisVelocity.Z),
+			Load(a_Batch.ForwardX, i), Load(a_Batch.ForwardY, i), Load(a_Batch.ForwardZ, i));
+		const VectorRegister4Float driveRatio = VectorMultiply(forwardSpeed, VectorSetFloat1(1.0f / params.CarTopSpeed));
+		Store(a_Batch.DriveRatio, i, VectorMin(VectorMax(driveRatio, zero), one));
+	}
+}
+
+void VehicleDynamics::EvaluateCurves(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles)
+{
+	for (int32 vehicle = a_FirstVehicle; vehicle < a_FirstVehicle + a_NumVehicles; vehicle++)
+	{
+		const FVehicleDynamicsParams& params = a_Batch.Params[vehicle];
+		for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+		{
+			const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, wheel);
+			const FBakedCurve* frictionCurve = params.FrictionCurves[wheel];
+			const FBakedCurve* torqueCurve = params.TorqueCurves[wheel];
+			a_Batch.FrictionCoefficient[i] = frictionCurve != nullptr ? frictionCurve->Evaluate(a_Batch.LateralSlip[i]) : 0.0f;
+			a_Batch.TorqueCoefficient[i] = torqueCurve != nullptr ? torqueCurve->Evaluate(a_Batch.DriveRatio[i]) : 0.0f;
+		}
+	}
+}
+
+void VehicleDynamics::ComputeForces(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles)
+{
+	const VectorRegister4Float zero = VectorZeroFloat();
+
+	for (int32 vehicle = a_FirstVehicle; vehicle < a_FirstVehicle + a_NumVehicles; vehicle++)
+	{
+		const FVehicleDynamicsParams& params = a_Batch.Params[vehicle];
+		const int32 i = FVehicleDynamicsBatch::WheelIndex(vehicle, 0);
+
+		const VectorRegister4Float velX = Load(a_Batch.VelocityX, i);
+		const VectorRegister4Float velY = Load(a_Batch.VelocityY, i);
+		const VectorRegister4Float velZ = Load(a_Batch.VelocityZ, i);
+		const VectorRegister4Float forwardX = Load(a_Batch.ForwardX, i);
+		const VectorRegister4Float forwardY = Load(a_Batch.ForwardY, i);
+		const VectorRegister4Float forwardZ = Load(a_Batch.ForwardZ, i);
+		const VectorRegister4Float rightX = Load(a_Batch.RightX, i);
+		const VectorRegister4Float rightY = Load(a_Batch.RightY, i);
+		const VectorRegister4Float rightZ = Load(a_Batch.RightZ, i);
+		const VectorRegister4Float contactDistance = Load(a_Batch.ContactDistance, i);
+
+		//Spring and damper along the chassis up vector. Only the vertical part is applied so the spring never pushes the car sideways.
+		const VectorRegister4Float springVel = Dot3(
+			VectorSetFloat1(params.UpVector.X), VectorSetFloat1(params.UpVector.Y), VectorSetFloat1(params.UpVector.Z), velX, velY, velZ);
+		const VectorRegister4Float offset = VectorSubtract(VectorSetFloat1(params.SpringRestDistance), contactDistance);
+		const VectorRegister4Float upZ = VectorSetFloat1(params.UpVector.Z);
+		const VectorRegister4Float springOnly = VectorMultiply(offset, VectorSetFloat1(params.SpringStrength));
+		const VectorRegister4Float springForce = VectorMultiply(VectorSubtract(springOnly, VectorMultiply(springVel, VectorSetFloat1(params.DampingAmount))), upZ);
+
+		//Cancel the curve scaled share of the lateral velocity within one step: -right * lateral * friction * TireMass / DeltaTime.
+		const VectorRegister4Float lateral = Dot3(velX, velY, velZ, rightX, rightY, rightZ);
+		const VectorRegister4Float frictionForce = VectorNegate(VectorMultiply(VectorMultiply(lateral, Load(a_Batch.FrictionCoefficient, i)),
+			VectorSetFloat1(params.TireMass / params.DeltaTime)));
+
+		const VectorRegister4Float driveForce = VectorMultiply(Load(a_Batch.TorqueCoefficient, i), VectorSetFloat1(params.MaxTorque * params.Throttle));
+
+		const VectorRegister4Float forceX = VectorMultiplyAdd(forwardX, driveForce, VectorMultiply(rightX, frictionForce));
+		const VectorRegister4Float forceY = VectorMultiplyAdd(forwardY, driveForce, VectorMultiply(rightY, frictionForce));
+		const VectorRegister4Float forceZ = VectorMultiplyAdd(forwardZ, driveForce, VectorMultiplyAdd(rightZ, frictionForce, springForce));
+
+		const VectorRegister4Float grounded = VectorCompareGT(Load(a_Batch.Grounded, i), zero);
+		Store(a_Batch.ForceX, i, VectorSelect(grounded, forceX, zero));
+		Store(a_Batch.ForceY, i, VectorSelect(grounded, forceY, zero));
+		Store(a_Batch.ForceZ, i, VectorSelect(grounded, forceZ, zero));
+
+		Store(a_Batch.HeldForceX, i, VectorSelect(grounded, VectorMultiply(forwardX, driveForce), zero));
+		Store(a_Batch.HeldForceY, i, VectorSelect(grounded, VectorMultiply(forwardY, driveForce), zero));
+		Store(a_Batch.HeldForceZ, i, VectorSelect(grounded, VectorMultiplyAdd(forwardZ, driveForce, VectorMultiply(springOnly, upZ)), zero));
+	}
+}
+
+void VehicleDynamics::Solve(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles)
+{
+	ComputeCurveInputs(a_Batch, a_FirstVehicle, a_NumVehicles);
+	EvaluateCurves(a_Batch, a_FirstVehicle, a_NumVehicles);
+	ComputeForces(a_Batch, a_FirstVehicle, a_NumVehicles);
+}
@@ -0,0 +1,308 @@
+#include "VehicleTuning.h"
+
+namespace
+{
+	constexpr float Gravity = -980.0f;
+	//ACarController::ApplyHeldWheelForces scales the wheel forces by DeltaTime * 100 before adding them to the body.
+	constexpr float WheelForceScale = 100.0f;
+	//Stands in for the chassis collision when a wheel point sinks into the ground: a critically damped spring per kg.
+	constexpr float BumpStopStiffness = 400.0f;
+	constexpr float BumpStopDamping = 40.0f;
+	//The chassis counts as settled below both of these.
+	constexpr float SettledVerticalSpeed = 10.0f;
+	constexpr float SettledAngularSpeed = 0.0873f;
+	//Slower than this the direction of travel is too noisy for a drift angle.
+	constexpr float MinDriftSpeed = 300.0f;
+
+	//How the jump landing starts: lifted this far, moving forward, nose down and rolled.
+	constexpr float JumpHeight = 150.0f;
+	constexpr float JumpSpeed = 1500.0f;
+	constexpr float JumpPitch = -8.0f;
+	constexpr float JumpRoll = 5.0f;
+
+	struct FManeuverInput
+	{
+		float Steering = 0;
+		float Throttle = 0;
+		bool HandBrake = false;
+	};
+
+	struct FChassisState
+	{
+		FVector3f Position = FVector3f::ZeroVector;
+		FQuat4f Rotation = FQuat4f::Identity;
+		FVector3f Velocity = FVector3f::ZeroVector;
+		//World space, radians per second.
+		FVector3f AngularVelocity = FVector3f::ZeroVector;
+		float FrontSteer = 0;
+		//When the disturbance the settle time is measured from happened, negative until then.
+		float DisturbanceTime = -1;
+		float LastUnsettledTime = 0;
+		double VerticalSpeedSquaredSum = 0;
+		int32 Samples = 0;
+	};
+
+	//Time is measured from the end of the warmup.
+	FManeuverInput GetManeuverInput(EVehicleManeuver a_Maneuver, float a_Time)
+	{
+		FManeuverInput input;
+		switch (a_Maneuver)
+		{
+		case EVehicleManeuver::Acceleration:
+			input.Throttle = 1;
+			break;
+		case EVehicleManeuver::Slalom:
+			input.Throttle = 0.6f;
+			input.Steering = a_Time < 1.0f ? 0.0f : FMath::Sin((a_Time - 1.0f) * UE_TWO_PI / 3.0f);
+			break;
+		case EVehicleManeuver::HandbrakeTurn:
+			input.Throttle = a_Time < 3.0f ? 1.0f : 0.5f;
+			input.Steering = a_Time >= 3.0f && a_Time < 4.5f ? 1.0f : 0.0f;
+			input.HandBrake = a_Time >= 3.0f && a_Time < 4.5f;
+			break;
+		case EVehicleManeuver::JumpLanding:
+			input.Throttle = 0.5f;
+			break;
+		default:
+			break;
+		}
+
+		//Same dead zone as ACarController::SetScriptedInput.
+		if (FMath::Abs(input.Steering) < 0.1f)
+			input.Steering = 0;
+		return input;
+	}
+
+	//The wheel probe against the ground plane at height zero. False when the probe misses, otherwise o_Distance is the
+	//distance from the wheel down to the floor along -up, negative when the suspension is compressed past the probe start.
+	bool ProbeGround(const FVehicleTuningBody& a_Body, const FVector3f& a_WheelPosition, const FVector3f& a_UpVector, float& o_Distance)
+	{
+		o_Distance = 0.0f;
+		if (a_UpVector.Z <= UE_KINDA_SMALL_NUMBER)
+			return false;
+
+		const float startHeight = a_WheelPosition.Z + a_UpVector.Z * a_Body.WheelCheckHeightOffset;
+		const float distance = startHeight / a_UpVector.Z;
+		if (distance < 0 || distance > a_Body.FloorCheckLimit + a_Body.WheelCheckHeightOffset)
+			return false;
+		o_Distance = distance - a_Body.WheelCheckHeightOffset;
+		return true;
+	}
+}
+
+const TCHAR* VehicleTuning::GetManeuverName(EVehicleManeuver a_Maneuver)
+{
+	switch (a_Maneuver)
+	{
+	case EVehicleManeuver::Acceleration:
+		return TEXT("Acceleration");
+	case EVehicleManeuver::Slalom:
+		return TEXT("Slalom");
+	case EVehicleManeuver::HandbrakeTurn:
+		return TEXT("HandbrakeTurn");
+	case EVehicleManeuver::JumpLanding:
+		return TEXT("JumpLanding");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+float VehicleTuning::GetManeuverDuration(EVehicleManeuver a_Maneuver)
+{
+	switch (a_Maneuver)
+	{
+	case EVehicleManeuver::Acceleration:
+		return WarmupTime + 8.0f;
+	case EVehicleManeuver::Slalom:
+		return WarmupTime + 12.0f;
+	case EVehicleManeuver::HandbrakeTurn:
+		return WarmupTime + 8.0f;
+	case EVehicleManeuver::JumpLanding:
+		return WarmupTime + 5.0f;
+	default:
+		return WarmupTime;
+	}
+}
+
+void VehicleTuning::SimulateManeuver(const FVehicleTuningBody& a_Body, TArrayView<const FVehicleTuningConfig> a_Configs,
+	EVehicleManeuver a_Maneuver, float a_DeltaTime, TArrayView<FVehicleManeuverMetrics> o_Metrics)
+{
+	check(a_Configs.Num() == o_Metrics.Num());
+	const int32 vehicleCount = a_Configs.Num();
+	const float duration = GetManeuverDuration(a_Maneuver);
+	const int32 stepCount = FMath::CeilToInt32(duration / a_DeltaTime);
+	const int32 warmupSteps = FMath::CeilToInt32(WarmupTime / a_DeltaTime);
+
+	FVehicleDynamicsBatch batch;
+	batch.SetNumVehicles(vehicleCount);
+	TArray<FChassisState> states;
+	states.SetNum(vehicleCount);
+
+	//Every car starts at rest with its wheels at the spring rest height.
+	float lowestWheel = a_Body.WheelOffsets[0].Z;
+	for (const FVector3f& offset : a_Body.WheelOffsets)
+		lowestWheel = FMath::Min(lowestWheel, offset.Z);
+	for (int32 vehicle = 0; vehicle < vehicleCount; vehicle++)
+	{
+		o_Metrics[vehicle] = FVehicleManeuverMetrics();
+		states[vehicle].Position = FVector3f(0, 0, a_Configs[vehicle].Params.SpringRestDistance - lowestWheel);
+	}
+
+	FVector3f wheelOffsets[4];
+	for (int32 step = 0; step < stepCount; step++)
+	{
+		const float time = (step - warmupSteps) * a_DeltaTime;
+		const bool measuring = step >= warmupSteps;
+		const FManeuverInput input = measuring ? GetManeuverInput(a_Maneuver, time) : FManeuverInput();
+
+		for (int32 vehicle = 0; vehicle < vehicleCount; vehicle++)
+		{
+			const FVehicleTuningConfig& config = a_Configs[vehicle];
+			FChassisState& state = states[vehicle];
+			if (step == warmupSteps && a_Maneuver == EVehicleManeuver::JumpLanding)
+			{
+				state.Position.Z += JumpHeight;
+				state.Rotation = FQuat4f(FRotator3f(JumpPitch, 0, JumpRoll));
+				state.Velocity = FVector3f(JumpSpeed, 0, 0);
+				state.AngularVelocity = FVector3f::ZeroVector;
+			}
+			if (step == warmupSteps && a_Maneuver != EVehicleManeuver::JumpLanding)
+				state.DisturbanceTime = 0;
+
+			const FVector3f upVector = state.Rotation.GetUpVector();
+			state.FrontSteer += (input.Steering * config.MaxTurnAngle - state.FrontSteer) * FMath::Clamp(a_DeltaTime * config.RotateSpeed, 0.0f, 1.0f);
+
+			FVehicleDynamicsParams& params = batch.Params[vehicle];
+			params = config.Params;
+			params.DeltaTime = a_DeltaTime;
+			params.UpVector = upVector;
+			params.ChassisVelocity = state.Velocity;
+			params.Throttle = input.Throttle;
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			{
+				const bool front = wheel < 2;
+				params.TorqueCurves[wheel] = &config.TorqueCurve;
+				if (input.HandBrake)
+					params.FrictionCurves[wheel] = front ? &config.FrontWheelDriftFriction : &config.BackWheelDriftFriction;
+				else
+					params.FrictionCurves[wheel] = front ? &config.FrontWheelFriction : &config.BackWheelFriction;
+
+				//Front wheels are yawed about the chassis up vector like HandleTurningInput does.
+				const FVector3f offset = state.Rotation.RotateVector(a_Body.WheelOffsets[wheel]);
+				const FVector3f position = state.Position + offset;
+				const FQuat4f wheelRotation = state.Rotation * FQuat4f(FVector3f::UpVector, FMath::DegreesToRadians(front ? state.FrontSteer : 0.0f));
+				float distance;
+				const bool grounded = ProbeGround(a_Body, position, upVector, distance) && !o_Metrics[vehicle].Unstable;
+				batch.SetWheel(FVehicleDynamicsBatch::WheelIndex(vehicle, wheel), position, wheelRotation.GetForwardVector(), wheelRotation.GetRightVector(),
+					state.Velocity + (state.AngularVelocity ^ offset), distance, grounded);
+			}
+		}
+
+		VehicleDynamics::Solve(batch, 0, vehicleCount);
+
+		for (int32 vehicle = 0; vehicle < vehicleCount; vehicle++)
+		{
+			FVehicleManeuverMetrics& metrics = o_Metrics[vehicle];
+			if (metrics.Unstable)
+				continue;
+
+			FChassisState& state = states[vehicle];
+			int32 groundedWheels = 0;
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			{
+				wheelOffsets[wheel] = state.Rotation.RotateVector(a_Body.WheelOffsets[wheel]);
+				groundedWheels += batch.IsGrounded(FVehicleDynamicsBatch::WheelIndex(vehicle, wheel)) ? 1 : 0;
+			}
+
+			FVector3f force(0, 0, a_Body.Mass * Gravity);
+			FVector3f torque = FVector3f::ZeroVector;
+			if (groundedWheels > 0)
+			{
+				//Coasting bleeds off planar velocity and drops the vertical, as in ApplyHeldWheelForces.
+				if (input.Steering == 0 && input.Throttle == 0)
+				{
+					FVector3f planarVelocity(state.Velocity.X, state.Velocity.Y, 0);
+					planarVelocity *= FMath::Pow(0.98f, float(groundedWheels));
+					if (planarVelocity.SizeSquared() < 10)
+						planarVelocity = FVector3f::ZeroVector;
+					state.Velocity = planarVelocity;
+				}
+
+				for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+				{
+					const int32 wheelIndex = FVehicleDynamicsBatch::WheelIndex(vehicle, wheel);
+					if (!batch.IsGrounded(wheelIndex))
+						continue;
+
+					const FVector3f wheelForce = batch.GetForce(wheelIndex) * a_DeltaTime * WheelForceScale;
+					force += wheelForce;
+					torque += wheelOffsets[wheel] ^ wheelForce;
+				}
+			}
+
+			for (int32 wheel = 0; wheel < FVehicleDynamicsBatch::WheelsPerVehicle; wheel++)
+			{
+				const float depth = -(state.Position.Z + wheelOffsets[wheel].Z);
+				if (depth <= 0)
+					continue;
+
+				const float pointSpeed = (state.Velocity + (state.AngularVelocity ^ wheelOffsets[wheel])).Z;
+				const FVector3f stopForce(0, 0, a_Body.Mass * FMath::Max(BumpStopStiffness * depth - BumpStopDamping * pointSpeed, 0.0f));
+				force += stopForce;
+				torque += wheelOffsets[wheel] ^ stopForce;
+			}
+
+			//Semi-implicit Euler, inertia applied in chassis space.
+			state.Velocity += force * (a_DeltaTime / a_Body.Mass);
+			const FVector3f localTorque = state.Rotation.UnrotateVector(torque);
+			state.AngularVelocity += state.Rotation.RotateVector(localTorque / a_Body.Inertia) * a_DeltaTime;
+			state.Position += state.Velocity * a_DeltaTime;
+			const float angularSpeed = state.AngularVelocity.Size();
+			if (angularSpeed > UE_KINDA_SMALL_NUMBER)
+				state.Rotation = (FQuat4f(state.AngularVelocity / angularSpeed, angularSpeed * a_DeltaTime) * state.Rotation).GetNormalized();
+
+			const FVector3f upVector = state.Rotation.GetUpVector();
+			if (upVector.Z < 0 || state.Position.ContainsNaN() || state.Velocity.ContainsNaN() || state.AngularVelocity.ContainsNaN())
+			{
+				metrics.Unstable = true;
+				continue;
+			}
+			if (!measuring)
+				continue;
+
+			if (state.DisturbanceTime < 0 && groundedWheels > 0)
+				state.DisturbanceTime = time;
+
+			const FVector3f planarVelocity(state.Velocity.X, state.Velocity.Y, 0);
+			const float planarSpeed = planarVelocity.Size();
+			metrics.TopSpeed = FMath::Max(metrics.TopSpeed, planarSpeed);
+			metrics.MaxRoll = FMath::Max(metrics.MaxRoll, FMath::RadiansToDegrees(FMath::Abs(FMath::Asin(FMath::Clamp(state.Rotation.GetRightVector().Z, -1.0f, 1.0f)))));
+			state.VerticalSpeedSquaredSum += FMath::Square(state.Velocity.Z);
+			state.Samples++;
+
+			const FVector3f heading = FVector3f(state.Rotation.GetForwardVector().X, state.Rotation.GetForwardVector().Y, 0).GetSafeNormal();
+			if (planarSpeed > MinDriftSpeed && !heading.IsZero())
+			{
+				const float cosine = FMath::Clamp(FVector3f::DotProduct(planarVelocity / planarSpeed, heading), -1.0f, 1.0f);
+				metrics.MaxDriftAngle = FMath::Max(metrics.MaxDriftAngle, FMath::RadiansToDegrees(FMath::Acos(cosine)));
+			}
+
+			//Yaw is what the driver asked for, only pitch and roll count against settling.
+			const FVector3f tiltRate = state.AngularVelocity - upVector * FVector3f::DotProduct(state.AngularVelocity, upVector);
+			if (FMath::Abs(state.Velocity.Z) > SettledVerticalSpeed || tiltRate.Size() > SettledAngularSpeed)
+				state.LastUnsettledTime = time;
+		}
+	}
+
+	const float scriptDuration = duration - WarmupTime;
+	for (int32 vehicle = 0; vehicle < vehicleCount; vehicle++)
+	{
+		const FChassisState& state = states[vehicle];
+		FVehicleManeuverMetrics& metrics = o_Metrics[vehicle];
+		metrics.Oscillation = state.Samples > 0 ? float(FMath::Sqrt(state.VerticalSpeedSquaredSum / state.Samples)) : 0.0f;
+		if (metrics.Unstable || state.DisturbanceTime < 0)
+			metrics.TimeToSettle = scriptDuration;
+		else
+			metrics.TimeToSettle = FMath::Max(state.LastUnsettledTime - state.DisturbanceTime, 0.0f);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+//A curve sampled at fixed intervals into a small table. Evaluation is a clamp, a multiply and a lerp between two
+//neighbouring samples, so there is no key search and no branching on the hot path.
+class MANIACCABDYNAMICS_API FBakedCurve
+{
+public:
+	static constexpr int32 SampleCount = 64;
+
+	void Bake(float a_MinTime, float a_MaxTime, TFunctionRef<float(float)> a_Evaluate);
+
+	//Largest difference between the table and the source curve, measured halfway between samples where the error peaks.
+	float MeasureMaxError(TFunctionRef<float(float)> a_Evaluate) const;
+
+	FORCEINLINE float Evaluate(float a_Time) const
+	{
+		const float position = FMath::Clamp((a_Time - MinTime) * TimeToSample, 0.0f, float(SampleCount - 1));
+		const int32 index = FMath::Min(int32(position), SampleCount - 2);
+		return FMath::Lerp(Samples[index], Samples[index + 1], position - float(index));
+	}
+
+	float GetMinTime() const { return MinTime; }
+	float GetMaxTime() const { return MinTime + (SampleCount - 1) / TimeToSample; }
+
+private:
+	alignas(16) float Samples[SampleCount] = {};
+	float MinTime = 0;
+	float TimeToSample = SampleCount - 1;
+};
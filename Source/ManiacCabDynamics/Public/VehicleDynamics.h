@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BakedCurve.h"
+
+//Per-vehicle values read by the wheel kernels. Units match the game: cm, cm/s and seconds.
+struct FVehicleDynamicsParams
+{
+	float SpringRestDistance = 50;
+	float SpringStrength = 15000;
+	float DampingAmount = 3000;
+	float TireMass = 30;
+	float CarTopSpeed = 2000;
+	float MaxTorque = 80000;
+	//Throttle in [-1, 1], already zeroed by the caller when input is disabled.
+	float Throttle = 0;
+	float DeltaTime = 1.0f / 60.0f;
+	FVector3f UpVector = FVector3f::UpVector;
+	FVector3f ChassisVelocity = FVector3f::ZeroVector;
+
+	//Friction and torque curve per wheel (front left, front right, back left, back right), so each wheel follows the surface under it.
+	//Owned by the caller, a missing curve evaluates to zero.
+	const FBakedCurve* FrictionCurves[4] = {};
+	const FBakedCurve* TorqueCurves[4] = {};
+};
+
+//Wheel state for any number of four wheeled vehicles in structure-of-arrays layout.
+//Wheel w of vehicle v lives at index v * 4 + w, so one SIMD register holds the same field for all four wheels of a vehicle.
+class MANIACCABDYNAMICS_API FVehicleDynamicsBatch
+{
+public:
+	static constexpr int32 WheelsPerVehicle = 4;
+	using FFloatArray = TArray<float, TAlignedHeapAllocator<16>>;
+
+	void SetNumVehicles(int32 a_NumVehicles);
+	int32 GetNumVehicles() const { return Params.Num(); }
+	static int32 WheelIndex(int32 a_Vehicle, int32 a_Wheel) { return a_Vehicle * WheelsPerVehicle + a_Wheel; }
+
+	void SetWheel(int32 a_WheelIndex, const FVector3f& a_Position, const FVector3f& a_Forward, const FVector3f& a_Right, const FVector3f& a_Velocity,
+		float a_ContactDistance, bool a_Grounded);
+	FVector3f GetPosition(int32 a_WheelIndex) const { return FVector3f(PositionX[a_WheelIndex], PositionY[a_WheelIndex], PositionZ[a_WheelIndex]); }
+	FVector3f GetForce(int32 a_WheelIndex) const { return FVector3f(ForceX[a_WheelIndex], ForceY[a_WheelIndex], ForceZ[a_WheelIndex]); }
+	FVector3f GetHeldForce(int32 a_WheelIndex) const { return FVector3f(HeldForceX[a_WheelIndex], HeldForceY[a_WheelIndex], HeldForceZ[a_WheelIndex]); }
+	bool IsGrounded(int32 a_WheelIndex) const { return Grounded[a_WheelIndex] != 0; }
+
+	TArray<FVehicleDynamicsParams> Params;
+
+	FFloatArray PositionX, PositionY, PositionZ;
+	FFloatArray ForwardX, ForwardY, ForwardZ;
+	FFloatArray RightX, RightY, RightZ;
+	//World velocity of the chassis at the wheel.
+	FFloatArray VelocityX, VelocityY, VelocityZ;
+	//Signed distance from the wheel to the floor, only meaningful for grounded wheels. It goes negative when the suspension
+	//is compressed past the probe start, on hard landings and ramps, and the spring has to push hardest then.
+	FFloatArray ContactDistance;
+	//1 for wheels whose probe hit the ground, 0 otherwise. Kept as floats so the force kernel masks with one compare.
+	FFloatArray Grounded;
+
+	//Written by ComputeCurveInputs. These are the inputs of the friction and torque curves.
+	FFloatArray LateralSlip;
+	FFloatArray DriveRatio;
+	//Curve results for the inputs above, written by EvaluateCurves.
+	FFloatArray FrictionCoefficient;
+	FFloatArray TorqueCoefficient;
+
+	//Combined spring, damping, lateral friction and drive force per wheel. Zero for wheels off the ground.
+	FFloatArray ForceX, ForceY, ForceZ;
+	//Spring and drive force only, for reduced vehicles to keep applying between updates. Damping and lateral friction cancel the
+	//velocity measured at the update, so holding them for several frames pushes the chassis past zero and it oscillates.
+	FFloatArray HeldForceX, HeldForceY, HeldForceZ;
+};
+
+namespace VehicleDynamics
+{
+	//Lateral slip (|lateral speed| / speed) and forward speed ratio for every wheel of the given vehicles.
+	MANIACCABDYNAMICS_API void ComputeCurveInputs(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles);
+	//Friction and torque coefficients from the baked curves in each vehicle's params.
+	MANIACCABDYNAMICS_API void EvaluateCurves(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles);
+	//Spring, damping, lateral friction and drive forces for every wheel of the given vehicles, four wheels per SIMD pass.
+	//Also writes the held forces.
+	MANIACCABDYNAMICS_API void ComputeForces(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles);
+	//All of the above in order.
+	MANIACCABDYNAMICS_API void Solve(FVehicleDynamicsBatch& a_Batch, int32 a_FirstVehicle, int32 a_NumVehicles);
+}
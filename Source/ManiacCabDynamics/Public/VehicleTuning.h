@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VehicleDynamics.h"
+
+//Scripted driving the tuning runs put every configuration through, on flat ground.
+enum class EVehicleManeuver : uint8
+{
+	//Full throttle in a straight line.
+	Acceleration,
+	//Part throttle, weaving left and right.
+	Slalom,
+	//Up to speed, then full lock with the handbrake held, then straight again.
+	HandbrakeTurn,
+	//Dropped onto the ground nose down and rolled, moving forward.
+	JumpLanding,
+	Count
+};
+
+//Rigid body the wheel forces act on. Units match the game: cm, kg and seconds.
+struct FVehicleTuningBody
+{
+	float Mass = 1000;
+	//Diagonal of the inertia tensor in chassis space, kg cm^2.
+	FVector3f Inertia = FVector3f(2.0e6f, 4.0e6f, 5.0e6f);
+	//Wheel positions relative to the centre of mass in chassis space: front left, front right, back left, back right.
+	FVector3f WheelOffsets[4] = {
+		FVector3f(130, -80, -20), FVector3f(130, 80, -20), FVector3f(-130, -80, -20), FVector3f(-130, 80, -20)
+	};
+	//Probe length below the wheel and how far above the wheel the probe starts, as FloorCheckLimit and WheelCheckHeightOffset.
+	float FloorCheckLimit = 100;
+	float WheelCheckHeightOffset = 50;
+};
+
+//One set of parameters to simulate. Holds its own curve tables so configurations can scale the curves independently.
+struct FVehicleTuningConfig
+{
+	//Curves and per-frame fields are filled in by the simulation, only the tuned values are read from here.
+	FVehicleDynamicsParams Params;
+	float MaxTurnAngle = 35;
+	float RotateSpeed = 15;
+	FBakedCurve TorqueCurve;
+	FBakedCurve FrontWheelFriction;
+	FBakedCurve BackWheelFriction;
+	FBakedCurve FrontWheelDriftFriction;
+	FBakedCurve BackWheelDriftFriction;
+};
+
+//What one configuration did in one manoeuvre.
+struct FVehicleManeuverMetrics
+{
+	//Fastest planar speed reached, cm/s.
+	float TopSpeed = 0;
+	//RMS of the chassis' vertical speed, cm/s. Suspension bounce and porpoising show up here.
+	float Oscillation = 0;
+	//From the disturbance (start of the script, or touchdown for the jump) until the chassis stopped pitching, rolling
+	//and bouncing for good. The whole manoeuvre if it never did.
+	float TimeToSettle = 0;
+	//Largest angle between the heading and the direction of travel, degrees.
+	float MaxDriftAngle = 0;
+	float MaxRoll = 0;
+	//Rolled over or blew up. The other metrics stop at that point.
+	bool Unstable = false;
+};
+
+namespace VehicleTuning
+{
+	static constexpr float WarmupTime = 1.0f;
+
+	MANIACCABDYNAMICS_API const TCHAR* GetManeuverName(EVehicleManeuver a_Maneuver);
+	//Seconds simulated per configuration, warmup included.
+	MANIACCABDYNAMICS_API float GetManeuverDuration(EVehicleManeuver a_Maneuver);
+	//Simulates each configuration through the manoeuvre at a fixed step, with the same wheel kernels and force application
+	//as ACarController. The configurations share one FVehicleDynamicsBatch and run in lockstep on the calling thread,
+	//callers spread chunks of configurations over workers. Air correction is not simulated.
+	MANIACCABDYNAMICS_API void SimulateManeuver(const FVehicleTuningBody& a_Body, TArrayView<const FVehicleTuningConfig> a_Configs,
+		EVehicleManeuver a_Maneuver, float a_DeltaTime, TArrayView<FVehicleManeuverMetrics> o_Metrics);
+}